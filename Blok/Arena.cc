@@ -0,0 +1,126 @@
+/* Arena.cc - implementation of the fixed size slab allocator
+ *
+ * Slabs are mapped with mmap(), and (optionally) aligned to 2MB and advised to use transparent
+ *   huge pages, which cuts down on TLB misses when chunks are scattered across many slabs
+ *
+ */
+
+#include <Blok/Arena.hh>
+
+// for mmap/munmap/madvise
+#include <sys/mman.h>
+
+// for placement new
+#include <new>
+
+namespace Blok {
+
+// mask of the address bits of a tagged free list head
+static const uint64_t PTR_MASK = (1ULL << 48) - 1;
+
+// a single increment of the tag bits of a tagged free list head
+static const uint64_t TAG_ONE = 1ULL << 48;
+
+// the alignment (and size) of a huge page
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// the links of the free list are stored in the first word of each free slot
+static inline std::atomic<uint64_t>* nextOf(void* slot) {
+    return (std::atomic<uint64_t>*)slot;
+}
+
+Arena::Arena(size_t slotSize, size_t slabSize, bool hugePages) : freeHead(0), numUsed(0), numSlabs(0) {
+    // round up so that all slots are 16 byte aligned
+    this->slotSize = (slotSize + 15) & ~(size_t)15;
+
+    // make sure a slab holds a decent number of slots, and is a whole number of pages
+    if (slabSize < 16 * this->slotSize) slabSize = 16 * this->slotSize;
+    this->slabSize = (slabSize + 4095) & ~(size_t)4095;
+
+    this->hugePages = hugePages;
+}
+
+Arena::~Arena() {
+    for (void* slab : slabs) {
+        munmap(slab, slabSize);
+    }
+}
+
+void Arena::pushChain(void* first, void* last) {
+    uint64_t head = freeHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        // link the end of the chain to the current head
+        nextOf(last)->store(head & PTR_MASK, std::memory_order_relaxed);
+        newHead = ((uint64_t)(uintptr_t)first & PTR_MASK) | ((head + TAG_ONE) & ~PTR_MASK);
+    } while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void Arena::addSlab() {
+    std::lock_guard<std::mutex> lock(L_slabs);
+
+    // another thread may have added a slab while we were waiting
+    if ((freeHead.load(std::memory_order_acquire) & PTR_MASK) != 0) return;
+
+    // over-allocate so we can align the slab to a huge page boundary
+    size_t extra = hugePages ? HUGE_PAGE_SIZE : 0;
+    char* raw = (char*)mmap(NULL, slabSize + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((void*)raw == MAP_FAILED) {
+        blok_error("Arena: failed to map a slab of %i bytes!", (int)slabSize);
+        exit(-1);
+    }
+
+    char* slab = raw;
+    if (hugePages) {
+        // trim off the unaligned head and the tail
+        slab = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (slab > raw) munmap(raw, slab - raw);
+        if (raw + slabSize + extra > slab + slabSize) munmap(slab + slabSize, (raw + slabSize + extra) - (slab + slabSize));
+
+        #ifdef MADV_HUGEPAGE
+        madvise(slab, slabSize, MADV_HUGEPAGE);
+        #endif
+    }
+
+    slabs.push_back(slab);
+    numSlabs++;
+
+    // link all the slots together, and push them all at once
+    size_t N = slabSize / slotSize;
+    for (size_t i = 0; i < N; ++i) {
+        char* slot = slab + i * slotSize;
+        new (slot) std::atomic<uint64_t>(i + 1 < N ? (uint64_t)(uintptr_t)(slot + slotSize) : 0);
+    }
+    pushChain(slab, slab + (N - 1) * slotSize);
+}
+
+void* Arena::alloc() {
+    uint64_t head = freeHead.load(std::memory_order_acquire);
+    while (true) {
+        void* slot = (void*)(uintptr_t)(head & PTR_MASK);
+        if (slot == NULL) {
+            // out of slots, so map some more
+            addSlab();
+            head = freeHead.load(std::memory_order_acquire);
+            continue;
+        }
+
+        // NOTE: 'slot' may have been popped (and written to) by another thread in the meantime, but
+        //   slabs are never unmapped, so this read is safe, and the tag makes the CAS fail in that case
+        uint64_t next = nextOf(slot)->load(std::memory_order_relaxed);
+        uint64_t newHead = (next & PTR_MASK) | ((head + TAG_ONE) & ~PTR_MASK);
+        if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+            numUsed++;
+            return slot;
+        }
+    }
+}
+
+void Arena::free(void* ptr) {
+    if (ptr == NULL) return;
+    new (ptr) std::atomic<uint64_t>(0);
+    pushChain(ptr, ptr);
+    numUsed--;
+}
+
+}
@@ -0,0 +1,95 @@
+/* Arena.hh - fixed size slab allocator, used for chunk storage
+ *
+ * Chunk streaming allocates and frees the same few sizes of objects over and over (chunks,
+ *   section storage buffers, etc). Instead of going through the heap each time (which is slow
+ *   and fragments the heap in long sessions), those objects are carved out of large slabs
+ *   that are mapped directly from the OS, and recycled through a free list.
+ *
+ * The free list is lock-free, so the generator threads can allocate and free concurrently. Only
+ *   mapping a new slab (which happens rarely, and never in steady state) takes a lock
+ *
+ * See `Arena.cc` for the implementation
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_ARENA_HH__
+#define BLOK_ARENA_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+#include <atomic>
+#include <mutex>
+
+namespace Blok {
+
+    // Arena - an allocator for fixed size slots, which are carved out of large slabs of memory
+    // Freed slots are kept on a lock-free free list and reused, and slabs are never returned to the
+    //   OS until the arena is destroyed
+    class Arena {
+        public:
+
+        // the size of each slot, in bytes (rounded up to a multiple of 16)
+        size_t slotSize;
+
+        // the size of each slab that is mapped from the OS, in bytes
+        size_t slabSize;
+
+        // whether or not to ask the OS to back slabs with huge pages (where supported)
+        bool hugePages;
+
+        // construct an arena for slots of 'slotSize' bytes
+        Arena(size_t slotSize, size_t slabSize=2*1024*1024, bool hugePages=true);
+
+        // unmap all slabs. All slots must have been freed, or at least never used again
+        ~Arena();
+
+        // arenas own their slabs, so they should not be copied
+        Arena(const Arena& other) = delete;
+        Arena& operator=(const Arena& other) = delete;
+
+        // allocate a single slot (uninitialized)
+        void* alloc();
+
+        // return a slot given by `alloc()` to the arena
+        void free(void* ptr);
+
+        // return the number of slots currently allocated
+        size_t getNumUsed() const {
+            return numUsed.load(std::memory_order_relaxed);
+        }
+
+        // return the number of bytes currently mapped from the OS
+        size_t getBytesMapped() const {
+            return numSlabs.load(std::memory_order_relaxed) * slabSize;
+        }
+
+        private:
+
+        // the head of the free list, as a tagged pointer: the low 48 bits are the address of the
+        //   first free slot, and the high 16 bits are a counter that is bumped on every update, which
+        //   prevents the ABA problem when popping
+        std::atomic<uint64_t> freeHead;
+
+        // statistics
+        std::atomic<size_t> numUsed, numSlabs;
+
+        // lock held while mapping a new slab
+        std::mutex L_slabs;
+
+        // list of all mapped slabs (guarded by 'L_slabs')
+        List<void*> slabs;
+
+        // push a linked chain of free slots (from 'first' to 'last') onto the free list
+        void pushChain(void* first, void* last);
+
+        // map a new slab, and put all of its slots on the free list
+        void addSlab();
+
+    };
+
+}
+
+#endif /* BLOK_ARENA_HH__ */
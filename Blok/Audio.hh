@@ -12,6 +12,8 @@
 // general Blok library
 #include <Blok/Blok.hh>
 
+// flat hash tables, for the buffer cache
+#include <Blok/HashMap.hh>
 
 #include <mutex>
 
@@ -44,7 +46,7 @@ namespace Blok::Audio {
     struct Buffer {
 
         // cache of loaded constant buffers from files
-        static Map<String, Buffer*> cache;
+        static HashMap<String, Buffer*> cache;
 
         // read a wav file into a buffer, as a const (i.e. do not modify or free it)
         // it will be stored in 'cache'
@@ -0,0 +1,214 @@
+/* Biome.hh - low resolution biome and climate maps, for world generators
+ *
+ * Biomes (and the climate that decides them) change over hundreds of blocks, so sampling their noise at
+ *   every column is a waste. Instead, they are sampled once per 'cell' of 4x4 columns, and whole tiles of
+ *   128x128 cells (512x512 columns) are made at once, and cached. Chunks next to each other use the same
+ *   tile, so the noise behind biomes is only ever computed once per cell
+ *
+ * Terrain parameters (i.e. how high, and how hilly the land is) come from the biome of each cell, and are
+ *   blended between the cells around each column, so there are no seams where biomes meet
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_BIOME_HH__
+#define BLOK_BIOME_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+// the climate is made out of noise graphs
+#include <Blok/NoiseGraph.hh>
+
+// for the cache of tiles
+#include <Blok/HashMap.hh>
+
+#include <mutex>
+#include <condition_variable>
+
+namespace Blok::WG {
+
+    // Biome - the kinds of land
+    enum Biome : uint8_t {
+
+        // flat, grassy land
+        BIOME_PLAINS = 0,
+
+        // rolling hills, in wetter areas
+        BIOME_HILLS,
+
+        // high, cold, and rocky land
+        BIOME_MOUNTAINS,
+
+        // hot and dry land, with bare stone cut by deep ridges
+        BIOME_BADLANDS,
+
+        // the number of biomes
+        BIOME_NUM
+
+    };
+
+    // BiomeParams - the terrain parameters of a biome, which are blended between neighboring biomes
+    struct BiomeParams {
+
+        // added to the base height of the land
+        float heightOffset;
+
+        // how much of the rolling hills, and of the ridges, there are (1 being the normal amount)
+        float hillScale, ridgeScale;
+
+        // how much of the surface is grass (and not bare stone). Columns where this is at least 0.5 are
+        //   covered in grass
+        float grass;
+
+        // return the parameters of 'biome'
+        static BiomeParams get(Biome biome) {
+            static const BiomeParams table[BIOME_NUM] = {
+                /* BIOME_PLAINS    */ {  0.0f, 0.5f, 0.5f, 1.0f },
+                /* BIOME_HILLS     */ {  4.0f, 1.6f, 1.0f, 1.0f },
+                /* BIOME_MOUNTAINS */ { 14.0f, 2.2f, 1.8f, 0.0f },
+                /* BIOME_BADLANDS  */ {  2.0f, 1.0f, 2.5f, 0.0f },
+            };
+            return table[biome];
+        }
+
+    };
+
+    // BiomeCell - the climate and biome of a cell of 4x4 columns, sampled at its corner with the smallest
+    //   coordinates
+    struct BiomeCell {
+
+        // the base height of the land (before the biome's offset)
+        float height;
+
+        // the temperature and humidity, each in [0, 1]
+        float temperature, humidity;
+
+        // the biome the climate makes
+        Biome biome;
+
+    };
+
+    // BiomeColumn - the terrain parameters of a single column, blended from the cells around it
+    struct BiomeColumn {
+
+        // the base height of the land (before the biome's offset)
+        float height;
+
+        // the blended parameters
+        BiomeParams params;
+
+        // the biome of the cell the column is in
+        Biome biome;
+
+    };
+
+    // BiomeMap - a cache of tiles of biome cells
+    // All methods are thread-safe. Tiles are never modified once they are made, so a thread that needs a
+    //   tile that another thread is making waits for it, instead of making its own
+    // See `WG/Biome.cc` for the implementation
+    class BiomeMap {
+        public:
+
+        // the number of columns across a cell, and the number of cells across a tile
+        static const int CELL_SIZE = 4, TILE_CELLS = 128;
+
+        // the number of columns across a tile
+        static const int TILE_SIZE = CELL_SIZE * TILE_CELLS;
+
+        // statistics about the cache
+        struct {
+
+            // the number of requests for cells (i.e. one per chunk)
+            std::atomic<int> n_requests;
+
+            // the number of tiles made, and the total time spent making them (in microseconds)
+            std::atomic<int> n_tiles;
+            std::atomic<int64_t> t_tiles;
+
+        } stats;
+
+        // construct a map for the world 'seed', keeping (about) 'maxTiles' tiles in the cache
+        BiomeMap(uint32_t seed, int maxTiles=16);
+
+        // free all the tiles
+        ~BiomeMap();
+
+        // the cache holds tiles, so it should not be copied
+        BiomeMap(const BiomeMap& other) = delete;
+        BiomeMap& operator=(const BiomeMap& other) = delete;
+
+        // return the cell at cell coordinates 'cx, cz' (i.e. the one containing columns
+        //   'CELL_SIZE * cx' through 'CELL_SIZE * cx + CELL_SIZE - 1')
+        BiomeCell getCell(int cx, int cz) {
+            BiomeCell res;
+            getCells(cx, cz, 1, 1, &res);
+            return res;
+        }
+
+        // copy the cells in the 'ncx*ncz' area starting at cell coordinates 'cx0, cz0' to 'out', in
+        //   X-major order (i.e. 'out[i*ncz+j]' is cell 'cx0+i, cz0+j'). The area may span any number of tiles
+        void getCells(int cx0, int cz0, int ncx, int ncz, BiomeCell* out);
+
+        // set 'out[x*CHUNK_SIZE_Z+z]' to the blended parameters of each column in chunk 'id'
+        void getColumns(ChunkID id, BiomeColumn* out);
+
+        // compute the cell at cell coordinates 'cx, cz' directly, without any tiles (which is much slower
+        //   than going through the cache, but gives the same result)
+        BiomeCell calcCell(int cx, int cz);
+
+        // return the number of tiles in the cache
+        int size();
+
+        private:
+
+        // Tile - the cells of a 'TILE_CELLS*TILE_CELLS' area
+        struct Tile {
+
+            // the cells, in X-major order
+            List<BiomeCell> cells;
+
+            // whether 'cells' has been filled in (if not, another thread is still making it)
+            bool isReady;
+
+            // the value of 'tick' when it was last used, to free the least recently used first
+            uint64_t lastUse;
+
+        };
+
+        // the noise (in cell coordinates) of the base height, temperature, and humidity
+        Random::NoisePlan heightPlan, temperaturePlan, humidityPlan;
+
+        // the soft limit on the number of tiles
+        int maxTiles;
+
+        // the tiles, by their tile coordinates
+        HashMap< Pair<int, int>, Tile* > tiles;
+
+        // counts up on each use of a tile
+        uint64_t tick;
+
+        // held while using 'tiles', and signalled whenever a tile is finished
+        std::mutex L_tiles;
+        std::condition_variable CV_tiles;
+
+        // return the biome of a climate
+        static Biome classify(float height, float temperature, float humidity);
+
+        // fill in the cells of the tile at tile coordinates 'tx, tz'
+        void buildTile(int tx, int tz, Tile* tile);
+
+        // return the tile at tile coordinates 'tx, tz', making it (or waiting for it) if it isn't cached
+        // NOTE: 'lock' must hold 'L_tiles', and it is released while the tile is made
+        Tile* getTile(std::unique_lock<std::mutex>& lock, int tx, int tz);
+
+        // free the least recently used tiles, if there are too many
+        // NOTE: 'L_tiles' must be held
+        void trim();
+
+    };
+
+}
+
+#endif /* BLOK_BIOME_HH__ */
@@ -3,6 +3,10 @@
 #include "Blok/Blok.hh"
 
 #include "Blok/Audio.hh"
+#include "Blok/Arena.hh"
+#include "Blok/Save.hh"
+#include "Blok/ChunkGrid.hh"
+#include "Blok/HashMap.hh"
 
 // for vararg parsing
 #include <stdarg.h>
@@ -15,6 +19,9 @@
 #include <unistd.h>
 #include <getopt.h>
 
+// for stat
+#include <sys/stat.h>
+
 // ASCII format codes
 #define BOLD   "\033[1m"
 #define RESET  "\033[0m"
@@ -47,6 +54,419 @@ String formatUnits(double val, const List<String> names) {
 }
 
 
+/* BLOCK STORAGE */
+
+// return the arena used for the buffers of section-sized storages, at 'lbits'
+// Sections are by far the most common storages, so their buffers are recycled rather than
+//   going through the heap each time a chunk is loaded/unloaded or a section is repacked
+static Arena* getStorageArena(int lbits) {
+    static Arena* arenas[5] = {
+        new Arena(BlockStorage::getPaletteBytes(0) + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> 6)),
+        new Arena(BlockStorage::getPaletteBytes(1) + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> 5)),
+        new Arena(BlockStorage::getPaletteBytes(2) + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> 4)),
+        new Arena(BlockStorage::getPaletteBytes(3) + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> 3)),
+        new Arena(BlockStorage::getPaletteBytes(4) + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> 2)),
+    };
+    return arenas[lbits];
+}
+
+// arenas for the objects themselves
+static Arena* getStorageObjectArena() {
+    static Arena* arena = new Arena(sizeof(BlockStorage));
+    return arena;
+}
+static Arena* getChunkArena() {
+    static Arena* arena = new Arena(sizeof(Chunk));
+    return arena;
+}
+
+void getArenaStats(size_t& numUsed, size_t& bytesMapped) {
+    Arena* arenas[] = { getStorageArena(0), getStorageArena(1), getStorageArena(2), getStorageArena(3), getStorageArena(4), getStorageObjectArena(), getChunkArena() };
+    numUsed = 0;
+    bytesMapped = 0;
+    for (Arena* arena : arenas) {
+        numUsed += arena->getNumUsed();
+        bytesMapped += arena->getBytesMapped();
+    }
+}
+
+// allocate a buffer for a storage with 'size' entries, at 'lbits', setting 'palette' and 'words'
+static void storageAlloc(int size, int lbits, BlockData*& palette, uint64_t*& words) {
+    size_t pbytes = BlockStorage::getPaletteBytes(lbits);
+    size_t wbytes = sizeof(uint64_t) * (size >> (6 - lbits));
+
+    // the palette comes first, and the indices after
+    char* buf = size == SECTION_NUM_BLOCKS ? (char*)getStorageArena(lbits)->alloc() : (char*)::operator new(pbytes + wbytes);
+    palette = (BlockData*)buf;
+    words = (uint64_t*)(buf + pbytes);
+}
+
+// free a buffer allocated with `storageAlloc()` (with the same 'size' and 'lbits')
+static void storageFree(int size, int lbits, BlockData* palette) {
+    if (size == SECTION_NUM_BLOCKS) {
+        getStorageArena(lbits)->free((void*)palette);
+    } else {
+        ::operator delete((void*)palette);
+    }
+}
+
+void* BlockStorage::operator new(size_t sz) {
+    return sz == sizeof(BlockStorage) ? getStorageObjectArena()->alloc() : ::operator new(sz);
+}
+
+void BlockStorage::operator delete(void* ptr, size_t sz) {
+    if (sz == sizeof(BlockStorage)) {
+        getStorageObjectArena()->free(ptr);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+BlockStorage::BlockStorage(int size, BlockData val) {
+    this->size = size;
+
+    // start off with a single palette entry, and 1 bit per index (all 0)
+    lbits = 0;
+    storageAlloc(size, lbits, palette, words);
+    memset(words, 0, sizeof(uint64_t) * (size >> 6));
+
+    palette[0] = val;
+    paletteSize = 1;
+    numRefs = 1;
+    isInterned = false;
+}
+
+BlockStorage::BlockStorage(int size, int lbits, const BlockData* palette, int paletteSize, const uint64_t* words) {
+    this->size = size;
+    this->lbits = lbits;
+    this->paletteSize = lbits < 4 ? paletteSize : 0;
+
+    storageAlloc(size, lbits, this->palette, this->words);
+    if (lbits < 4) memcpy(this->palette, palette, sizeof(BlockData) * paletteSize);
+    memcpy(this->words, words, sizeof(uint64_t) * (size >> (6 - lbits)));
+    numRefs = 1;
+    isInterned = false;
+}
+
+BlockStorage::~BlockStorage() {
+    storageFree(size, lbits, palette);
+}
+
+void BlockStorage::repack(int newLbits, const BlockData* newPalette, int newPaletteSize, const int* remap) {
+    BlockData* newPal;
+    uint64_t* newWords;
+    storageAlloc(size, newLbits, newPal, newWords);
+    memset(newWords, 0, sizeof(uint64_t) * (size >> (6 - newLbits)));
+
+    // copy over the new palette
+    for (int i = 0; i < newPaletteSize && newLbits < 4; ++i) {
+        newPal[i] = newPalette[i];
+    }
+
+    // now, re-encode every entry
+    // the new values are accumulated a word at a time, to avoid read-modify-write
+    const int newPerWord = 64 >> newLbits;
+    for (int w = 0; w < (size >> (6 - newLbits)); ++w) {
+        uint64_t word = 0;
+        for (int j = 0; j < newPerWord; ++j) {
+            uint32_t raw = getRaw(w * newPerWord + j);
+            if (newLbits == 4) {
+                // direct storage, so store the actual value
+                if (lbits < 4) raw = palette[raw].pack();
+            } else if (remap != NULL) {
+                raw = remap[raw];
+            }
+            word |= (uint64_t)raw << (j << newLbits);
+        }
+        newWords[w] = word;
+    }
+
+    // replace our buffer
+    storageFree(size, lbits, palette);
+    palette = newPal;
+    words = newWords;
+    lbits = newLbits;
+    paletteSize = newLbits < 4 ? newPaletteSize : 0;
+}
+
+void BlockStorage::compact() {
+    // direct storage has no palette to compact
+    if (lbits >= 4) return;
+
+    // count how many times each palette entry is used
+    int counts[256] = {0};
+    for (int i = 0; i < size; ++i) {
+        counts[getRaw(i)]++;
+    }
+
+    // build the new palette out of only the used entries
+    BlockData newPalette[256];
+    int remap[256];
+    int newPaletteSize = 0;
+    for (int i = 0; i < paletteSize; ++i) {
+        if (counts[i] > 0) {
+            remap[i] = newPaletteSize;
+            newPalette[newPaletteSize++] = palette[i];
+        } else {
+            remap[i] = -1;
+        }
+    }
+
+    // nothing to remove
+    if (newPaletteSize == paletteSize && (lbits == 0 || newPaletteSize > getPaletteCap(lbits - 1))) return;
+
+    // find the fewest bits that fit the new palette
+    int newLbits = 0;
+    while (getPaletteCap(newLbits) < newPaletteSize) newLbits++;
+
+    repack(newLbits, newPalette, newPaletteSize, remap);
+}
+
+void BlockStorage::fill(int idx0, int idx1, BlockData val) {
+    if (idx0 >= idx1) return;
+    uint64_t raw = getRawFor(val);
+
+    // repeat the value across an entire word
+    uint64_t pattern = raw;
+    for (int b = 1 << lbits; b < 64; b *= 2) pattern |= pattern << b;
+
+    // write a word at a time, masking out entries outside of the range at either end
+    const int perWord = 64 >> lbits;
+    int i = idx0;
+    while (i < idx1) {
+        uint64_t& word = words[i >> (6 - lbits)];
+        int j = i & (perWord - 1);
+        int n = perWord - j;
+        if (n > idx1 - i) n = idx1 - i;
+        if (n == perWord) {
+            word = pattern;
+        } else {
+            uint64_t mask = ((1ULL << (n << lbits)) - 1) << (j << lbits);
+            word = (word & ~mask) | (pattern & mask);
+        }
+        i += n;
+    }
+}
+
+void BlockStorage::grow() {
+    // first, try and remove unused entries (i.e. blocks that have since been overwritten)
+    compact();
+
+    // if there is still no room, add another bit (or switch to direct storage)
+    if (paletteSize == getPaletteCap(lbits)) {
+        repack(lbits + 1, palette, paletteSize, NULL);
+    }
+}
+
+
+/* CHUNKS */
+
+void* Chunk::operator new(size_t sz) {
+    return sz == sizeof(Chunk) ? getChunkArena()->alloc() : ::operator new(sz);
+}
+
+void Chunk::operator delete(void* ptr, size_t sz) {
+    if (sz == sizeof(Chunk)) {
+        getChunkArena()->free(ptr);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+void Chunk::compact() {
+    for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+        ChunkSection& sec = sections[i];
+        // shared storage can't be modified (and was already compacted by whoever shared it)
+        if (sec.blocks == NULL || sec.blocks->isShared()) continue;
+
+        sec.blocks->compact();
+
+        // if only a single value remains, the section no longer needs storage
+        if (sec.blocks->lbits < 4 && sec.blocks->paletteSize == 1) {
+            sec.fill = sec.blocks->palette[0];
+            sec.release();
+        }
+    }
+}
+
+void Chunk::fillBox(int x0, int y0, int z0, int x1, int y1, int z1, BlockData val) {
+    // clamp to the chunk
+    x0 = glm::max(x0, 0); x1 = glm::min(x1, CHUNK_SIZE_X);
+    y0 = glm::max(y0, 0); y1 = glm::min(y1, CHUNK_SIZE_Y);
+    z0 = glm::max(z0, 0); z1 = glm::min(z1, CHUNK_SIZE_Z);
+    if (x0 >= x1 || y0 >= y1 || z0 >= z1) return;
+
+    uint32_t touched = 0;
+    for (int sy = y0 / SECTION_SIZE_Y; sy <= (y1 - 1) / SECTION_SIZE_Y; ++sy) {
+        ChunkSection& sec = sections[sy];
+        touched |= 1u << sy;
+
+        // the part of the box within this section
+        int sy0 = glm::max(y0, sy * SECTION_SIZE_Y), sy1 = glm::min(y1, (sy + 1) * SECTION_SIZE_Y);
+        bool fullY = sy0 == sy * SECTION_SIZE_Y && sy1 == (sy + 1) * SECTION_SIZE_Y;
+        bool fullXZ = x0 == 0 && x1 == CHUNK_SIZE_X && z0 == 0 && z1 == CHUNK_SIZE_Z;
+
+        if (fullY && fullXZ) {
+            // the whole section is replaced, so it doesn't need any storage
+            sec.release();
+            sec.fill = val;
+            continue;
+        }
+
+        if (sec.blocks == NULL) {
+            // nothing would change
+            if (sec.fill == val) continue;
+            sec.blocks = new BlockStorage(SECTION_NUM_BLOCKS, sec.fill);
+        } else {
+            sec.makeUnique();
+        }
+
+        if (fullY && z0 == 0 && z1 == CHUNK_SIZE_Z) {
+            // entries are ordered XZY, so whole YZ slices are a single run
+            sec.blocks->fill(getSectionIndex(x0, sy0, 0), getSectionIndex(x1 - 1, sy1 - 1, CHUNK_SIZE_Z - 1) + 1, val);
+        } else {
+            // otherwise, each column is a run
+            for (int x = x0; x < x1; ++x) {
+                for (int z = z0; z < z1; ++z) {
+                    sec.blocks->fill(getSectionIndex(x, sy0, z), getSectionIndex(x, sy1 - 1, z) + 1, val);
+                }
+            }
+        }
+    }
+
+    // the bits of the box in each word of a column bitset
+    uint64_t bits[CHUNK_COLUMN_WORDS];
+    for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) {
+        int b0 = glm::clamp(y0 - 64 * w, 0, 64), b1 = glm::clamp(y1 - 64 * w, 0, 64);
+        bits[w] = (b1 == 64 ? ~0ULL : (1ULL << b1) - 1) & ~(b0 == 64 ? ~0ULL : (1ULL << b0) - 1);
+    }
+
+    // update the columns a whole word at a time
+    bool fillSolid = val.id != ID::AIR;
+    for (int x = x0; x < x1; ++x) {
+        for (int z = z0; z < z1; ++z) {
+            int col = getColumnIndex(x, z);
+            for (int w = y0 >> 6; w <= (y1 - 1) >> 6; ++w) {
+                if (fillSolid) solid[col][w] |= bits[w];
+                else solid[col][w] &= ~bits[w];
+            }
+            if (fillSolid) {
+                if (y1 - 1 > heightmap[col]) heightmap[col] = y1 - 1;
+            } else if (heightmap[col] >= y0 && heightmap[col] < y1) {
+                heightmap[col] = calcHeight(solid[col]);
+            }
+        }
+    }
+
+    // bump the rest of the version counters, once for the whole box
+    versions.all++;
+    if (x0 == 0) versions.borders[BORDER_L]++;
+    if (x1 == CHUNK_SIZE_X) versions.borders[BORDER_R]++;
+    if (z0 == 0) versions.borders[BORDER_B]++;
+    if (z1 == CHUNK_SIZE_Z) versions.borders[BORDER_T]++;
+
+    editedSections |= touched;
+    if (rcache.isDirty) {
+        // expand dirtyMin/Max
+        rcache.dirtyMin = glm::min(rcache.dirtyMin, vec3i(x0, y0, z0));
+        rcache.dirtyMax = glm::max(rcache.dirtyMax, vec3i(x1 - 1, y1 - 1, z1 - 1));
+    } else {
+        // start the dirty box
+        rcache.isDirty = true;
+        rcache.dirtyMin = vec3i(x0, y0, z0);
+        rcache.dirtyMax = vec3i(x1 - 1, y1 - 1, z1 - 1);
+    }
+}
+
+void Chunk::rebuildColumns() {
+    memset(solid, 0, sizeof(solid));
+    for (int sy = 0; sy < CHUNK_NUM_SECTIONS; ++sy) {
+        const ChunkSection& sec = sections[sy];
+        int y0 = sy * SECTION_SIZE_Y;
+        uint64_t secBits = ((1ULL << SECTION_SIZE_Y) - 1) << (y0 & 63);
+
+        if (sec.blocks == NULL) {
+            if (sec.fill.id == ID::AIR) continue;
+            for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z; ++i) solid[i][y0 >> 6] |= secBits;
+            continue;
+        }
+
+        // decide which palette entries are air once, rather than for every block
+        const BlockStorage* blocks = sec.blocks;
+        bool isAir[256];
+        for (int i = 0; i < blocks->paletteSize && blocks->lbits < 4; ++i) isAir[i] = blocks->palette[i].id == ID::AIR;
+
+        // sections are ordered XZY too, so every 'SECTION_SIZE_Y' entries are the next column
+        for (int i = 0; i < SECTION_NUM_BLOCKS; ++i) {
+            uint32_t raw = blocks->getRaw(i);
+            bool air = blocks->lbits == 4 ? BlockData::unpack(raw).id == ID::AIR : isAir[raw];
+            if (!air) solid[i / SECTION_SIZE_Y][y0 >> 6] |= 1ULL << ((y0 & 63) + i % SECTION_SIZE_Y);
+        }
+    }
+
+    for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z; ++i) heightmap[i] = calcHeight(solid[i]);
+}
+
+// set 'sides' (indexed by 'Chunk::Border') to the solid bits of the columns next to the column at local
+//   'x', 'z' of 'chunk', which may be in a neighboring chunk. Neighbors that aren't loaded have no faces
+//   facing them, so they use 'allSolid'
+static void getSideColumns(const Chunk* chunk, int x, int z, const uint64_t* allSolid, const uint64_t* sides[4]) {
+    const Chunk* cL = chunk->rcache.cL, *cT = chunk->rcache.cT, *cR = chunk->rcache.cR, *cB = chunk->rcache.cB;
+    sides[Chunk::BORDER_L] = x > 0 ? chunk->solid[chunk->getColumnIndex(x - 1, z)] : cL != NULL ? cL->solid[cL->getColumnIndex(CHUNK_SIZE_X - 1, z)] : allSolid;
+    sides[Chunk::BORDER_R] = x < CHUNK_SIZE_X - 1 ? chunk->solid[chunk->getColumnIndex(x + 1, z)] : cR != NULL ? cR->solid[cR->getColumnIndex(0, z)] : allSolid;
+    sides[Chunk::BORDER_B] = z > 0 ? chunk->solid[chunk->getColumnIndex(x, z - 1)] : cB != NULL ? cB->solid[cB->getColumnIndex(x, CHUNK_SIZE_Z - 1)] : allSolid;
+    sides[Chunk::BORDER_T] = z < CHUNK_SIZE_Z - 1 ? chunk->solid[chunk->getColumnIndex(x, z + 1)] : cT != NULL ? cT->solid[cT->getColumnIndex(x, 0)] : allSolid;
+}
+
+void Chunk::getExposed(int x, int z, uint64_t* out) const {
+    uint64_t allSolid[CHUNK_COLUMN_WORDS];
+    for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) allSolid[w] = ~0ULL;
+    const uint64_t* sides[4];
+    getSideColumns(this, x, z, allSolid, sides);
+
+    const uint64_t* mask = solid[getColumnIndex(x, z)];
+    for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) {
+        // the blocks above and below each block, carrying across words (and air past the ends)
+        uint64_t above = (mask[w] >> 1) | (w < CHUNK_COLUMN_WORDS - 1 ? mask[w + 1] << 63 : 0);
+        uint64_t below = (mask[w] << 1) | (w > 0 ? mask[w - 1] >> 63 : 0);
+        out[w] = mask[w] & ~(above & below & sides[BORDER_L][w] & sides[BORDER_T][w] & sides[BORDER_R][w] & sides[BORDER_B][w]);
+    }
+}
+
+void Chunk::getFaces(int x, int z, uint64_t out[SIDE_NUM][CHUNK_COLUMN_WORDS]) const {
+    uint64_t allSolid[CHUNK_COLUMN_WORDS];
+    for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) allSolid[w] = ~0ULL;
+    const uint64_t* sides[4];
+    getSideColumns(this, x, z, allSolid, sides);
+
+    const uint64_t* mask = solid[getColumnIndex(x, z)];
+    for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) {
+        uint64_t above = (mask[w] >> 1) | (w < CHUNK_COLUMN_WORDS - 1 ? mask[w + 1] << 63 : 0);
+        uint64_t below = (mask[w] << 1) | (w > 0 ? mask[w - 1] >> 63 : 0);
+        for (int i = 0; i < 4; ++i) out[i][w] = mask[w] & ~sides[i][w];
+        out[SIDE_UP][w] = mask[w] & ~above;
+        out[SIDE_DOWN][w] = mask[w] & ~below;
+    }
+}
+
+Chunk* Chunk::clone(ChunkID id) const {
+    Chunk* res = new Chunk();
+    res->XZ = id;
+    for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+        res->sections[i].fill = sections[i].fill;
+        res->sections[i].blocks = sections[i].blocks != NULL ? sections[i].blocks->acquire() : NULL;
+    }
+
+    memcpy(res->heightmap, heightmap, sizeof(heightmap));
+    memcpy(res->solid, solid, sizeof(solid));
+
+    res->versions = versions;
+    res->cleanVersion = cleanVersion;
+    res->editedSections = editedSections;
+    return res;
+}
+
+
 /* LOGGING */
 
 // current logging level (default to just 'info')
@@ -287,7 +707,7 @@ bool initAll() {
     blok_trace("sizeof(BlockData)==%ib", (int)sizeof(BlockData));
     blok_trace("sizeof(ID)==%ib", (int)sizeof(ID));
     int cb = CHUNK_NUM_BLOCKS * sizeof(BlockData);
-    blok_trace("Chunk size: %ix%ix%i (%i blocks) (%ib, %ikb)", CHUNK_SIZE_X, CHUNK_SIZE_Y, CHUNK_SIZE_Z, CHUNK_NUM_BLOCKS, cb, cb / 1024);
+    blok_trace("Chunk size: %ix%ix%i (%i blocks) (%ib, %ikb uncompressed)", CHUNK_SIZE_X, CHUNK_SIZE_Y, CHUNK_SIZE_Z, CHUNK_NUM_BLOCKS, cb, cb / 1024);
 
 
     // give a helpful message
@@ -304,12 +724,202 @@ bool initAll() {
 /* COMMANDLINE APP */
 
 #include <Blok/Random.hh>
+#include <Blok/NoiseGraph.hh>
 #include <Blok/Server.hh>
 #include <Blok/Client.hh>
 
 using namespace Blok;
 
 
+// time 'N' lookups of random (present) keys from 'keys' in a 'Map' and a 'HashMap', for the hash
+//   table tests
+template<typename K>
+static void benchLookups(const char* name, const List<K>& keys, int N, Random::XorShift& rnd) {
+    Map<K, int> treeMap;
+    HashMap<K, int> hashMap;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        treeMap[keys[i]] = i;
+        hashMap[keys[i]] = i;
+    }
+
+    // look up in a random order, so neither gets lucky with the cache
+    List<int> order;
+    for (int i = 0; i < N; ++i) order.push_back(rnd.getU32() % keys.size());
+
+    long long sumTree = 0, sumHash = 0;
+    double st = getTime();
+    for (int i : order) sumTree += treeMap.find(keys[i])->second;
+    double t_tree = getTime() - st;
+
+    st = getTime();
+    for (int i : order) sumHash += hashMap.find(keys[i])->second;
+    double t_hash = getTime() - st;
+
+    printf("%s (%i keys): Map: %.1lfm lookups/sec, HashMap: %.1lfm lookups/sec (%.1lfx faster, %s)\n", name, (int)keys.size(),
+        N / (1e6 * t_tree), N / (1e6 * t_hash), t_tree / t_hash, sumTree == sumHash ? "same results" : "different results!");
+}
+
+// return the number of bytes of block storage used by 'chunks', counting storage that is shared
+//   between sections only once
+static size_t storageBytes(const List<Chunk*>& chunks) {
+    HashSet<const BlockStorage*> seen;
+    size_t res = 0;
+    for (const Chunk* chunk : chunks) {
+        for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+            const BlockStorage* blocks = chunk->sections[i].blocks;
+            if (blocks != NULL && seen.insert(blocks).second) res += sizeof(BlockStorage) + blocks->getBytes();
+        }
+    }
+    return res;
+}
+
+// evict just 'chunk' from 'server', by using every other loaded chunk during a new 'frame', and return
+//   whether it was evicted (afterwards, 'chunk' may have been freed)
+static bool evictOnly(LocalServer* server, Chunk* chunk) {
+    int maxChunks = server->budget.maxChunks;
+    size_t maxBytes = server->budget.maxBytes;
+    server->budget.maxChunks = 0;
+    server->budget.maxBytes = 0;
+    server->evictChunks();
+
+    for (Chunk* other : server->loadedChunks) {
+        if (other != chunk) server->getChunk(other->XZ, false);
+    }
+    ChunkID id = chunk->XZ;
+    server->budget.maxChunks = server->loadedChunks.size() - 1;
+    server->evictChunks();
+
+    server->budget.maxChunks = maxChunks;
+    server->budget.maxBytes = maxBytes;
+    return server->getChunk(id, false) == NULL;
+}
+
+// return the number of columns in 'chunk' whose height or solid bits (see `Chunk::solid`) don't match
+//   its blocks
+static int countColumnErrors(const Chunk* chunk) {
+    int res = 0;
+    for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+        for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+            uint64_t mask[CHUNK_COLUMN_WORDS] = { 0 };
+            int height = -1;
+            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+                if (chunk->get(x, y, z).id == ID::AIR) continue;
+                mask[y >> 6] |= 1ULL << (y & 63);
+                height = y;
+            }
+            if (height != chunk->getHeight(x, z) || memcmp(mask, chunk->solid[chunk->getColumnIndex(x, z)], sizeof(mask)) != 0) res++;
+        }
+    }
+    return res;
+}
+
+// return whether the block at local 'x, y, z' of 'chunk' (which may be in a neighbor, through 'rcache')
+//   is not air, by looking at the block itself. Above and below the chunk is air, and neighbors that
+//   aren't loaded are solid (the same as `Chunk::getExposed()`)
+static bool isSolidNear(const Chunk* chunk, int x, int y, int z) {
+    if (y < 0 || y >= CHUNK_SIZE_Y) return false;
+    if (x < 0) { chunk = chunk->rcache.cL; x += CHUNK_SIZE_X; }
+    else if (x >= CHUNK_SIZE_X) { chunk = chunk->rcache.cR; x -= CHUNK_SIZE_X; }
+    else if (z < 0) { chunk = chunk->rcache.cB; z += CHUNK_SIZE_Z; }
+    else if (z >= CHUNK_SIZE_Z) { chunk = chunk->rcache.cT; z -= CHUNK_SIZE_Z; }
+    return chunk == NULL || chunk->get(x, y, z).id != ID::AIR;
+}
+
+// rasterize the quads of a mesh from `Render::ChunkMesh::build()` back into the faces they cover, as a
+//   map (for each direction the faces point in, as 2*axis + whether it is positive) from the packed
+//   world position of the block to its face key (the block ID << 8, and the ambient occlusion at each
+//   corner in 2 bits, like `calcFaceKey()` in render/ChunkMesh.cc). Returns the number of faces that
+//   were covered more than once
+static int rasterizeMesh(const List<Render::ChunkMeshVertex>& vertices, Map<uint64_t, uint16_t> out[Chunk::SIDE_NUM]) {
+    int n_overlap = 0;
+
+    // every quad is 4 vertices: the first at its smallest corner, then one step along 'v', one along 'u',
+    //   and one along both
+    for (size_t q = 0; q + 3 < vertices.size(); q += 4) {
+        const Render::ChunkMeshVertex* vs = &vertices[q];
+        vec3i normal = vec3i(glm::round(vs[0].N));
+        vec3i dv = vec3i(glm::round(vs[1].pos - vs[0].pos)), du = vec3i(glm::round(vs[2].pos - vs[0].pos));
+        int axis = normal.x != 0 ? 0 : normal.y != 0 ? 1 : 2;
+        int side = 2 * axis + (normal[axis] > 0 ? 1 : 0);
+
+        // faces on the positive sides are on the far side of the block
+        vec3i base = vec3i(glm::round(vs[0].pos)) - glm::max(normal, vec3i(0));
+
+        // undo the height shading to get how lit each corner is (3 minus how many solid blocks touch it)
+        double light[4];
+        for (int k = 0; k < 4; ++k) light[k] = 3.0 * vs[k].ao / (0.75 + 0.35 * vs[k].pos.y / CHUNK_SIZE_Y);
+
+        int w = glm::max(abs(du.x), glm::max(abs(du.y), abs(du.z))), h = glm::max(abs(dv.x), glm::max(abs(dv.y), abs(dv.z)));
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                vec3i pos = base + (du / w) * i + (dv / h) * j;
+                uint64_t packed = ((uint64_t)(uint32_t)(pos.x + (1 << 20)) << 42) | ((uint64_t)(uint32_t)pos.y << 21) | (uint64_t)(uint32_t)(pos.z + (1 << 20));
+
+                // the ambient occlusion is interpolated across the quad, so take what it is at the corners
+                //   of this block, which only matches the block's own if the quad was merged correctly
+                uint16_t key = (int)round(vs[0].blockID) << 8;
+                for (int k = 0; k < 4; ++k) {
+                    double fu = (i + ((k & 2) ? 1 : 0)) / (double)w, fv = (j + ((k & 1) ? 1 : 0)) / (double)h;
+                    double l = (1 - fu) * ((1 - fv) * light[0] + fv * light[1]) + fu * ((1 - fv) * light[2] + fv * light[3]);
+                    key |= (3 - (int)round(l)) << (2 * k);
+                }
+                if (!out[side].insert({ packed, key }).second) n_overlap++;
+            }
+        }
+    }
+    return n_overlap;
+}
+
+// mesh the chunks in the middle of the 'W*W' grid 'chunks' (in X-major order, and connected to each other
+//   like the renderer does) with both meshers, print how big the meshes are, and check that they cover
+//   exactly the same faces
+static void benchMeshing(const char* name, const List<Chunk*>& chunks, int W) {
+    List<Render::ChunkMeshVertex> vertices;
+    List<Render::Face> faces;
+    Render::ChunkMesh::Mode modes[] = { Render::ChunkMesh::MODE_NAIVE, Render::ChunkMesh::MODE_GREEDY };
+    int n_verts[2] = { 0 }, n_tris[2] = { 0 }, n_counted = 0, n_overlap = 0;
+    double t_build[2] = { 0.0 };
+    Map<uint64_t, uint16_t> covered[2][Chunk::SIDE_NUM];
+
+    for (int m = 0; m < 2; ++m) {
+        for (int i = 1; i < W - 1; ++i) {
+            for (int j = 1; j < W - 1; ++j) {
+                double st = getTime();
+                int n_naive = Render::ChunkMesh::build(chunks[i * W + j], modes[m], vertices, faces);
+                t_build[m] += getTime() - st;
+
+                if (m == 1) n_counted += n_naive;
+                n_verts[m] += vertices.size();
+                n_tris[m] += faces.size();
+
+                n_overlap += rasterizeMesh(vertices, covered[m]);
+            }
+        }
+    }
+
+    // every face should be covered by the greedy mesh exactly like the naive one, with the same block and
+    //   ambient occlusion
+    int n_faces = 0, n_diff = n_overlap;
+    for (int s = 0; s < Chunk::SIDE_NUM; ++s) {
+        n_faces += covered[0][s].size();
+        for (const Pair<const uint64_t, uint16_t>& it : covered[0][s]) {
+            auto found = covered[1][s].find(it.first);
+            if (found == covered[1][s].end() || found->second != it.second) n_diff++;
+        }
+        for (const Pair<const uint64_t, uint16_t>& it : covered[1][s]) {
+            if (covered[0][s].find(it.first) == covered[0][s].end()) n_diff++;
+        }
+    }
+
+    int num = (W - 2) * (W - 2);
+    size_t bytes[2];
+    for (int m = 0; m < 2; ++m) bytes[m] = n_verts[m] * sizeof(Render::ChunkMeshVertex) + n_tris[m] * sizeof(Render::Face);
+    printf("%s: naive: %i tris/chunk, %.1lfkb/chunk in %.3lfms/chunk, greedy: %i tris/chunk, %.1lfkb/chunk in %.3lfms/chunk\n", name,
+        n_tris[0] / num, bytes[0] / (1024.0 * num), 1e3 * t_build[0] / num, n_tris[1] / num, bytes[1] / (1024.0 * num), 1e3 * t_build[1] / num);
+    printf("  %.1lfx fewer triangles, %.1lfx less to upload (%i faces, %i differ, %s)\n", (double)n_tris[0] / n_tris[1], (double)bytes[0] / bytes[1],
+        n_faces, n_diff, n_counted == n_tris[0] ? "same naive count" : "different naive count!");
+}
+
 // run a check of algorithms
 void runTests() {
     int N = 1000000, B = 4;
@@ -374,7 +984,7 @@ void runTests() {
     printf("\n -*- 4: Raycasts (N=%i) -*-\n", N/100);
 
     // construct a new server
-    Server* server = new LocalServer();
+    LocalServer* server = new LocalServer();
 
 
     int ch_N = 4;
@@ -385,13 +995,7 @@ void runTests() {
         }
     }
 
-    bool still = true;
-
-    while (still) {
-        server->L_chunks.lock();
-        still = server->chunkRequests.size() > 0 || server->chunkRequestsInProgress.size() > 0;
-        server->L_chunks.unlock();
-    }
+    while (server->hasPendingRequests()) ;
 
     // make sure they are all loaded
     //while (server->processChunkRequests(1.0) > 0) ;
@@ -415,8 +1019,1056 @@ void runTests() {
 
     printf("Raycasts: %i hits (%%%i) %.2lfkcasts/sec\n", hits, 100 * hits / (N / 100), (N / 100.0) / (1000.0 * st));
 
+    printf("\n -*- 5: Chunk memory (N=%i) -*-\n", (int)server->loadedChunks.size());
+
+    // compare the palette-compressed chunks to a flat array of BlockData
+    size_t memUsed = 0, memFlat = 0;
+    for (Chunk* chunk : server->loadedChunks) {
+        memUsed += chunk->getMemoryUsage();
+        memFlat += sizeof(Chunk) + CHUNK_NUM_BLOCKS * sizeof(BlockData);
+    }
+
+    printf("Memory: %.1lfkb/chunk (flat: %.1lfkb/chunk, %.1lfx smaller)\n", memUsed / (1024.0 * server->loadedChunks.size()), memFlat / (1024.0 * server->loadedChunks.size()), (double)memFlat / memUsed);
+
+    // the arenas should have most of their slots in use, otherwise chunk storage is fragmenting
+    size_t arenaUsed, arenaMapped;
+    getArenaStats(arenaUsed, arenaMapped);
+    printf("Arenas: %i slots in use, %.1lfmb mapped\n", (int)arenaUsed, arenaMapped / (1024.0 * 1024.0));
+
+    printf("\n -*- 6: Chunk generation (workers=%i) -*-\n", (int)server->workers.size());
+
+    // now, load a much larger area, around what is already loaded
+    int gen_N = 12;
+    int n_before = server->loadedChunks.size();
+    int n_locksBefore = server->lockStats.n_locks;
+    double t_heldBefore = server->lockStats.t_held;
+    st = getTime();
+    for (int X = -gen_N; X <= gen_N; ++X) {
+        for (int Z = -gen_N; Z <= gen_N; ++Z) {
+            server->getChunk({X, Z});
+        }
+    }
+
+    // while the workers publish chunks, keep looking up the ones that are already loaded (like the
+    //   client does every frame), which should never have to wait on them
+    // NOTE: only check whether they are done every so often, which takes the lock
+    int n_lookups = 0, n_found = 0;
+    double t_lookups = 0.0;
+    do {
+        double lt = getTime();
+        for (int i = 0; i < 64; ++i) {
+            for (int X = -ch_N; X <= ch_N; ++X) {
+                for (int Z = -ch_N; Z <= ch_N; ++Z) {
+                    if (server->getChunk({X, Z}, false) != NULL) n_found++;
+                    n_lookups++;
+                }
+            }
+        }
+        t_lookups += getTime() - lt;
+    } while (server->hasPendingRequests());
+    st = getTime() - st;
+
+    for (LocalServer::Worker* w : server->workers) {
+        int n_chunks = w->stats.n_chunks;
+        double t_chunks = w->stats.t_chunks;
+        printf("Worker %i: %i chunks, %.3lfms/chunk\n", w->idx, n_chunks, n_chunks > 0 ? 1e3 * t_chunks / n_chunks : 0.0);
+    }
+    printf("Speed %.1lfchunks/sec\n", (server->loadedChunks.size() - n_before) / st);
+    printf("Lookups: %.1lfm/sec during generation (%s)\n", n_lookups / (1e6 * t_lookups), n_found == n_lookups ? "all found" : "some missing!");
+
+    int n_locks = server->lockStats.n_locks - n_locksBefore;
+    printf("L_chunks: %i locks, %.3lfus held on average (%.3lfus max overall)\n", n_locks,
+        n_locks > 0 ? 1e6 * (server->lockStats.t_held - t_heldBefore) / n_locks : 0.0, 1e6 * server->lockStats.t_maxHeld);
+
+    printf("\n -*- 7: Chunk eviction -*-\n");
+
+    // edit a chunk, which should never be evicted
+    Chunk* edited = server->getChunk({gen_N, gen_N}, false);
+    edited->set(0, 0, 0, BlockData(ID::AIR));
+
+    // end a 'frame' (everything was requested during it, so nothing is evicted), and then keep
+    //   using the center in the next one, which should keep it around
+    int n_loaded = server->loadedChunks.size();
+    server->budget.maxChunks = n_loaded / 4;
+    server->evictChunks();
+    server->getChunk({0, 0}, false);
+
+    getArenaStats(arenaUsed, arenaMapped);
+    size_t arenaUsedBefore = arenaUsed;
+
+    st = getTime();
+    int n_evicted = server->evictChunks();
+    st = getTime() - st;
+
+    getArenaStats(arenaUsed, arenaMapped);
+    printf("Evicted %i/%i chunks in %.3lfms (edited chunk kept: %s, recent chunk kept: %s)\n", n_evicted, n_loaded, 1e3 * st,
+        server->getChunk({gen_N, gen_N}, false) == edited ? "yes" : "no", server->getChunk({0, 0}, false) != NULL ? "yes" : "no");
+    printf("Arenas: %i slots freed for reuse, %.1lfmb mapped\n", (int)(arenaUsedBefore - arenaUsed), arenaMapped / (1024.0 * 1024.0));
+
+    // evict two neighbors, after the renderer has stopped drawing the one evicted first, and relinked the
+    //   other one (so only one side still links to the other), with each on either side
+    int n_linkEvicted = 0, n_stale = 0;
+    for (int order = 0; order < 2; ++order) {
+        ChunkID dir = order == 0 ? ChunkID(1, 0) : ChunkID(-1, 0);
+        Chunk* first = NULL, *second = NULL;
+        for (Chunk* chunk : server->loadedChunks) {
+            Chunk* other = server->loadedChunks.find(chunk->XZ + dir);
+            if (chunk != edited && other != NULL && other != edited) {
+                first = chunk;
+                second = other;
+                break;
+            }
+        }
+        if (first == NULL) continue;
+
+        Chunk*& toSecond = order == 0 ? first->rcache.cR : first->rcache.cL;
+        Chunk*& toFirst = order == 0 ? second->rcache.cL : second->rcache.cR;
+        toSecond = NULL;
+        toFirst = first;
+
+        if (evictOnly(server, first)) n_linkEvicted++;
+        if (toFirst != NULL) n_stale++;
+        if (evictOnly(server, second)) n_linkEvicted++;
+
+        // nothing else should have been written to while they were freed
+        for (Chunk* chunk : server->loadedChunks) {
+            Chunk* links[4] = { chunk->rcache.cL, chunk->rcache.cT, chunk->rcache.cR, chunk->rcache.cB };
+            for (int i = 0; i < 4; ++i) if (links[i] == first || links[i] == second) n_stale++;
+        }
+    }
+    printf("Neighbors: evicted %i/4 linked chunks, %i stale links left\n", n_linkEvicted, n_stale);
+
+    printf("\n -*- 8: Region files -*-\n");
+
+    List<Chunk*> saved;
+    for (Chunk* chunk : server->loadedChunks) saved.push_back(chunk);
+
+    // lightly edit every chunk, like a player would
+    for (Chunk* chunk : saved) {
+        for (int i = 0; i < 8; ++i) {
+            chunk->set(rnd.getU32() % CHUNK_SIZE_X, 40 + rnd.getU32() % 40, rnd.getU32() % CHUNK_SIZE_Z, BlockData(ID::AIR));
+        }
+    }
+
+    server->updateStats();
+    printf("Generating: %.3lfms/chunk\n", 1e3 * server->stats.t_chunks / server->stats.n_chunks);
+
+    // now, save them in each mode
+    Save::RegionStore::Mode modes[] = { Save::RegionStore::MODE_FULL, Save::RegionStore::MODE_DELTA };
+    const char* modeNames[] = { "Full", "Delta" };
+    for (int m = 0; m < 2; ++m) {
+        char worldTmp[256];
+        snprintf(worldTmp, sizeof(worldTmp), "/tmp/blok-test-%i-%i", (int)getpid(), m);
+        Save::RegionStore* store = new Save::RegionStore(worldTmp, modes[m], server->worldGen);
+
+        st = getTime();
+        for (Chunk* chunk : saved) {
+            store->saveChunk(chunk);
+        }
+        store->sync();
+        double t_save = getTime() - st;
+
+        // and read them back, making sure they are identical
+        int n_bad = 0;
+        st = getTime();
+        List<Chunk*> loaded;
+        for (Chunk* chunk : saved) {
+            loaded.push_back(store->loadChunk(chunk->XZ));
+        }
+        double t_load = getTime() - st;
+
+        for (size_t i = 0; i < saved.size(); ++i) {
+            bool isSame = loaded[i] != NULL;
+            for (int x = 0; x < CHUNK_SIZE_X && isSame; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z && isSame; ++z) {
+                    for (int y = 0; y < CHUNK_SIZE_Y && isSame; ++y) {
+                        isSame = loaded[i]->get(x, y, z) == saved[i]->get(x, y, z);
+                    }
+                }
+            }
+            if (!isSame) n_bad++;
+            if (loaded[i] != NULL) delete loaded[i];
+        }
+
+        // measure how much space they took up on disk
+        size_t diskBytes = 0;
+        Set<String> regionPaths;
+        for (Chunk* chunk : saved) {
+            int idx;
+            regionPaths.insert(store->getRegionPath(Save::RegionStore::getRegionID(chunk->XZ, idx)));
+        }
+        for (const String& path : regionPaths) {
+            struct stat fst;
+            if (stat(path.c_str(), &fst) == 0) diskBytes += fst.st_size - REGION_HEADER_SECTORS * REGION_SECTOR_SIZE;
+        }
+
+        printf("%s: saved %i chunks in %.3lfms (%.3lfkb/chunk on disk), loaded in %.3lfms/chunk, %i differed\n", modeNames[m], (int)saved.size(), 1e3 * t_save,
+            diskBytes / (1024.0 * saved.size()), 1e3 * t_load / saved.size(), n_bad);
+
+        // deltas saved against one generator must not be applied to another's chunks
+        if (modes[m] == Save::RegionStore::MODE_DELTA) {
+            WG::DefaultWG otherGen(1);
+            Save::RegionStore* other = new Save::RegionStore(worldTmp, modes[m], &otherGen);
+            Chunk* chunk = other->loadChunk(saved[0]->XZ);
+            printf("Other generator: %s\n", chunk == NULL ? "refused" : "loaded");
+            if (chunk != NULL) delete chunk;
+            delete other;
+        }
+
+        // clean up the temporary world
+        delete store;
+        for (const String& path : regionPaths) {
+            remove(path.c_str());
+        }
+        rmdir(worldTmp);
+    }
+
     delete server;
-    
+
+    // look up the neighbors of every chunk in a view disc (like the renderer does every frame), from
+    //   a map, and from a grid around the center
+    int disc_N = 10;
+    List<ChunkID> disc;
+    for (int X = -disc_N; X <= disc_N; ++X) {
+        for (int Z = -disc_N; Z <= disc_N; ++Z) {
+            if (X * X + Z * Z <= disc_N * disc_N) disc.push_back({X + 3, Z - 5});
+        }
+    }
+
+    printf("\n -*- 9: Chunk neighbors (disc of %i chunks, radius %i) -*-\n", (int)disc.size(), disc_N);
+
+    Map<ChunkID, Chunk*> discMap;
+    ChunkGrid<Chunk*> discGrid;
+    discGrid.recenter({3, -5});
+    for (ChunkID id : disc) {
+        // NOTE: the values are never dereferenced
+        discMap[id] = (Chunk*)(uintptr_t)(16 * (disc.size() + id.X * 64 + id.Z));
+        discGrid.set(id, discMap[id]);
+    }
+
+    ChunkID dirs[4] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+    uintptr_t sumMap = 0, sumGrid = 0;
+    int rounds = N / (4 * disc.size());
+
+    st = getTime();
+    for (int r = 0; r < rounds; ++r) {
+        for (ChunkID id : disc) {
+            for (int d = 0; d < 4; ++d) {
+                auto it = discMap.find(id + dirs[d]);
+                if (it != discMap.end()) sumMap += (uintptr_t)it->second;
+            }
+        }
+    }
+    double t_map = getTime() - st;
+
+    st = getTime();
+    for (int r = 0; r < rounds; ++r) {
+        for (ChunkID id : disc) {
+            for (int d = 0; d < 4; ++d) {
+                sumGrid += (uintptr_t)discGrid.get(id + dirs[d], NULL);
+            }
+        }
+    }
+    double t_grid = getTime() - st;
+
+    int n_neighbors = rounds * 4 * disc.size();
+    printf("Map: %.1lfm lookups/sec, Grid: %.1lfm lookups/sec (%.1lfx faster, %s)\n", n_neighbors / (1e6 * t_map), n_neighbors / (1e6 * t_grid), t_map / t_grid, sumMap == sumGrid ? "same results" : "different results!");
+
+    printf("\n -*- 10: Hash tables (N=%i) -*-\n", N);
+
+    // compare them on the keys of the per-frame chunk mesh lookups and resource caches
+    List<Chunk*> ptrKeys;
+    List<ChunkID> idKeys;
+    List<String> strKeys;
+    for (int i = 0; i < 441; ++i) {
+        // NOTE: these are never dereferenced, but are spread out like real allocations
+        ptrKeys.push_back((Chunk*)(uintptr_t)(4096 + 720 * (rnd.getU32() % 100000)));
+        idKeys.push_back({(int)(rnd.getU32() % 64) - 32, (int)(rnd.getU32() % 64) - 32});
+    }
+    for (int i = 0; i < 64; ++i) {
+        strKeys.push_back("assets/tex/block/" + std::to_string(rnd.getU32()) + ".png");
+    }
+
+    benchLookups("Chunk*", ptrKeys, N, rnd);
+    benchLookups("ChunkID", idKeys, N, rnd);
+    benchLookups("String", strKeys, N, rnd);
+
+    printf("\n -*- 11: View subscriptions -*-\n");
+
+    // keep a view up to date like the client does, once by asking for every chunk in view each frame,
+    //   and once by subscribing to it
+    server = new LocalServer();
+    int view_N = 10;
+    ChunkID center = {0, 0};
+    Subscription* view = server->subscribe(center, view_N);
+    ChunkGrid<Chunk*> visible;
+
+    // take in events until nothing is left to do
+    int n_entered = 0, n_left = 0;
+    auto drainView = [&]() {
+        ChunkEvent ev;
+        while (view->events.pop(ev)) {
+            if (ev.kind == ChunkEvent::EVENT_LEFT_VIEW) {
+                visible.erase(ev.id);
+                n_left++;
+            } else {
+                visible.set(ev.id, ev.chunk);
+                if (ev.kind == ChunkEvent::EVENT_READY) n_entered++;
+            }
+        }
+    };
+    do {
+        drainView();
+    } while (server->hasPendingRequests());
+    drainView();
+
+    int n_view = 0;
+    for (int X = -view_N; X <= view_N; ++X) {
+        for (int Z = -view_N; Z <= view_N; ++Z) {
+            if (X * X + Z * Z <= view_N * view_N) n_view++;
+        }
+    }
+    printf("Subscribed: %i/%i chunks ready\n", visible.size(), n_view);
+
+    // now, time a frame where nothing has changed
+    int frames = 1000;
+    st = getTime();
+    int n_polled = 0;
+    for (int f = 0; f < frames; ++f) {
+        for (int X = -view_N; X <= view_N; ++X) {
+            for (int Z = -view_N; Z <= view_N; ++Z) {
+                if (X * X + Z * Z > view_N * view_N) continue;
+                if (server->getChunk(center + ChunkID(X, Z)) != NULL) n_polled++;
+            }
+        }
+    }
+    double t_poll = (getTime() - st) / frames;
+
+    st = getTime();
+    for (int f = 0; f < frames; ++f) {
+        server->moveSubscription(view, center, view_N);
+        drainView();
+    }
+    double t_sub = (getTime() - st) / frames;
+
+    printf("Idle frame: polling: %.3lfus, subscription: %.3lfus\n", 1e6 * t_poll, 1e6 * t_sub);
+
+    // walk one chunk over, which should only touch the edges of the view
+    n_entered = n_left = 0;
+    center = ChunkID(1, 0);
+    // NOTE: the move itself is timed by how long it held the lock, since on a machine with few
+    //   cores, the workers it wakes up can take over before it returns
+    st = getTime();
+    double t_heldMove = server->lockStats.t_held;
+    server->moveSubscription(view, center, view_N);
+    double t_move = server->lockStats.t_held - t_heldMove;
+    drainView();
+    do {
+        drainView();
+    } while (server->hasPendingRequests());
+    drainView();
+    st = getTime() - st;
+    printf("Moving: %i left in %.3lfus, %i entered once loaded in %.3lfms (%i/%i chunks ready)\n", n_left, 1e6 * t_move, n_entered, 1e3 * st, visible.size(), n_view);
+
+    // editing a block sends a change to the view
+    server->setBlock(vec3i(0, 100, 0), BlockData(ID::STONE));
+    ChunkEvent ev;
+    bool gotChange = view->events.pop(ev) && ev.kind == ChunkEvent::EVENT_CHANGED && ev.id == ChunkID(0, 0);
+    printf("Editing: %s\n", gotChange ? "change received" : "no change received!");
+
+    server->unsubscribe(view);
+    delete server;
+
+    printf("\n -*- 12: Chunk tickets -*-\n");
+
+    // preload an area, and hold a full ticket on its center (which also holds its neighbors)
+    server = new LocalServer();
+    ChunkID tc = {40, 40};
+    int tick_N = 4;
+    for (int X = -tick_N; X <= tick_N; ++X) {
+        for (int Z = -tick_N; Z <= tick_N; ++Z) {
+            server->addTicket(tc + ChunkID(X, Z), TICKET_PRELOAD);
+        }
+    }
+    server->addTicket(tc, TICKET_FULL);
+
+    // and an entity off on its own
+    ItemEntity* ent = new ItemEntity("test");
+    ent->pos = vec3(-800, 100, -800);
+    server->addEntity(ent);
+
+    st = getTime();
+    while (server->hasPendingRequests()) ;
+    st = getTime() - st;
+    int n_ticketed = server->loadedChunks.size();
+    printf("Loaded: %i chunks from tickets in %.3lfms (entity chunk: %s)\n", n_ticketed, 1e3 * st, server->getChunk(ChunkID::fromPos(vec3i(ent->pos)), false) != NULL ? "yes" : "no");
+
+    // squeeze the budget, which should only leave the full chunks and their borders
+    server->budget.maxChunks = 1;
+    server->evictChunks();
+    server->evictChunks();
+    int n_kept = server->loadedChunks.size(), n_held = 0;
+    for (Chunk* chunk : server->loadedChunks) {
+        if (server->getTicketLevel(chunk->XZ) >= TICKET_BORDER) n_held++;
+    }
+    printf("Over budget: kept %i/%i chunks (%i held by tickets)\n", n_kept, n_ticketed, n_held);
+
+    // move the entity, and then release everything
+    server->moveEntity(ent, ent->pos + vec3(CHUNK_SIZE_X, 0, 0));
+    while (server->hasPendingRequests()) ;
+    bool entMoved = server->getChunk(ChunkID::fromPos(vec3i(ent->pos)), false) != NULL;
+
+    server->removeEntity(ent);
+    server->removeTicket(tc, TICKET_FULL);
+    server->evictChunks();
+    server->evictChunks();
+    printf("Released: %i chunks left loaded (entity followed: %s)\n", (int)server->loadedChunks.size(), entMoved ? "yes" : "no");
+
+    delete ent;
+    delete server;
+
+    printf("\n -*- 13: World generators -*-\n");
+
+    // time the generators by themselves (on this thread), and hash what they produce, which should
+    //   never change unless the generator itself does
+    WG::DefaultWG defaultWG(0);
+    WG::FlatWG flatWG(0);
+    int wg_N = 8;
+    uint64_t h_default = 0, h_flat = 0;
+
+    st = getTime();
+    for (int X = -wg_N; X < wg_N; ++X) {
+        for (int Z = -wg_N; Z < wg_N; ++Z) {
+            Chunk* chunk = defaultWG.getChunk({X, Z});
+            h_default = 31 * h_default + chunk->calcHash();
+            delete chunk;
+        }
+    }
+    double t_default = getTime() - st;
+
+    st = getTime();
+    for (int X = -wg_N; X < wg_N; ++X) {
+        for (int Z = -wg_N; Z < wg_N; ++Z) {
+            Chunk* chunk = flatWG.getChunk({X, Z});
+            h_flat = 31 * h_flat + chunk->calcHash();
+            delete chunk;
+        }
+    }
+    double t_flat = getTime() - st;
+
+    int n_wg = 4 * wg_N * wg_N;
+    printf("DefaultWG: %.3lfms/chunk (digest: 0x%llx)\n", 1e3 * t_default / n_wg, (unsigned long long)h_default);
+    printf("FlatWG: %.3lfms/chunk (digest: 0x%llx)\n", 1e3 * t_flat / n_wg, (unsigned long long)h_flat);
+
+    // flat chunks share their storage, until they are edited
+    Chunk* flatA = flatWG.getChunk({0, 0});
+    Chunk* flatB = flatWG.getChunk({1, 0});
+    int n_shared = 0;
+    for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+        if (flatA->sections[i].blocks != NULL && flatA->sections[i].blocks == flatB->sections[i].blocks) n_shared++;
+    }
+    size_t memShared = flatA->getMemoryUsage();
+    int editY = 60;
+    BlockData before = flatB->get(0, editY, 0);
+    flatA->set(0, editY, 0, BlockData(ID::AIR));
+    printf("Copy-on-write: %i shared sections, %.1lfkb/chunk while shared (edit kept to its chunk: %s)\n", n_shared,
+        memShared / 1024.0, flatA->get(0, editY, 0) == BlockData(ID::AIR) && flatB->get(0, editY, 0) == before ? "yes" : "no");
+    delete flatA;
+    delete flatB;
+
+    // the bulk fills that the generators use should match setting each block individually
+    // First with large boxes of a few values, and then with many small boxes of so many values that
+    //   sections need 8 bit palettes, and then direct (16 bit) storage
+    int fill_boxes[] = { 2000, 40000 }, fill_sizes[] = { CHUNK_SIZE_Y, 4 }, fill_vals[] = { 12, 4096 };
+    for (int c = 0; c < 2; ++c) {
+        Chunk* bySet = new Chunk();
+        Chunk* byFill = new Chunk();
+        long long n_blocks = 0;
+        double t_set = 0.0, t_fill = 0.0;
+        for (int i = 0; i < fill_boxes[c]; ++i) {
+            int x0 = rnd.getU32() % CHUNK_SIZE_X, x1 = x0 + 1 + rnd.getU32() % glm::min(fill_sizes[c], CHUNK_SIZE_X - x0);
+            int y0 = rnd.getU32() % CHUNK_SIZE_Y, y1 = y0 + 1 + rnd.getU32() % glm::min(fill_sizes[c], CHUNK_SIZE_Y - y0);
+            int z0 = rnd.getU32() % CHUNK_SIZE_Z, z1 = z0 + 1 + rnd.getU32() % glm::min(fill_sizes[c], CHUNK_SIZE_Z - z0);
+            BlockData val = BlockData::unpack(rnd.getU32() % fill_vals[c]);
+
+            st = getTime();
+            for (int x = x0; x < x1; ++x) {
+                for (int z = z0; z < z1; ++z) {
+                    for (int y = y0; y < y1; ++y) {
+                        bySet->set(x, y, z, val);
+                    }
+                }
+            }
+            t_set += getTime() - st;
+
+            st = getTime();
+            byFill->fillBox(x0, y0, z0, x1, y1, z1, val);
+            t_fill += getTime() - st;
+            n_blocks += (x1 - x0) * (y1 - y0) * (z1 - z0);
+        }
+
+        bool sameFill = true;
+        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+                    if (bySet->get(x, y, z) != byFill->get(x, y, z)) sameFill = false;
+                }
+            }
+        }
+
+        // the widest storage any section ended up with
+        int maxBits = 0;
+        for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+            const BlockStorage* blocks = byFill->sections[i].blocks;
+            if (blocks != NULL) maxBits = glm::max(maxBits, 1 << blocks->lbits);
+        }
+
+        printf("Bulk fills: %i boxes of %i values, set(): %.1lfm blocks/sec, fillBox(): %.1lfm blocks/sec (%.1lfx faster, %s, up to %i bits/block)\n", fill_boxes[c], fill_vals[c],
+            n_blocks / (1e6 * t_set), n_blocks / (1e6 * t_fill), t_set / t_fill, sameFill ? "same blocks" : "different blocks!", maxBits);
+
+        delete bySet;
+        delete byFill;
+    }
+
+    printf("\n -*- 14: Shared sections -*-\n");
+
+    // generated terrain, and flat chunks that each have their own copy (as if they were loaded from
+    //   a region file), which is where sharing should help the most
+    List<Chunk*> terrain, flat;
+    for (int X = -wg_N; X < wg_N; ++X) {
+        for (int Z = -wg_N; Z < wg_N; ++Z) {
+            terrain.push_back(defaultWG.getChunk({X, Z}));
+            Chunk* chunk = flatWG.getChunk({X, Z});
+            for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) chunk->sections[i].makeUnique();
+            flat.push_back(chunk);
+        }
+    }
+
+    // drop the generator's staged chunks, so that only the chunks themselves are using their sections
+    defaultWG.pipeline.clear();
+
+    SectionTable* sectionTable = new SectionTable();
+    List<Chunk*>* worlds[] = { &terrain, &flat };
+    const char* worldNames[] = { "DefaultWG", "FlatWG (unshared)" };
+    for (int w = 0; w < 2; ++w) {
+        List<Chunk*>& chunks = *worlds[w];
+        uint64_t h_before = 0, h_after = 0;
+        for (Chunk* chunk : chunks) h_before = 31 * h_before + chunk->calcHash();
+        size_t bytesBefore = storageBytes(chunks);
+        int n_internedBefore = sectionTable->stats.n_interned, n_sharedBefore = sectionTable->stats.n_shared;
+
+        st = getTime();
+        for (Chunk* chunk : chunks) sectionTable->internChunk(chunk);
+        st = getTime() - st;
+
+        for (Chunk* chunk : chunks) h_after = 31 * h_after + chunk->calcHash();
+        size_t bytesAfter = storageBytes(chunks);
+        printf("%s: %i/%i sections shared, %.1lfkb -> %.1lfkb of storage (%.3lfms/chunk, %s)\n", worldNames[w],
+            sectionTable->stats.n_shared - n_sharedBefore, sectionTable->stats.n_interned - n_internedBefore,
+            bytesBefore / 1024.0, bytesAfter / 1024.0, 1e3 * st / chunks.size(), h_before == h_after ? "same blocks" : "different blocks!");
+    }
+
+    // edits copy the shared section first, so they never show up in other chunks
+    BlockData nextBefore = flat[1]->get(0, editY, 0);
+    flat[0]->set(0, editY, 0, BlockData(ID::AIR));
+    printf("Editing: %s\n", flat[1]->get(0, editY, 0) == nextBefore ? "kept to its chunk" : "leaked into other chunks!");
+
+    // once the chunks are gone, the table should be able to free everything
+    int n_distinct = sectionTable->size();
+    for (Chunk* chunk : terrain) delete chunk;
+    for (Chunk* chunk : flat) delete chunk;
+    int n_pruned = sectionTable->prune();
+    printf("Pruned: %i/%i distinct sections freed\n", n_pruned, n_distinct);
+    delete sectionTable;
+
+    printf("\n -*- 15: Batch Perlin noise -*-\n");
+
+    // sample the same areas as DefaultWG (the height map, and the cave columns), one at a time and
+    //   then as grids, which should give exactly the same results
+    // The caves are sampled at every block here, since the lattice (see section 16) is only used by grids
+    Random::PerlinMux gridCaves = defaultWG.cavegen;
+    for (Random::Perlin& layer : gridCaves.layers) layer.lattice = vec3i(1, 1, 1);
+    int grid_N = 4, n_smp2 = 0, n_smp3 = 0, n_diff = 0;
+    double maxDiff = 0.0, t_scalar2 = 0.0, t_grid2 = 0.0, t_scalar3 = 0.0, t_grid3 = 0.0;
+    List<double> one(CHUNK_SIZE_X * CHUNK_SIZE_Y * CHUNK_SIZE_Z), grid(CHUNK_SIZE_X * CHUNK_SIZE_Y * CHUNK_SIZE_Z);
+    for (int X = -grid_N; X < grid_N; ++X) {
+        for (int Z = -grid_N; Z < grid_N; ++Z) {
+            int wx = X * CHUNK_SIZE_X, wz = Z * CHUNK_SIZE_Z, ny = 99;
+
+            st = getTime();
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                    one[x * CHUNK_SIZE_Z + z] = defaultWG.pmgen.noise2d(wx + x, wz + z);
+                }
+            }
+            t_scalar2 += getTime() - st;
+            st = getTime();
+            defaultWG.pmgen.noise2dGrid(wx, wz, CHUNK_SIZE_X, CHUNK_SIZE_Z, &grid[0]);
+            t_grid2 += getTime() - st;
+
+            for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z; ++i) {
+                if (one[i] != grid[i]) n_diff++;
+                maxDiff = glm::max(maxDiff, fabs(one[i] - grid[i]));
+            }
+            n_smp2 += CHUNK_SIZE_X * CHUNK_SIZE_Z;
+
+            st = getTime();
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                    for (int y = 0; y < ny; ++y) {
+                        one[(x * CHUNK_SIZE_Z + z) * ny + y] = gridCaves.noise3d(wx + x, 1 + y, wz + z);
+                    }
+                }
+            }
+            t_scalar3 += getTime() - st;
+            st = getTime();
+            gridCaves.noise3dGrid(wx, 1, wz, CHUNK_SIZE_X, ny, CHUNK_SIZE_Z, &grid[0]);
+            t_grid3 += getTime() - st;
+
+            for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z * ny; ++i) {
+                if (one[i] != grid[i]) n_diff++;
+                maxDiff = glm::max(maxDiff, fabs(one[i] - grid[i]));
+            }
+            n_smp3 += CHUNK_SIZE_X * CHUNK_SIZE_Z * ny;
+        }
+    }
+
+    printf("noise2d: %.2lfMsmp/sec, noise2dGrid: %.2lfMsmp/sec (%.1lfx faster)\n", 1e-6 * n_smp2 / t_scalar2, 1e-6 * n_smp2 / t_grid2, t_scalar2 / t_grid2);
+    printf("noise3d: %.2lfMsmp/sec, noise3dGrid: %.2lfMsmp/sec (%.1lfx faster)\n", 1e-6 * n_smp3 / t_scalar3, 1e-6 * n_smp3 / t_grid3, t_scalar3 / t_grid3);
+    printf("Differences: %i/%i samples (max %g)\n", n_diff, n_smp2 + n_smp3, maxDiff);
+
+    printf("\n -*- 16: Cave lattice -*-\n");
+
+    // compare DefaultWG to one that samples its caves at every block (both starting with nothing staged)
+    defaultWG.pipeline.clear();
+    WG::DefaultWG denseWG(0);
+    for (Random::Perlin& layer : denseWG.cavegen.layers) layer.lattice = vec3i(1, 1, 1);
+
+    int lat_N = 2, n_compared = 0, n_differ = 0, n_carved = 0;
+    double t_dense = 0.0, t_coarse = 0.0;
+    List<Chunk*> dense, coarse;
+    for (int X = -lat_N; X < lat_N; ++X) {
+        for (int Z = -lat_N; Z < lat_N; ++Z) {
+            st = getTime();
+            dense.push_back(denseWG.getChunk({X, Z}));
+            t_dense += getTime() - st;
+            st = getTime();
+            coarse.push_back(defaultWG.getChunk({X, Z}));
+            t_coarse += getTime() - st;
+        }
+    }
+
+    // only count blocks the caves could have carved out (i.e. below the surface)
+    for (size_t c = 0; c < dense.size(); ++c) {
+        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                for (int y = 1; y < 100; ++y) {
+                    BlockData a = dense[c]->get(x, y, z), b = coarse[c]->get(x, y, z);
+                    if (a.id == ID::AIR && b.id == ID::AIR && y > 60) continue;
+                    n_compared++;
+                    if (a.id == ID::AIR) n_carved++;
+                    if (a != b) n_differ++;
+                }
+            }
+        }
+    }
+    printf("DefaultWG: %.3lfms/chunk with dense caves, %.3lfms/chunk with the lattice (%.1lfx faster)\n", 1e3 * t_dense / dense.size(), 1e3 * t_coarse / coarse.size(), t_dense / t_coarse);
+    printf("Blocks: %i/%i differ (%.2lf%%), %i carved out by dense caves\n", n_differ, n_compared, 100.0 * n_differ / n_compared, n_carved);
+
+    // and show a slice through the middle of the area, from the top down
+    // '#' is solid in both, ' ' is air in both, '-' is a cave only in the dense version, and '+' is a
+    //   cave only with the lattice
+    printf("Slice (z=0, x=%i..%i, y=96..4):\n", -lat_N * CHUNK_SIZE_X, lat_N * CHUNK_SIZE_X - 1);
+    for (int y = 96; y >= 4; y -= 4) {
+        char line[256];
+        int len = 0;
+        for (int X = 0; X < 2 * lat_N; ++X) {
+            // chunks are in X-major order, and z=0 is at the start of the chunk at Z=0
+            int c = X * 2 * lat_N + lat_N;
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                bool a = dense[c]->get(x, y, 0).id == ID::AIR, b = coarse[c]->get(x, y, 0).id == ID::AIR;
+                line[len++] = a == b ? (a ? ' ' : '#') : (a ? '-' : '+');
+            }
+        }
+        line[len] = '\0';
+        printf("  |%s|\n", line);
+    }
+
+    for (Chunk* chunk : dense) delete chunk;
+    for (Chunk* chunk : coarse) delete chunk;
+
+    printf("\n -*- 17: Noise graphs -*-\n");
+
+    // a height map made of rolling hills and (domain warped) ridges, blended by another layer, and then
+    //   shaped by a spline
+    uint32_t ng_seed = 1234;
+    Random::NoiseGraph graph;
+    int ng_hills = graph.remap(graph.fbm(ng_seed, vec3(1.0 / 256), 5), 0.0, 1.9375, 0.0, 1.0);
+    int ng_wx = graph.perlin(Random::Perlin(ng_seed + 10, vec3(1.0 / 64), vec2(0.0, 1.0), vec2(-1.0, 1.0)));
+    int ng_wz = graph.perlin(Random::Perlin(ng_seed + 11, vec3(1.0 / 64), vec2(0.0, 1.0), vec2(-1.0, 1.0)));
+    int ng_ridges = graph.remap(graph.warp(graph.fbm(ng_seed + 20, vec3(1.0 / 96), 3), ng_wx, ng_wz, -1, 12.0), 0.0, 1.75, 0.0, 1.0);
+    int ng_mix = graph.clamp(graph.remap(graph.perlin(Random::Perlin(ng_seed + 30, vec3(1.0 / 512))), 0.3, 0.7, 0.0, 1.0), 0.0, 1.0);
+    List< Pair<double, double> > ng_pts = { {0.0, 30.0}, {0.35, 58.0}, {0.5, 64.0}, {0.7, 90.0}, {1.0, 140.0} };
+    int ng_height = graph.spline(graph.blend(ng_hills, ng_ridges, ng_mix), ng_pts);
+    int ng_out = graph.max(ng_height, graph.mul(graph.constant(2.0), graph.constant(31.0)));
+    Random::NoisePlan plan = graph.compile(ng_out);
+    printf("Graph: %i nodes, compiled to %i operations using %i buffers\n", (int)graph.nodes.size(), plan.size(), plan.getNumRegs());
+
+    // the same thing written out by hand, one column at a time
+    List<Random::Perlin> hillOcts, ridgeOcts;
+    for (int i = 0; i < 5; ++i) hillOcts.push_back(Random::Perlin(ng_seed + i, vec3(1.0 / 256) * (float)(1 << i), vec2(0.0, 1.0), vec2(0.0, 1.0 / (1 << i))));
+    for (int i = 0; i < 3; ++i) ridgeOcts.push_back(Random::Perlin(ng_seed + 20 + i, vec3(1.0 / 96) * (float)(1 << i), vec2(0.0, 1.0), vec2(0.0, 1.0 / (1 << i))));
+    Random::Perlin warpX(ng_seed + 10, vec3(1.0 / 64), vec2(0.0, 1.0), vec2(-1.0, 1.0));
+    Random::Perlin warpZ(ng_seed + 11, vec3(1.0 / 64), vec2(0.0, 1.0), vec2(-1.0, 1.0));
+    Random::Perlin mixer(ng_seed + 30, vec3(1.0 / 512));
+
+    int ng_N = 8;
+    double t_hand = 0.0, t_plan = 0.0, ng_maxDiff = 0.0;
+    List<double> hand(CHUNK_SIZE_X * CHUNK_SIZE_Z), planned(CHUNK_SIZE_X * CHUNK_SIZE_Z);
+    for (int X = -ng_N; X < ng_N; ++X) {
+        for (int Z = -ng_N; Z < ng_N; ++Z) {
+            int wx = X * CHUNK_SIZE_X, wz = Z * CHUNK_SIZE_Z;
+
+            st = getTime();
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                    double px = wx + x, pz = wz + z;
+                    double hills = 0.0, ridges = 0.0;
+                    for (Random::Perlin& oct : hillOcts) hills += oct.noise2d(px, pz);
+                    double dx = 12.0 * warpX.noise2d(px, pz), dz = 12.0 * warpZ.noise2d(px, pz);
+                    for (Random::Perlin& oct : ridgeOcts) ridges += oct.noise2d(px + dx, pz + dz);
+                    hills /= 1.9375;
+                    ridges /= 1.75;
+                    double t = glm::clamp((mixer.noise2d(px, pz) - 0.3) / 0.4, 0.0, 1.0);
+                    double shape = hills + t * (ridges - hills), h = ng_pts.back().second;
+                    if (shape <= ng_pts[0].first) h = ng_pts[0].second;
+                    else for (size_t i = 1; i < ng_pts.size(); ++i) {
+                        if (shape < ng_pts[i].first) {
+                            h = ng_pts[i - 1].second + (shape - ng_pts[i - 1].first) / (ng_pts[i].first - ng_pts[i - 1].first) * (ng_pts[i].second - ng_pts[i - 1].second);
+                            break;
+                        }
+                    }
+                    hand[x * CHUNK_SIZE_Z + z] = glm::max(h, 62.0);
+                }
+            }
+            t_hand += getTime() - st;
+
+            st = getTime();
+            plan.eval2d(wx, wz, CHUNK_SIZE_X, CHUNK_SIZE_Z, &planned[0]);
+            t_plan += getTime() - st;
+
+            for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z; ++i) ng_maxDiff = glm::max(ng_maxDiff, fabs(hand[i] - planned[i]));
+        }
+    }
+    int ng_cols = 4 * ng_N * ng_N * CHUNK_SIZE_X * CHUNK_SIZE_Z;
+    printf("By hand: %.2lfMcol/sec, plan: %.2lfMcol/sec (%.1lfx faster), max difference %g\n", 1e-6 * ng_cols / t_hand, 1e-6 * ng_cols / t_plan, t_hand / t_plan, ng_maxDiff);
+
+    printf("\n -*- 18: Staged generation -*-\n");
+
+    // generate an area with a fresh generator, which runs the earlier stages of the chunks around it too
+    int stg_N = 4;
+    WG::DefaultWG stagedWG(0);
+    Map<ChunkID, uint64_t> stagedHashes;
+    st = getTime();
+    for (int X = -stg_N; X < stg_N; ++X) {
+        for (int Z = -stg_N; Z < stg_N; ++Z) {
+            Chunk* chunk = stagedWG.getChunk({X, Z});
+            stagedHashes[chunk->XZ] = chunk->calcHash();
+            delete chunk;
+        }
+    }
+    double t_staged = getTime() - st;
+    WG::Pipeline::Stats stgStats = stagedWG.pipeline.getStats();
+    printf("DefaultWG: %i chunks in %.3lfms/chunk, %i staged (%.1lfkb)\n", (int)stagedHashes.size(), 1e3 * t_staged / stagedHashes.size(), stagedWG.pipeline.size(),
+        stagedWG.pipeline.getMemoryUsage() / 1024.0);
+    for (size_t i = 0; i < stagedWG.stages.size(); ++i) {
+        printf("  %-9s (radius %i): %4i runs, %.3lfms/run\n", stagedWG.stages[i].name.c_str(), stagedWG.stages[i].radius, stgStats.n_runs[i], 1e3 * stgStats.t_runs[i] / glm::max(stgStats.n_runs[i], 1));
+    }
+
+    // count what decorating added, by generating the same chunks without that stage, and how much of it
+    //   is close enough to an edge to have come from a boulder in a neighboring chunk
+    WG::DefaultWG bareWG(0);
+    bareWG.stages.pop_back();
+    int n_decorated = 0, n_fromNeighbors = 0;
+    for (int X = -stg_N; X < stg_N; ++X) {
+        for (int Z = -stg_N; Z < stg_N; ++Z) {
+            Chunk* a = stagedWG.getChunk({X, Z});
+            Chunk* b = bareWG.getChunk({X, Z});
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                    for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+                        if (a->get(x, y, z) == b->get(x, y, z)) continue;
+                        n_decorated++;
+                        // boulders reach at most 2 blocks out from their center, so only these can cross an edge
+                        if (x < 2 || z < 2 || x >= CHUNK_SIZE_X - 2 || z >= CHUNK_SIZE_Z - 2) n_fromNeighbors++;
+                    }
+                }
+            }
+            delete a;
+            delete b;
+        }
+    }
+    printf("Decorating: %i blocks of boulders, %i of them within 2 blocks of an edge\n", n_decorated, n_fromNeighbors);
+
+    // the results should not depend on the order chunks are generated in, or on how many threads are
+    //   generating them at once
+    int n_stgDiff = 0, n_stgThreads = 4;
+    WG::DefaultWG reversedWG(0), threadedWG(0);
+    for (int X = stg_N - 1; X >= -stg_N; --X) {
+        for (int Z = stg_N - 1; Z >= -stg_N; --Z) {
+            Chunk* chunk = reversedWG.getChunk({X, Z});
+            if (chunk->calcHash() != stagedHashes[chunk->XZ]) n_stgDiff++;
+            delete chunk;
+        }
+    }
+
+    std::atomic<int> n_stgThreadDiff(0);
+    List<std::thread> stgThreads;
+    st = getTime();
+    for (int t = 0; t < n_stgThreads; ++t) {
+        stgThreads.push_back(std::thread([&, t]() {
+            // each thread takes every 'n_stgThreads'th chunk, so neighbors are made by different threads
+            for (int i = t; i < 4 * stg_N * stg_N; i += n_stgThreads) {
+                ChunkID id(i / (2 * stg_N) - stg_N, i % (2 * stg_N) - stg_N);
+                Chunk* chunk = threadedWG.getChunk(id);
+                if (chunk->calcHash() != stagedHashes.at(id)) n_stgThreadDiff++;
+                delete chunk;
+            }
+        }));
+    }
+    for (std::thread& thread : stgThreads) thread.join();
+    double t_threaded = getTime() - st;
+    printf("%i threads: %.3lfms/chunk (%.1lfx faster), %i waits on staged chunks\n", n_stgThreads, 1e3 * t_threaded / stagedHashes.size(), t_staged / t_threaded, threadedWG.pipeline.getStats().n_waits);
+    printf("Chunks that differ: %i in reverse order, %i across threads\n", n_stgDiff, n_stgThreadDiff.load());
+
+    printf("\n -*- 19: Biome map -*-\n");
+
+    // how much of each biome there is, over 4x4 tiles
+    WG::BiomeMap biomeMap(0);
+    const int bm_cells = 4 * WG::BiomeMap::TILE_CELLS;
+    List<WG::BiomeCell> bmCells(bm_cells * bm_cells);
+    st = getTime();
+    biomeMap.getCells(-bm_cells / 2, -bm_cells / 2, bm_cells, bm_cells, &bmCells[0]);
+    double t_tiles = getTime() - st;
+    int n_biomes[WG::BIOME_NUM] = { 0 };
+    for (const WG::BiomeCell& cell : bmCells) n_biomes[cell.biome]++;
+    printf("%i tiles in %.2lfms/tile: %.1lf%% plains, %.1lf%% hills, %.1lf%% mountains, %.1lf%% badlands\n", biomeMap.stats.n_tiles.load(), 1e3 * t_tiles / biomeMap.stats.n_tiles, 100.0 * n_biomes[WG::BIOME_PLAINS] / bmCells.size(), 100.0 * n_biomes[WG::BIOME_HILLS] / bmCells.size(), 100.0 * n_biomes[WG::BIOME_MOUNTAINS] / bmCells.size(), 100.0 * n_biomes[WG::BIOME_BADLANDS] / bmCells.size());
+
+    // the blended columns of chunks, from the cached tiles, and by computing the cells each chunk needs
+    //   directly (which is what every chunk would do without the cache). The blended base height is
+    //   also compared to sampling its noise at every column
+    int bm_N = 16, n_cellDiff = 0;
+    double t_cached = 0.0, t_direct = 0.0, bm_maxErr = 0.0;
+    Random::Perlin baseHeight(1, vec3(0.002), vec2(0.3, 0.65), vec2(30, 80));
+    WG::BiomeColumn bmCols[CHUNK_SIZE_X * CHUNK_SIZE_Z];
+    for (int X = -bm_N; X < bm_N; ++X) {
+        for (int Z = -bm_N; Z < bm_N; ++Z) {
+            st = getTime();
+            biomeMap.getColumns({X, Z}, bmCols);
+            t_cached += getTime() - st;
+
+            st = getTime();
+            WG::BiomeCell direct[5 * 5];
+            for (int i = 0; i < 5; ++i) {
+                for (int j = 0; j < 5; ++j) {
+                    direct[i * 5 + j] = biomeMap.calcCell(X * 4 + i, Z * 4 + j);
+                }
+            }
+            t_direct += getTime() - st;
+
+            for (int i = 0; i < 5; ++i) {
+                for (int j = 0; j < 5; ++j) {
+                    WG::BiomeCell cell = bmCells[(bm_cells / 2 + X * 4 + i) * bm_cells + bm_cells / 2 + Z * 4 + j];
+                    if (cell.height != direct[i * 5 + j].height || cell.biome != direct[i * 5 + j].biome) n_cellDiff++;
+                }
+            }
+            for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+                for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                    double exact = baseHeight.noise2d(X * CHUNK_SIZE_X + x, Z * CHUNK_SIZE_Z + z);
+                    bm_maxErr = glm::max(bm_maxErr, fabs(exact - bmCols[x * CHUNK_SIZE_Z + z].height));
+                }
+            }
+        }
+    }
+    printf("Cached: %.1lfus/chunk, direct: %.1lfus/chunk (%.1lfx faster), %i cells differ\n", 1e6 * t_cached / (4 * bm_N * bm_N), 1e6 * t_direct / (4 * bm_N * bm_N), t_direct / t_cached, n_cellDiff);
+    printf("Base height blended from cells is within %.3lf blocks of sampling every column\n", bm_maxErr);
+
+    printf("\n -*- 20: Random::PosHash (N=%i) -*-\n", N);
+
+    // the sequential generator, and the positional one, one at a time and a chunk at a time (the way a
+    //   generator would use it for per-block randomness)
+    Random::XorShift seqRng(0);
+    Random::PosHash posRng(0, 1);
+    uint32_t h_sum = 0;
+    st = getTime();
+    for (int i = 0; i < N; ++i) h_sum += seqRng.getU32();
+    double t_xorshift = getTime() - st;
+
+    st = getTime();
+    for (int i = 0; i < N; ++i) h_sum += Random::hash(0, i & 15, i >> 8, (i >> 4) & 15, 1);
+    double t_hash = getTime() - st;
+
+    st = getTime();
+    for (int i = 0; i < N; ++i) h_sum += posRng.getU32(i & 15, i >> 8, (i >> 4) & 15);
+    double t_posHash = getTime() - st;
+
+    // whole chunks, until there are at least 'N' values
+    List<uint32_t> posGrid(CHUNK_NUM_BLOCKS);
+    int n_posGrid = 0;
+    st = getTime();
+    for (int c = 0; n_posGrid < N; ++c) {
+        posRng.getU32Grid(c * CHUNK_SIZE_X, 0, 0, CHUNK_SIZE_X, CHUNK_SIZE_Y, CHUNK_SIZE_Z, &posGrid[0]);
+        h_sum += posGrid[c & 1023];
+        n_posGrid += CHUNK_NUM_BLOCKS;
+    }
+    double t_posGrid = getTime() - st;
+
+    printf("XorShift::getU32: %.2lfMsmp/sec\n", 1e-6 * N / t_xorshift);
+    printf("hash(): %.2lfMsmp/sec, PosHash::getU32: %.2lfMsmp/sec, PosHash::getU32Grid: %.2lfMsmp/sec\n", 1e-6 * N / t_hash, 1e-6 * N / t_posHash, 1e-6 * n_posGrid / t_posGrid);
+
+    // check the values of the last chunk: every bit should be set about half the time, and values next
+    //   to each other should differ in about half their bits
+    int n_posDiff = 0;
+    double maxBias = 0.0, avgFlips = 0.0;
+    for (int b = 0; b < 32; ++b) {
+        int n_set = 0;
+        for (uint32_t v : posGrid) n_set += (v >> b) & 1;
+        maxBias = glm::max(maxBias, fabs((double)n_set / posGrid.size() - 0.5));
+    }
+    for (int i = 0; i < CHUNK_NUM_BLOCKS - 1; ++i) avgFlips += __builtin_popcount(posGrid[i] ^ posGrid[i + 1]);
+    avgFlips /= CHUNK_NUM_BLOCKS - 1;
+
+    // and the batch should be the same as one at a time
+    int lastX = (n_posGrid / CHUNK_NUM_BLOCKS - 1) * CHUNK_SIZE_X;
+    for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+        for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+                if (posGrid[(x * CHUNK_SIZE_Z + z) * CHUNK_SIZE_Y + y] != Random::hash(0, lastX + x, y, z, 1)) n_posDiff++;
+            }
+        }
+    }
+    printf("Max bit bias: %.4lf, bits flipped between neighbors: %.2lf/32, grid differs from hash(): %i (checksum 0x%x)\n", maxBias, avgFlips, n_posDiff, h_sum);
+
+    printf("\n -*- 21: Chunk columns -*-\n");
+
+    // the heights and solid bits should match the blocks after generating, editing, cloning, and loading
+    WG::DefaultWG columnWG(0);
+    const int col_N = 4;
+    List<Chunk*> colChunks;
+    for (int X = -col_N; X < col_N; ++X) {
+        for (int Z = -col_N; Z < col_N; ++Z) {
+            colChunks.push_back(columnWG.getChunk({X, Z}));
+        }
+    }
+    columnWG.pipeline.clear();
+
+    int n_genErrors = 0, n_editErrors = 0, n_loadErrors = 0;
+    Random::XorShift colRng(0);
+    List<uint8_t> colData;
+    for (Chunk* chunk : colChunks) {
+        n_genErrors += countColumnErrors(chunk);
+
+        // random blocks and boxes of stone and air, to a clone (which must leave the original alone)
+        Chunk* edited = chunk->clone(chunk->XZ);
+        for (int i = 0; i < 1000; ++i) {
+            int x = colRng.getU32() % CHUNK_SIZE_X, y = colRng.getU32() % CHUNK_SIZE_Y, z = colRng.getU32() % CHUNK_SIZE_Z;
+            BlockData val = colRng.getU32() % 2 ? BlockData(ID::STONE) : BlockData(ID::AIR);
+            if (i % 10 == 0) {
+                edited->fillBox(x, y, z, x + 1 + colRng.getU32() % 8, y + 1 + colRng.getU32() % 96, z + 1 + colRng.getU32() % 8, val);
+            } else {
+                edited->set(x, y, z, val);
+            }
+        }
+        n_editErrors += countColumnErrors(edited);
+        n_genErrors += countColumnErrors(chunk);
+
+        colData.clear();
+        Save::encodeChunk(edited, colData);
+        Chunk* loaded = Save::decodeChunk(edited->XZ, &colData[0], colData.size(), NULL);
+        n_loadErrors += loaded == NULL ? CHUNK_SIZE_X * CHUNK_SIZE_Z : countColumnErrors(loaded);
+        delete loaded;
+        delete edited;
+    }
+    printf("Columns that don't match their blocks: %i generated, %i edited, %i loaded\n", n_genErrors, n_editErrors, n_loadErrors);
+
+    // connect the chunks to each other, like the renderer does, and find the blocks that could have visible
+    //   faces, from the solid bits of each column, and by looking at the neighbors of every block (which is
+    //   what the mesher used to do)
+    const int col_W = 2 * col_N;
+    for (int i = 0; i < col_W; ++i) {
+        for (int j = 0; j < col_W; ++j) {
+            Chunk* chunk = colChunks[i * col_W + j];
+            if (i > 0) chunk->rcache.cL = colChunks[(i - 1) * col_W + j];
+            if (i < col_W - 1) chunk->rcache.cR = colChunks[(i + 1) * col_W + j];
+            if (j > 0) chunk->rcache.cB = colChunks[i * col_W + j - 1];
+            if (j < col_W - 1) chunk->rcache.cT = colChunks[i * col_W + j + 1];
+        }
+    }
+
+    int n_solid = 0, n_exposed = 0, n_exposedDiff = 0;
+    uint64_t exposed[CHUNK_COLUMN_WORDS];
+    List<uint64_t> colExposed(colChunks.size() * CHUNK_SIZE_X * CHUNK_SIZE_Z * CHUNK_COLUMN_WORDS);
+    st = getTime();
+    for (size_t c = 0; c < colChunks.size(); ++c) {
+        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                colChunks[c]->getExposed(x, z, &colExposed[((c * CHUNK_SIZE_X + x) * CHUNK_SIZE_Z + z) * CHUNK_COLUMN_WORDS]);
+            }
+        }
+    }
+    double t_colExposed = getTime() - st;
+
+    st = getTime();
+    for (size_t c = 0; c < colChunks.size(); ++c) {
+        const Chunk* chunk = colChunks[c];
+        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) exposed[w] = 0;
+                for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
+                    if (chunk->get(x, y, z).id == ID::AIR) continue;
+                    n_solid++;
+                    if (!isSolidNear(chunk, x, y + 1, z) || !isSolidNear(chunk, x, y - 1, z) || !isSolidNear(chunk, x - 1, y, z) ||
+                        !isSolidNear(chunk, x + 1, y, z) || !isSolidNear(chunk, x, y, z - 1) || !isSolidNear(chunk, x, y, z + 1)) {
+                        exposed[y >> 6] |= 1ULL << (y & 63);
+                    }
+                }
+                const uint64_t* fast = &colExposed[((c * CHUNK_SIZE_X + x) * CHUNK_SIZE_Z + z) * CHUNK_COLUMN_WORDS];
+                for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) {
+                    n_exposed += __builtin_popcountll(fast[w]);
+                    n_exposedDiff += __builtin_popcountll(fast[w] ^ exposed[w]);
+                }
+            }
+        }
+    }
+    double t_blockExposed = getTime() - st;
+
+    printf("Exposed blocks: %i of %i non-air (%.1lf%%), %i differ from checking every block\n", n_exposed, n_solid, 100.0 * n_exposed / n_solid, n_exposedDiff);
+    printf("Columns: %.1lfus/chunk, every block: %.1lfus/chunk (%.1lfx faster)\n", 1e6 * t_colExposed / colChunks.size(), 1e6 * t_blockExposed / colChunks.size(), t_blockExposed / t_colExposed);
+    printf("Memory: %.1lfkb/chunk for the heightmap and solid bits\n", (sizeof(colChunks[0]->heightmap) + sizeof(colChunks[0]->solid)) / 1024.0);
+
+    printf("\n -*- 22: Chunk meshing -*-\n");
+
+    // the same terrain (which is already connected), and a flat world of grass
+    WG::FlatWG meshFlatWG(0);
+    List<Chunk*> flatChunks;
+    for (int i = 0; i < col_W; ++i) {
+        for (int j = 0; j < col_W; ++j) flatChunks.push_back(meshFlatWG.getChunk({i - col_N, j - col_N}));
+    }
+    for (int i = 0; i < col_W; ++i) {
+        for (int j = 0; j < col_W; ++j) {
+            Chunk* chunk = flatChunks[i * col_W + j];
+            if (i > 0) chunk->rcache.cL = flatChunks[(i - 1) * col_W + j];
+            if (i < col_W - 1) chunk->rcache.cR = flatChunks[(i + 1) * col_W + j];
+            if (j > 0) chunk->rcache.cB = flatChunks[i * col_W + j - 1];
+            if (j < col_W - 1) chunk->rcache.cT = flatChunks[i * col_W + j + 1];
+        }
+    }
+
+    benchMeshing("DefaultWG", colChunks, col_W);
+    benchMeshing("FlatWG", flatChunks, col_W);
+
+    for (Chunk* chunk : colChunks) delete chunk;
+    for (Chunk* chunk : flatChunks) delete chunk;
 
 
 }
@@ -430,22 +2082,64 @@ int main(int argc, char** argv) {
     // our option
     int opt;
 
+    // number of chunk generation workers (0 means automatic)
+    int numWorkers = 0;
+
+    // memory budget for loaded chunks, in megabytes (0 means the server's default)
+    int memBudget = 0;
+
+    // the directory the world is saved in
+    String worldDir = "world";
+
+    // how the world is saved
+    Save::RegionStore::Mode saveMode = Save::RegionStore::MODE_FULL;
+
+    // whether identical sections are shared between chunks
+    bool shareSections = false;
+
+    // how chunks are meshed
+    Render::ChunkMesh::Mode meshMode = Render::ChunkMesh::MODE_GREEDY;
+
     // try and initialize blok
     if (!initAll()) return -1;
 
     // parse arguments 
-    while ((opt = getopt(argc, argv, "Tvh")) != -1) {
+    while ((opt = getopt(argc, argv, "Tvhdsnj:M:w:")) != -1) {
         if (opt == 'h') {
             // print help
             printf("Usage: %s [-h]\n\n", argv[0]);
             printf("  -h           Prints this help/usage message\n");
             printf("  -T           Run some sanity checks\n");
+            printf("  -j [N]       Use N threads to generate chunks (default: one per core)\n");
+            printf("  -M [MB]      Keep at most this many megabytes of chunks loaded\n");
+            printf("  -w [dir]     Save the world in this directory (default: 'world')\n");
+            printf("  -d           Only save edits, regenerating the rest of the world when loading\n");
+            printf("  -s           Share identical chunk sections, to save memory\n");
+            printf("  -n           Mesh every block face separately, instead of merging them\n");
             printf("\nBlok v%i.%i.%i %s\n", BUILD_MAJOR, BUILD_MINOR, BUILD_PATCH, BUILD_DEV ? "(dev)" : "");
             printf("Cade Brown <brown.cade@gmail.com>\n");
             return 0;
         } else if (opt == 'v') {
             // increate verbosity
             setLogLevel((LogLevel)((int)getLogLevel()-1));
+        } else if (opt == 'j') {
+            // set the number of workers
+            numWorkers = atoi(optarg);
+        } else if (opt == 'M') {
+            // set the memory budget
+            memBudget = atoi(optarg);
+        } else if (opt == 'd') {
+            // use delta saves
+            saveMode = Save::RegionStore::MODE_DELTA;
+        } else if (opt == 's') {
+            // share sections
+            shareSections = true;
+        } else if (opt == 'n') {
+            // use the naive mesher
+            meshMode = Render::ChunkMesh::MODE_NAIVE;
+        } else if (opt == 'w') {
+            // set the world directory
+            worldDir = optarg;
         } else if (opt == 'T') {
             // run a test
             runTests();
@@ -469,10 +2163,12 @@ int main(int argc, char** argv) {
     }
 
     // create a local server
-    LocalServer* server = new LocalServer();
+    LocalServer* server = new LocalServer(numWorkers, worldDir, saveMode, shareSections);
+    if (memBudget > 0) server->budget.maxBytes = (size_t)memBudget * 1024 * 1024;
     printf("SERVER: %p\n", server);
     Client* client = new Client(server, 1600, 1200);
     printf("CLKIENT: %p\n", client);
+    client->gfx.renderer->meshMode = meshMode;
     // just update
     client->gfx.renderer->pos = vec3(0, 14, -10);
 
@@ -499,6 +2195,9 @@ int main(int argc, char** argv) {
     ent->setPos(vec3(16, 100, 16));
     printf("STARTING...\n");
     while (client->frame()) {
+
+        // now that the frame is done, unload chunks if we're over budget
+        server->evictChunks();
         
         vec3 moveZ = client->gfx.renderer->forward;
         moveZ.y = 0;
@@ -550,6 +2249,8 @@ int main(int argc, char** argv) {
         stats.n_chunks += client->gfx.renderer->stats.n_chunks;
         stats.n_chunk_recalcs += client->gfx.renderer->stats.n_chunk_recalcs;
         stats.n_tris += client->gfx.renderer->stats.n_tris;
+        stats.n_chunk_tris += client->gfx.renderer->stats.n_chunk_tris;
+        stats.n_naive_tris += client->gfx.renderer->stats.n_naive_tris;
 
 
         if (client->N_frames % every == 0) {
@@ -564,12 +2265,25 @@ int main(int argc, char** argv) {
 
             double dt = et - everyT;
             blok_debug("[frame%i] fps: %.1lf, ms/chunk: %.3lf, tris: %.3lf%s", client->N_frames, every / dt, stats.n_chunk_recalcs != 0 ? (1e3 * stats.t_chunks) / stats.n_chunk_recalcs : 0.0, (double)tris, triSuf);
+            blok_debug("[frame%i] chunk tris: %i, naive mesher: %i (%.1lfx more)", client->N_frames, stats.n_chunk_tris / every, stats.n_naive_tris / every, stats.n_chunk_tris != 0 ? (double)stats.n_naive_tris / stats.n_chunk_tris : 0.0);
 
             everyT = et;
 
             // reset the statistics
             stats = Render::Renderer::Stats();
-            //blok_debug("fps: %.1lf, chunks/sec: %.1lf", 1.0 / dt, server->stats.n_chunks / server->stats.t_chunks);
+
+            // report chunk generation, for each worker
+            server->updateStats();
+            blok_debug("[frame%i] chunks: %i, ms/chunk: %.3lf", client->N_frames, server->stats.n_chunks, server->stats.n_chunks != 0 ? (1e3 * server->stats.t_chunks) / server->stats.n_chunks : 0.0);
+            for (LocalServer::Worker* w : server->workers) {
+                int n_chunks = w->stats.n_chunks;
+                double t_chunks = w->stats.t_chunks;
+                blok_trace("  worker %i: chunks: %i, ms/chunk: %.3lf", w->idx, n_chunks, n_chunks != 0 ? (1e3 * t_chunks) / n_chunks : 0.0);
+            }
+
+            // and how much the chunk lock is getting in the way
+            int n_locks = server->lockStats.n_locks;
+            blok_trace("  L_chunks: locks: %i, us/lock: %.3lf (max: %.3lf), ms waiting: %.3lf", n_locks, n_locks != 0 ? (1e6 * server->lockStats.t_held) / n_locks : 0.0, 1e6 * server->lockStats.t_maxHeld, 1e3 * server->lockStats.t_wait);
         }
 
     } 
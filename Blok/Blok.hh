@@ -27,6 +27,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <atomic>
 
 /* GLM (matrix & vector library) */
 #include <Blok/glm/glm.hpp>
@@ -108,6 +109,8 @@ namespace Blok {
     //   for example, using Pair<A, B> as a key type, which I do often.
     // there may be a fix, but it's not that drastic of a performance difference
     // so I think this is simpler
+    // For containers that are hit every frame, use `HashMap`/`HashSet` (see HashMap.hh), which
+    //   have hashes for Pair keys
     template<typename K, typename V>
     using Map = std::map<K, V>;
 
@@ -136,6 +139,18 @@ namespace Blok {
     // the total number of blocks in a chunk
     const int CHUNK_NUM_BLOCKS = CHUNK_SIZE_X * CHUNK_SIZE_Y * CHUNK_SIZE_Z;
 
+    // number of blocks in the Y direction of a single chunk section (see `ChunkSection`)
+    const int SECTION_SIZE_Y = 16;
+
+    // the number of sections stacked vertically in a chunk
+    const int CHUNK_NUM_SECTIONS = CHUNK_SIZE_Y / SECTION_SIZE_Y;
+
+    // the total number of blocks in a chunk section
+    const int SECTION_NUM_BLOCKS = CHUNK_SIZE_X * SECTION_SIZE_Y * CHUNK_SIZE_Z;
+
+    // the number of 64-bit words in the bitset of a single column of a chunk (see `Chunk::solid`)
+    const int CHUNK_COLUMN_WORDS = CHUNK_SIZE_Y / 64;
+
 
     /* SINGLETONS */
 
@@ -149,6 +164,10 @@ namespace Blok {
     // for example, `formatUnits(10002, {"", "k", "m"})` formats as `10.002k`
     String formatUnits(double val, const List<String> names);
 
+    // get statistics about the arenas used for chunk storage (see `Arena.hh`), i.e. the number
+    //   of slots in use, and the number of bytes mapped from the OS
+    void getArenaStats(size_t& numUsed, size_t& bytesMapped);
+
 
     /* GAME ENGINE SPECIFIC TYPE DEFS */
 
@@ -216,6 +235,216 @@ namespace Blok {
             this->meta = meta;
         }
 
+        // pack the block data into a single 16 bit value, as (meta << 8) | id
+        uint16_t pack() const {
+            return ((uint16_t)meta << 8) | (uint16_t)id;
+        }
+
+        // unpack a value returned by `pack()`
+        static BlockData unpack(uint16_t val) {
+            return BlockData((ID)(val & 0xFF), (uint8_t)(val >> 8));
+        }
+
+    };
+
+    // we define comparison operators for block data, so palettes can be searched
+    static inline bool operator==(BlockData A, BlockData B) {
+        return A.id == B.id && A.meta == B.meta;
+    }
+    static inline bool operator!=(BlockData A, BlockData B) {
+        return A.id != B.id || A.meta != B.meta;
+    }
+
+
+    // BlockStorage - a compressed, fixed size array of BlockData, used as the backing store for chunks
+    // Instead of storing each BlockData directly, a small palette of the distinct values is kept,
+    //   and each entry is a bit-packed index into that palette. The number of bits per index
+    //   (1, 2, 4, or 8) is chosen automatically, and grows as new distinct values are added.
+    //   If there are more than 256 distinct values, the entries are stored directly as their 16 bit
+    //   `BlockData::pack()` value, and the palette is not used
+    //
+    // Typical terrain only has a handful of distinct blocks, so this is many times smaller than
+    //   a flat array of BlockData
+    //
+    // The palette and the indices are kept in a single allocation, with the palette (room for 2^bits
+    //   entries) first, followed by 64 bit words of packed indices. An index never straddles two words
+    //
+    // Storages are reference counted, so that chunks with identical sections (i.e. copies of a
+    //   prototype chunk, see `Chunk::clone()`) can share them. A shared storage must never be written
+    //   to, so sections make their own copy first (see `ChunkSection::makeUnique()`)
+    // See `Blok.cc` for the non-inline methods
+    class BlockStorage {
+        public:
+
+        // the number of entries in the storage (must be a multiple of 64)
+        int size;
+
+        // log2 of the number of bits per entry, i.e. 0=1 bit, 1=2 bits, 2=4 bits, 3=8 bits,
+        //   and 4=16 bits, which means the values are stored directly with no palette
+        int lbits;
+
+        // the number of palette entries in use (always <= getPaletteCap(lbits))
+        int paletteSize;
+
+        // the palette of distinct values, which the indices refer to. This is also the start
+        //   of the allocated buffer
+        BlockData* palette;
+
+        // the bit-packed indices (or, direct values if 'lbits==4')
+        uint64_t* words;
+
+        // the number of sections using this storage (see `acquire()` and `release()`)
+        std::atomic<int> numRefs;
+
+        // whether one of 'numRefs' is held by a `SectionTable` (rather than a section)
+        std::atomic<bool> isInterned;
+
+        // return the number of entries the palette has room for, for a given 'lbits'
+        static int getPaletteCap(int lbits) {
+            return lbits >= 4 ? 0 : 1 << (1 << lbits);
+        }
+
+        // return the number of bytes the palette takes up in the buffer, for a given 'lbits'
+        static size_t getPaletteBytes(int lbits) {
+            return (getPaletteCap(lbits) * sizeof(BlockData) + 7) & ~(size_t)7;
+        }
+
+        // construct a storage with 'size' entries, all initialized to 'val'
+        BlockStorage(int size, BlockData val=BlockData());
+
+        // construct a storage with 'size' entries, from an existing encoding (i.e. one that was saved),
+        //   copying 'palette' (which has 'paletteSize' entries, unless 'lbits==4') and 'words'
+        BlockStorage(int size, int lbits, const BlockData* palette, int paletteSize, const uint64_t* words);
+
+        // free the storage's buffer
+        ~BlockStorage();
+
+        // storages own their buffer, so they should not be copied
+        BlockStorage(const BlockStorage& other) = delete;
+        BlockStorage& operator=(const BlockStorage& other) = delete;
+
+        // storages are allocated from an arena, rather than the heap (see `Arena.hh`)
+        static void* operator new(size_t sz);
+        static void operator delete(void* ptr, size_t sz);
+
+        // add a reference to the storage, and return it
+        BlockStorage* acquire() {
+            numRefs.fetch_add(1, std::memory_order_relaxed);
+            return this;
+        }
+
+        // remove a reference to the storage, freeing it if it was the last one
+        void release() {
+            if (numRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+        }
+
+        // return whether more than one section is using the storage (and so, it must not be modified)
+        bool isShared() const {
+            return numRefs.load(std::memory_order_acquire) > 1;
+        }
+
+        // return the number of bytes allocated for the palette and indices
+        size_t getBytes() const {
+            return getPaletteBytes(lbits) + sizeof(uint64_t) * (size >> (6 - lbits));
+        }
+
+        // get the raw value of the entry at 'idx', which is a palette index, or a packed BlockData
+        //   if 'lbits==4'
+        uint32_t getRaw(int idx) const {
+            const int shift = (idx & ((64 >> lbits) - 1)) << lbits;
+            const uint64_t mask = (1ULL << (1 << lbits)) - 1;
+            return (uint32_t)((words[idx >> (6 - lbits)] >> shift) & mask);
+        }
+
+        // set the raw value of the entry at 'idx' (see `getRaw()`)
+        void setRaw(int idx, uint32_t val) {
+            const int shift = (idx & ((64 >> lbits) - 1)) << lbits;
+            const uint64_t mask = (1ULL << (1 << lbits)) - 1;
+            uint64_t& word = words[idx >> (6 - lbits)];
+            word = (word & ~(mask << shift)) | ((uint64_t)val << shift);
+        }
+
+        // return the index of 'val' in the palette, or -1 if it is not in the palette
+        int findPalette(BlockData val) const {
+            for (int i = 0; i < paletteSize; ++i) {
+                if (palette[i] == val) return i;
+            }
+            return -1;
+        }
+
+        // get the entry at 'idx'
+        BlockData get(int idx) const {
+            uint32_t raw = getRaw(idx);
+            return lbits == 4 ? BlockData::unpack(raw) : palette[raw];
+        }
+
+        // return the raw value for 'val' (see `getRaw()`), adding it to the palette (and growing
+        //   the palette) if required
+        uint32_t getRawFor(BlockData val) {
+            if (lbits < 4) {
+                int pidx = findPalette(val);
+                if (pidx < 0) {
+                    // make room for a new entry, which may switch to direct storage
+                    if (paletteSize == getPaletteCap(lbits)) grow();
+                    if (lbits < 4) {
+                        pidx = paletteSize++;
+                        palette[pidx] = val;
+                    }
+                }
+                if (pidx >= 0) return pidx;
+            }
+            return val.pack();
+        }
+
+        // set the entry at 'idx' to 'val', growing the palette if required
+        void set(int idx, BlockData val) {
+            setRaw(idx, getRawFor(val));
+        }
+
+        // set every entry in the range [idx0, idx1) to 'val'
+        // The palette is only searched once, and whole words are written at a time, so this is much
+        //   faster than calling `set()` for each entry
+        void fill(int idx0, int idx1, BlockData val);
+
+        // calculate a hash of the entries, which only depends on their values (and order), and not
+        //   on how they are encoded
+        uint64_t calcHash() const {
+            uint64_t res = 5381;
+            for (int i = 0; i < size; ++i) {
+                res = 33 * res + get(i).pack();
+            }
+            return res;
+        }
+
+        // return whether every entry is the same as in 'other' (which may be encoded differently)
+        bool equals(const BlockStorage& other) const {
+            if (size != other.size) return false;
+
+            // the same encoding can be compared directly
+            if (lbits == other.lbits && paletteSize == other.paletteSize && memcmp(palette, other.palette, sizeof(BlockData) * paletteSize) == 0) {
+                return memcmp(words, other.words, sizeof(uint64_t) * (size >> (6 - lbits))) == 0;
+            }
+            for (int i = 0; i < size; ++i) {
+                if (get(i) != other.get(i)) return false;
+            }
+            return true;
+        }
+
+        // remove unused palette entries, and shrink the number of bits per index if possible
+        // This is called automatically when the palette is full, but can be called after large
+        //   edits (such as generation) to release memory
+        void compact();
+
+        private:
+
+        // make room for at least one more palette entry, either by compacting, or by
+        //   increasing the bits per index
+        void grow();
+
+        // re-encode the storage with a new 'lbits', and a new palette (if 'newLbits < 4'). The old palette
+        //   index 'i' is mapped to new palette index 'remap[i]' (if 'remap' is NULL, indices are kept)
+        void repack(int newLbits, const BlockData* newPalette, int newPaletteSize, const int* remap);
+
     };
 
     // ChunkID - type defining the Chunk's macro coordinates world space
@@ -265,6 +494,52 @@ namespace Blok {
     }
 
 
+    // ChunkSection - a 16x16x16 cube of blocks, 16 of which are stacked to make up a chunk
+    // Sections are allocated lazily: a section that is entirely one block (most commonly, all air
+    //   above the terrain, or all stone deep below it) has no storage at all, and is
+    //   represented by just the 'fill' value
+    struct ChunkSection {
+
+        // the block storage, ordered the same as chunks (XZY), or NULL if every block in
+        //   the section is 'fill'
+        BlockStorage* blocks;
+
+        // when 'blocks==NULL', this is the value of every block in the section
+        BlockData fill;
+
+        // construct a section with every block set to 'fill'
+        ChunkSection(BlockData fill=BlockData()) {
+            this->blocks = NULL;
+            this->fill = fill;
+        }
+
+        // return whether the section is entirely made up of a single block value
+        bool isUniform() const {
+            return blocks == NULL;
+        }
+
+        // drop the section's storage (if any), leaving 'blocks==NULL'
+        void release() {
+            if (blocks != NULL) blocks->release();
+            blocks = NULL;
+        }
+
+        // make sure the section's storage (if any) isn't shared with any other section, by copying it
+        //   if it is. This must be called before modifying 'blocks'
+        void makeUnique() {
+            if (blocks == NULL || !blocks->isShared()) return;
+            BlockStorage* copy = new BlockStorage(blocks->size, blocks->lbits, blocks->palette, blocks->paletteSize, blocks->words);
+            blocks->release();
+            blocks = copy;
+        }
+
+        // return whether the section is entirely air, and so can be skipped over
+        bool isEmpty() const {
+            return blocks == NULL && fill.id == ID::AIR;
+        }
+
+    };
+
     // Chunk - represents a vertical column of data of size:
     //   CHUNK_SIZE_X*CHUNK_SIZE_Y*CHUNK_SIZE_Z
     // This should extend from the bottom of the physical world to the top,
@@ -310,19 +585,84 @@ namespace Blok {
         //     }
         //   }
         // }
-        BlockData* blocks;
+        // The blocks are actually stored in CHUNK_NUM_SECTIONS sections (see `ChunkSection`), each of
+        //   which is palette-compressed (see `BlockStorage`), so always use `get()`/`set()`
+        // Within a section, blocks are ordered the same way, with index `getSectionIndex(x, y, z)`
+        ChunkSection sections[CHUNK_NUM_SECTIONS];
 
         // the map of entities in a given chunk
         Map<UUID, Entity*> entities;
 
+        // the sides of the chunk, for indexing 'versions.borders' (see the diagram above)
+        enum Border {
+            BORDER_L = 0,
+            BORDER_T = 1,
+            BORDER_R = 2,
+            BORDER_B = 3
+        };
+
+        // the directions that the faces of a block point in, for `getFaces()`. The first 4 are the same as
+        //   'Border', and then up (+Y) and down (-Y)
+        enum Side {
+            SIDE_L = BORDER_L,
+            SIDE_T = BORDER_T,
+            SIDE_R = BORDER_R,
+            SIDE_B = BORDER_B,
+            SIDE_UP = 4,
+            SIDE_DOWN = 5,
+            SIDE_NUM = 6
+        };
+
+        // version counters, which only ever increase, and are bumped by `set()` whenever a block changes
+        // This allows other systems (i.e. the renderer) to tell what has changed in O(1), by remembering
+        //   the last version they saw, rather than scanning or hashing the blocks
+        struct {
+
+            // bumped on every change to the chunk
+            uint32_t all;
+
+            // bumped on every change to a block on a given side (indexed by 'Border'), i.e. changes that
+            //   neighboring chunks can see
+            uint32_t borders[4];
+
+        } versions;
+
+        // the value of 'versions.all' when the chunk last matched what could be reproduced without it,
+        //   i.e. when it was generated, loaded, or saved. If they differ, the chunk has edits that would
+        //   be lost if it were unloaded without saving (see `isModified()`)
+        uint32_t cleanVersion;
+
+        // bitset of sections that may differ from what the world generator produces for this chunk
+        // Every change sets the section's bit, and the server clears them all right after generating the
+        //   chunk, so sections without a bit set never need to be saved (see `Save::RegionStore::MODE_DELTA`)
+        uint32_t editedSections;
+
+        // the highest non-air block in each column (indexed by `getColumnIndex()`), or -1 if the whole column
+        //   is air
+        // This and 'solid' are kept up to date by `set()` and `fillBox()`, so anything that writes to
+        //   'sections' directly must call `rebuildColumns()` once it is done
+        int16_t heightmap[CHUNK_SIZE_X * CHUNK_SIZE_Z];
+
+        // a bitset of the non-air blocks in each column (indexed by `getColumnIndex()`), where bit 'y & 63' of
+        //   word 'y / 64' is for the block at 'y'. This lets whole columns be tested at once (see `getExposed()`)
+        uint64_t solid[CHUNK_SIZE_X * CHUNK_SIZE_Z][CHUNK_COLUMN_WORDS];
+
+        // the server tick that this chunk was last requested on, which the server uses to decide
+        //   which chunks to unload first (see `LocalServer::evictChunks()`)
+        // NOTE: this is atomic since chunks are looked up without any locks (see `Server::getChunk()`)
+        std::atomic<uint64_t> lastAccess;
+
         // rcache - the render cache, meant to be mainly managed by the rendering engine
         //   to improve efficiency
-        // all 'cur' values mean current as of this frame, and
-        // 'last' values mean the values for last frames
+        // all 'last' values are the values as of the last time the chunk was meshed
         struct {
 
-            // keep track of hashes, to check if anything changed
-            uint64_t curHash, lastHash;
+            // the value of 'versions.all' when the chunk was last meshed
+            uint32_t lastVersion;
+
+            // the border versions of the neighbors (facing this chunk, indexed by 'Border') when the chunk was
+            //   last meshed, i.e. 'lastBorders[BORDER_L]' is 'cL->versions.borders[BORDER_R]'
+            uint32_t lastBorders[4];
 
             // true if any block has been modified, and is reset to false by the rendering engine
             bool isDirty;
@@ -335,18 +675,31 @@ namespace Blok {
             //   diagram of these
             // if one is NULL, that means that Chunk is not in the rendering engine currently,
             //   so the chunk is 'open'
+            // the links are always the same on both sides (i.e. if 'cL' is set, 'cL->rcache.cR' is this chunk),
+            //   so that either one can be freed first
             Chunk *cL, *cT, *cR, *cB;
 
         } rcache;
 
         // construct an empty chunk, defaulting to all air blocks
         Chunk() {
-            // allocate the array of data, which should set them all to empty air
-            this->blocks = new BlockData[CHUNK_NUM_BLOCKS];
+
+            // no changes yet
+            versions.all = 0;
+            for (int i = 0; i < 4; ++i) versions.borders[i] = 0;
+            cleanVersion = 0;
+            lastAccess = 0;
+
+            // until the server says otherwise, nothing is known about where the blocks came from
+            editedSections = (1ULL << CHUNK_NUM_SECTIONS) - 1;
+
+            // every column starts out as air
+            for (int i = 0; i < CHUNK_SIZE_X * CHUNK_SIZE_Z; ++i) heightmap[i] = -1;
+            memset(solid, 0, sizeof(solid));
 
             // initialize the render cache
-            // 0=not calculated yet
-            rcache.curHash = rcache.lastHash = 0;
+            rcache.lastVersion = 0;
+            for (int i = 0; i < 4; ++i) rcache.lastBorders[i] = 0;
 
             rcache.isDirty = true;
 
@@ -357,13 +710,19 @@ namespace Blok {
             rcache.cL = rcache.cT = rcache.cR = rcache.cB = NULL;
         }
 
+        // chunks are allocated from an arena, rather than the heap (see `Arena.hh`)
+        static void* operator new(size_t sz);
+        static void operator delete(void* ptr, size_t sz);
+
         // free all resources in the chunk
         ~Chunk() {
-            
-            // free our allocated array
-            if (this->blocks != NULL) delete[] this->blocks;
 
-            // remove our neighbor's references
+            // free any allocated sections
+            for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+                sections[i].release();
+            }
+
+            // remove our neighbor's references (which must be the same on both sides, see `rcache`)
             if (rcache.cR != NULL) rcache.cR->rcache.cL = NULL;
             if (rcache.cT != NULL) rcache.cT->rcache.cB = NULL;
             if (rcache.cL != NULL) rcache.cL->rcache.cR = NULL;
@@ -374,11 +733,19 @@ namespace Blok {
         uint64_t calcHash() const {
             // I use a djb-like hash function, which seems to be working fine
             uint64_t res = 5381;
-            for (int i = 0; i < CHUNK_NUM_BLOCKS; ++i) {
-                // convert this into a single value
-                uint32_t ctmp = (blocks[i].id << 8) |  this->blocks[i].meta;
-                // now, XOR it
-                res ^= (ctmp << 5) + ctmp;
+            for (int sy = 0; sy < CHUNK_NUM_SECTIONS; ++sy) {
+                // uniform sections are skipped, since they XOR the same value an even number of
+                //   times, which cancels out
+                const BlockStorage* blocks = sections[sy].blocks;
+                if (blocks == NULL) continue;
+
+                for (int i = 0; i < SECTION_NUM_BLOCKS; ++i) {
+                    // convert this into a single value
+                    BlockData cur = blocks->get(i);
+                    uint32_t ctmp = (cur.id << 8) | cur.meta;
+                    // now, XOR it
+                    res ^= (ctmp << 5) + ctmp;
+                }
             }
 
             // never return 0, because that means that the hash has not been initialized
@@ -398,6 +765,17 @@ namespace Blok {
             return getIndex(xyz[0], xyz[1], xyz[2]);
         }
 
+        // get the index into a section's storage, given the 3D local coordinates (in the chunk)
+        // The section itself is `sections[y / SECTION_SIZE_Y]`
+        int getSectionIndex(int x=0, int y=0, int z=0) const {
+            return SECTION_SIZE_Y * (CHUNK_SIZE_Z * x + z) + (y & (SECTION_SIZE_Y - 1));
+        }
+
+        // get the index into 'heightmap' and 'solid', given the local X and Z coordinates
+        int getColumnIndex(int x=0, int z=0) const {
+            return CHUNK_SIZE_Z * x + z;
+        }
+
         // inverse the linear index, and decompose it back into individual components, x, y, z
         // NOTE: getIndexInv(getIndex(xyz)) == xyz
         vec3i getIndexInv(int idx) {
@@ -424,8 +802,9 @@ namespace Blok {
         // i.e. 0 <= y < BLOCK_SIZE_Y
         // i.e. 0 <= z < BLOCK_SIZE_Z
         BlockData get(int x=0, int y=0, int z=0) const {
-            const int idx = getIndex(x, y, z);
-            return blocks[idx];
+            const ChunkSection& sec = sections[y / SECTION_SIZE_Y];
+            if (sec.blocks == NULL) return sec.fill;
+            return sec.blocks->get(getSectionIndex(x, y, z));
         }
 
         // get the block data at a given local coordinate
@@ -433,13 +812,62 @@ namespace Blok {
             return get(xyz.x, xyz.y, xyz.z);
         }
 
+        // return whether the block at a given local coordinate is not air, without looking at its section
+        bool isSolid(int x=0, int y=0, int z=0) const {
+            return (solid[getColumnIndex(x, z)][y >> 6] >> (y & 63)) & 1;
+        }
+
+        // return the Y coordinate of the highest non-air block in the column at local 'x', 'z', or -1 if
+        //   the whole column is air
+        int getHeight(int x=0, int z=0) const {
+            return heightmap[getColumnIndex(x, z)];
+        }
+
+        // return the highest bit set in the column bitset 'mask' (see 'solid'), or -1 if there are none
+        static int calcHeight(const uint64_t* mask) {
+            for (int w = CHUNK_COLUMN_WORDS - 1; w >= 0; --w) {
+                if (mask[w] != 0) return 64 * w + 63 - __builtin_clzll(mask[w]);
+            }
+            return -1;
+        }
+
         // set the block data at a given local coordinate to a given value
         // i.e. 0 <= x < BLOCK_SIZE_X
         // i.e. 0 <= y < BLOCK_SIZE_Y
         // i.e. 0 <= z < BLOCK_SIZE_Z
         void set(int x=0, int y=0, int z=0, BlockData val=BlockData()) {
-            const int idx = getIndex(x, y, z);
-            blocks[idx] = val;
+            // writing the same value is not a change, so don't bump any versions (which would force a remesh)
+            if (get(x, y, z) == val) return;
+
+            ChunkSection& sec = sections[y / SECTION_SIZE_Y];
+            if (sec.blocks != NULL) {
+                sec.makeUnique();
+                sec.blocks->set(getSectionIndex(x, y, z), val);
+            } else if (sec.fill != val) {
+                // the section is no longer uniform, so allocate storage for it
+                sec.blocks = new BlockStorage(SECTION_NUM_BLOCKS, sec.fill);
+                sec.blocks->set(getSectionIndex(x, y, z), val);
+            }
+
+            // update the column, only rescanning it if its highest block was removed
+            int col = getColumnIndex(x, z);
+            uint64_t bit = 1ULL << (y & 63);
+            if (val.id != ID::AIR) {
+                solid[col][y >> 6] |= bit;
+                if (y > heightmap[col]) heightmap[col] = y;
+            } else {
+                solid[col][y >> 6] &= ~bit;
+                if (y == heightmap[col]) heightmap[col] = calcHeight(solid[col]);
+            }
+
+            // bump the relevant version counters
+            versions.all++;
+            if (x == 0) versions.borders[BORDER_L]++;
+            else if (x == CHUNK_SIZE_X - 1) versions.borders[BORDER_R]++;
+            if (z == 0) versions.borders[BORDER_B]++;
+            else if (z == CHUNK_SIZE_Z - 1) versions.borders[BORDER_T]++;
+
+            editedSections |= 1u << (y / SECTION_SIZE_Y);
             if (rcache.isDirty) {
                 // expand dirtyMin/Max
                 rcache.dirtyMin = glm::min(rcache.dirtyMin, vec3i(x, y, z));
@@ -456,6 +884,75 @@ namespace Blok {
             set(xyz.x, xyz.y, xyz.z, val);
         }
 
+        // set every block in the box [x0, x1) x [y0, y1) x [z0, z1) (in local coordinates) to 'val'
+        // The box is clamped to the chunk. This has the same effect as calling `set()` on each block, but
+        //   the versions and the dirty box are only updated once, and sections that are completely
+        //   covered become uniform, without any storage
+        // See `Blok.cc` for the implementation
+        void fillBox(int x0, int y0, int z0, int x1, int y1, int z1, BlockData val);
+
+        // set the blocks from 'y0' (inclusive) to 'y1' (exclusive) in the column at 'x', 'z' to 'val'
+        void fillColumn(int x, int z, int y0, int y1, BlockData val) {
+            fillBox(x, y0, z, x + 1, y1, z + 1, val);
+        }
+
+        // set every block from 'y0' (inclusive) to 'y1' (exclusive) to 'val', across the whole chunk
+        void fillLayer(int y0, int y1, BlockData val) {
+            fillBox(0, y0, 0, CHUNK_SIZE_X, y1, CHUNK_SIZE_Z, val);
+        }
+
+
+        // recalculate 'heightmap' and 'solid' from the sections, which is required after writing to
+        //   'sections' directly (i.e. when loading a chunk)
+        // See `Blok.cc` for the implementation
+        void rebuildColumns();
+
+        // set 'out' to the bitset (see 'solid') of the blocks in the column at local 'x', 'z' that are not
+        //   air, but have at least one air block on one of their 6 sides, i.e. the only blocks that could
+        //   have visible faces. Above and below the chunk counts as air, and neighbors that aren't loaded
+        //   (see 'rcache') count as solid
+        // See `Blok.cc` for the implementation
+        void getExposed(int x, int z, uint64_t* out) const;
+
+        // set 'out[side]' to the bitset of the blocks in the column at local 'x', 'z' that are not air, but
+        //   have air on that side (see 'Side'), i.e. the blocks with a visible face pointing that way. The
+        //   edges of the chunk are treated the same as `getExposed()`
+        // See `Blok.cc` for the implementation
+        void getFaces(int x, int z, uint64_t out[SIDE_NUM][CHUNK_COLUMN_WORDS]) const;
+
+        // return whether the chunk has been changed since it was generated, loaded, or saved
+        bool isModified() const {
+            return versions.all != cleanVersion;
+        }
+
+        // return whether the section containing local Y coordinate 'y' is entirely air
+        bool isEmptyAt(int y) const {
+            return sections[y / SECTION_SIZE_Y].isEmpty();
+        }
+
+        // compact the storage of all sections, and release the storage of sections that have
+        //   become uniform (i.e. all one block). Generators should call this once they are done
+        // See `Blok.cc` for the implementation
+        void compact();
+
+        // return the number of bytes of memory used by the chunk, including the chunk itself and its block storage
+        // Shared storage is split evenly between the sections sharing it (not counting a `SectionTable`)
+        size_t getMemoryUsage() const {
+            size_t res = sizeof(Chunk);
+            for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+                const BlockStorage* blocks = sections[i].blocks;
+                if (blocks == NULL) continue;
+                int users = blocks->numRefs.load(std::memory_order_relaxed) - (blocks->isInterned.load(std::memory_order_relaxed) ? 1 : 0);
+                res += (sizeof(BlockStorage) + blocks->getBytes()) / glm::max(users, 1);
+            }
+            return res;
+        }
+
+        // return a new chunk at 'id', with the same blocks (and versions) as this one
+        // Sections share their storage with this chunk until either one modifies them, so this is
+        //   very cheap. Entities are not copied
+        // See `Blok.cc` for the implementation
+        Chunk* clone(ChunkID id) const;
 
         // return the world coordinates of the (0, 0, 0) local position 
         vec3i getWorldPos(vec3i xyz=vec3i(0, 0, 0)) {
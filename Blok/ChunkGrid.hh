@@ -0,0 +1,193 @@
+/* ChunkGrid.hh - toroidal grid of values around a center chunk
+ *
+ * Most chunk lookups are near the viewer (i.e. the chunks being rendered, and their neighbors), so
+ *   instead of a tree or hash lookup, chunks inside a W x W window around the center are stored
+ *   directly in a W x W array, at `(X mod W, Z mod W)`. Since the indices wrap around, moving the
+ *   window never has to shift anything, only the cells that fell out of (or came into) the window
+ *   change.
+ *
+ * Anything outside of the window is kept in a fallback map, so the grid is always correct (just
+ *   slower) when it is used far from its center
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_CHUNKGRID_HH__
+#define BLOK_CHUNKGRID_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+namespace Blok {
+
+    // ChunkGrid - a map of ChunkID -> T, which is fastest for IDs near its center
+    template<typename T>
+    class ChunkGrid {
+        public:
+
+        // construct an empty grid, with a window that is '1<<bits' chunks wide, centered at (0, 0)
+        ChunkGrid(int bits=6) {
+            this->bits = bits;
+            W = 1 << bits;
+            mask = W - 1;
+            origin = ChunkID(-W / 2, -W / 2);
+            cells.resize(W * W);
+            num = 0;
+        }
+
+        // move the window so that it is centered on 'center'
+        // Only entries that leave (or enter) the window are moved, so this is cheap if the center
+        //   hasn't moved much (and free if it hasn't moved at all)
+        void recenter(ChunkID center) {
+            ChunkID newOrigin = ChunkID(center.X - W / 2, center.Z - W / 2);
+            if (newOrigin == origin) return;
+            origin = newOrigin;
+            if (num == 0) return;
+
+            // move out anything that is no longer in the window
+            for (Cell& cell : cells) {
+                if (cell.used && !inWindow(cell.id)) {
+                    overflow[cell.id] = cell.val;
+                    cell.used = false;
+                }
+            }
+
+            // and move in anything that is now in the window
+            auto it = overflow.begin();
+            while (it != overflow.end()) {
+                if (inWindow(it->first)) {
+                    Cell& cell = getCell(it->first);
+                    cell.id = it->first;
+                    cell.val = it->second;
+                    cell.used = true;
+                    it = overflow.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        // return whether 'id' is inside of the window (i.e. whether lookups are just an array access)
+        bool inWindow(ChunkID id) const {
+            return (unsigned)(id.X - origin.X) < (unsigned)W && (unsigned)(id.Z - origin.Z) < (unsigned)W;
+        }
+
+        // return a pointer to the value for 'id', or NULL if there is none
+        T* find(ChunkID id) {
+            if (inWindow(id)) {
+                Cell& cell = getCell(id);
+                return cell.used ? &cell.val : NULL;
+            }
+            auto it = overflow.find(id);
+            return it == overflow.end() ? NULL : &it->second;
+        }
+
+        // return the value for 'id', or 'def' if there is none
+        T get(ChunkID id, T def) {
+            T* val = find(id);
+            return val != NULL ? *val : def;
+        }
+
+        // set the value for 'id'
+        void set(ChunkID id, const T& val) {
+            if (inWindow(id)) {
+                Cell& cell = getCell(id);
+                if (!cell.used) num++;
+                cell.id = id;
+                cell.val = val;
+                cell.used = true;
+            } else {
+                if (overflow.find(id) == overflow.end()) num++;
+                overflow[id] = val;
+            }
+        }
+
+        // remove the value for 'id', returning whether there was one
+        bool erase(ChunkID id) {
+            if (inWindow(id)) {
+                Cell& cell = getCell(id);
+                if (!cell.used) return false;
+                cell.used = false;
+            } else {
+                if (overflow.erase(id) == 0) return false;
+            }
+            num--;
+            return true;
+        }
+
+        // remove everything
+        void clear() {
+            if (num == 0) return;
+            for (Cell& cell : cells) {
+                cell.used = false;
+            }
+            overflow.clear();
+            num = 0;
+        }
+
+        // return the number of values in the grid
+        int size() const {
+            return num;
+        }
+
+        // call 'func(id, val)' for each value in the grid (in no particular order)
+        template<typename F>
+        void forEach(F func) {
+            for (Cell& cell : cells) {
+                if (cell.used) func(cell.id, cell.val);
+            }
+            for (auto& entry : overflow) {
+                func(entry.first, entry.second);
+            }
+        }
+
+        private:
+
+        // Cell - a single entry of the window
+        struct Cell {
+
+            // the ID this cell currently holds (since many IDs map to each cell)
+            ChunkID id;
+
+            // whether or not the cell holds anything
+            bool used;
+
+            // the value
+            T val;
+
+            Cell() {
+                used = false;
+                val = T();
+            }
+
+        };
+
+        // the number of bits of the width of the window
+        int bits;
+
+        // the width of the window, and the mask to wrap an ID into it
+        int W, mask;
+
+        // the smallest ID in the window
+        ChunkID origin;
+
+        // the cells of the window, indexed by `((Z mod W) << bits) | (X mod W)`
+        List<Cell> cells;
+
+        // values outside of the window
+        Map<ChunkID, T> overflow;
+
+        // the total number of values
+        int num;
+
+        // return the cell that 'id' maps to
+        Cell& getCell(ChunkID id) {
+            return cells[((id.Z & mask) << bits) | (id.X & mask)];
+        }
+
+    };
+
+}
+
+#endif /* BLOK_CHUNKGRID_HH__ */
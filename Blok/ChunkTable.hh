@@ -0,0 +1,296 @@
+/* ChunkTable.hh - read-mostly table of loaded chunks
+ *
+ * Every frame, the client looks up hundreds of chunks (and raycasts look up one per chunk they
+ *   cross), while the generator threads only add a few chunks here and there. So, lookups should
+ *   never have to wait on a lock that a generator thread is holding.
+ *
+ * This is an open addressing hash table (linear probing), whose slots are only ever written by a
+ *   single writer at a time (which holds a lock outside of the table), and read by anyone without
+ *   any locks:
+ *
+ *   * A slot's key is written once (after its value), and never changes, so readers either see an
+ *       empty slot, or a fully inserted one
+ *   * Removing a chunk just clears the value, leaving the key as a tombstone (which is reused if the
+ *       same chunk is inserted again)
+ *   * When the table fills up (with live entries or tombstones), a new table is built, published
+ *       atomically, and the old one is 'retired'. Retired tables are only freed once no readers are
+ *       active, since a reader may still be probing them
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_CHUNKTABLE_HH__
+#define BLOK_CHUNKTABLE_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+#include <atomic>
+
+namespace Blok {
+
+    // ChunkTable - a map of ChunkID -> Chunk*, with lock-free lookups
+    // `find()` may be called from any thread, at any time. All other methods modify (or iterate)
+    //   the table, and must only be called by one thread at a time (i.e. with a lock held)
+    class ChunkTable {
+
+        // Slot - a single entry of the table
+        struct Slot {
+
+            // the key (see `getKey()`), or EMPTY_KEY if the slot has never been used
+            std::atomic<uint64_t> key;
+
+            // the chunk, or NULL if it has been removed
+            std::atomic<Chunk*> val;
+
+        };
+
+        // Table - an array of slots, which is replaced (but never resized) when it fills up
+        struct Table {
+
+            // the number of slots, which is always a power of 2
+            int cap;
+
+            // the number of slots with a key (i.e. live entries and tombstones)
+            int numUsed;
+
+            // the slots themselves
+            Slot* slots;
+
+            Table(int cap) {
+                this->cap = cap;
+                numUsed = 0;
+                slots = new Slot[cap];
+                for (int i = 0; i < cap; ++i) {
+                    slots[i].key.store(EMPTY_KEY, std::memory_order_relaxed);
+                    slots[i].val.store(NULL, std::memory_order_relaxed);
+                }
+            }
+
+            ~Table() {
+                delete[] slots;
+            }
+
+        };
+
+        public:
+
+        // iterator - iterates through all the chunks in the table (only valid for the writer)
+        class iterator {
+            public:
+
+            iterator(const Table* table, int i) {
+                this->table = table;
+                this->i = i;
+                skip();
+            }
+
+            Chunk* operator*() const {
+                return table->slots[i].val.load(std::memory_order_relaxed);
+            }
+
+            iterator& operator++() {
+                i++;
+                skip();
+                return *this;
+            }
+
+            bool operator!=(const iterator& other) const {
+                return i != other.i;
+            }
+
+            private:
+
+            const Table* table;
+            int i;
+
+            // move forward to the next live entry
+            void skip() {
+                while (i < table->cap && table->slots[i].val.load(std::memory_order_relaxed) == NULL) i++;
+            }
+
+        };
+
+        // construct an empty table
+        ChunkTable() : numLive(0), numReaders(0) {
+            cur.store(new Table(MIN_CAP));
+        }
+
+        // free all tables (but not the chunks in them)
+        ~ChunkTable() {
+            delete cur.load();
+            for (Table* table : retired) {
+                delete table;
+            }
+        }
+
+        // the table owns its slots, so it should not be copied
+        ChunkTable(const ChunkTable& other) = delete;
+        ChunkTable& operator=(const ChunkTable& other) = delete;
+
+        // return the chunk 'id', or NULL if it isn't in the table
+        // This never blocks, and is safe to call from any thread, at any time
+        Chunk* find(ChunkID id) const {
+            // announce ourselves first, so that the writer won't free the table we are about to read
+            numReaders.fetch_add(1);
+            const Table* table = cur.load();
+
+            uint64_t key = getKey(id);
+            int mask = table->cap - 1;
+            Chunk* ret = NULL;
+            for (int i = getHash(key) & mask; ; i = (i + 1) & mask) {
+                uint64_t k = table->slots[i].key.load(std::memory_order_acquire);
+                if (k == key) {
+                    // NOTE: NULL if it was removed, and keys only ever appear once in a table
+                    ret = table->slots[i].val.load(std::memory_order_acquire);
+                    break;
+                } else if (k == EMPTY_KEY) {
+                    break;
+                }
+            }
+
+            numReaders.fetch_sub(1, std::memory_order_release);
+            return ret;
+        }
+
+        // add (or replace) the chunk 'id'
+        void insert(ChunkID id, Chunk* chunk) {
+            Table* table = cur.load(std::memory_order_relaxed);
+
+            // keep the load factor (including tombstones) under 1/2, so probes stay short
+            if (2 * (table->numUsed + 1) > table->cap) {
+                int cap = MIN_CAP;
+                while (cap < 4 * (numLive + 1)) cap *= 2;
+                table = rebuild(cap);
+            }
+
+            uint64_t key = getKey(id);
+            int mask = table->cap - 1;
+            for (int i = getHash(key) & mask; ; i = (i + 1) & mask) {
+                Slot& slot = table->slots[i];
+                uint64_t k = slot.key.load(std::memory_order_relaxed);
+                if (k == key) {
+                    if (slot.val.load(std::memory_order_relaxed) == NULL) numLive.store(numLive + 1, std::memory_order_relaxed);
+                    slot.val.store(chunk, std::memory_order_release);
+                    return;
+                } else if (k == EMPTY_KEY) {
+                    // the value must be visible before the key is
+                    slot.val.store(chunk, std::memory_order_relaxed);
+                    slot.key.store(key, std::memory_order_release);
+                    table->numUsed++;
+                    numLive.store(numLive + 1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        // remove the chunk 'id', returning whether it was in the table
+        bool erase(ChunkID id) {
+            Table* table = cur.load(std::memory_order_relaxed);
+
+            uint64_t key = getKey(id);
+            int mask = table->cap - 1;
+            for (int i = getHash(key) & mask; ; i = (i + 1) & mask) {
+                Slot& slot = table->slots[i];
+                uint64_t k = slot.key.load(std::memory_order_relaxed);
+                if (k == key) {
+                    if (slot.val.load(std::memory_order_relaxed) == NULL) return false;
+                    slot.val.store(NULL, std::memory_order_release);
+                    numLive.store(numLive - 1, std::memory_order_relaxed);
+                    return true;
+                } else if (k == EMPTY_KEY) {
+                    return false;
+                }
+            }
+        }
+
+        // free any retired tables, if no readers are in the middle of a lookup. Returns the number of
+        //   tables still waiting to be freed
+        // This is called automatically whenever a table is retired, but should also be called
+        //   periodically (i.e. once a frame) to clean up tables that readers were using at the time
+        int reclaim() {
+            if (retired.size() > 0 && numReaders.load() == 0) {
+                for (Table* table : retired) {
+                    delete table;
+                }
+                retired.clear();
+            }
+            return retired.size();
+        }
+
+        // return the number of chunks in the table (which is safe from any thread, but may be out of date)
+        int size() const {
+            return numLive.load(std::memory_order_relaxed);
+        }
+
+        iterator begin() const {
+            return iterator(cur.load(std::memory_order_relaxed), 0);
+        }
+
+        iterator end() const {
+            const Table* table = cur.load(std::memory_order_relaxed);
+            return iterator(table, table->cap);
+        }
+
+        private:
+
+        // the smallest number of slots in a table
+        static const int MIN_CAP = 256;
+
+        // the key of a slot that hasn't been used, which is the (never loaded) chunk at the very
+        //   corner of the world
+        static const uint64_t EMPTY_KEY = 0x8000000080000000ULL;
+
+        // the current table
+        std::atomic<Table*> cur;
+
+        // the number of chunks in the table
+        std::atomic<int> numLive;
+
+        // the number of threads currently inside of `find()`
+        mutable std::atomic<int> numReaders;
+
+        // tables that have been replaced, but may still be in use by readers
+        List<Table*> retired;
+
+        // return the key for a chunk ID, which packs both coordinates
+        static uint64_t getKey(ChunkID id) {
+            return ((uint64_t)(uint32_t)id.X << 32) | (uint32_t)id.Z;
+        }
+
+        // return the hash of a key (fibonacci hashing, which spreads out nearby chunks)
+        static uint32_t getHash(uint64_t key) {
+            return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+        }
+
+        // replace the current table with a new one of 'cap' slots, holding only the live entries, and
+        //   return it
+        Table* rebuild(int cap) {
+            Table* old = cur.load(std::memory_order_relaxed);
+            Table* table = new Table(cap);
+            int mask = cap - 1;
+            for (int j = 0; j < old->cap; ++j) {
+                Chunk* chunk = old->slots[j].val.load(std::memory_order_relaxed);
+                if (chunk == NULL) continue;
+                uint64_t key = old->slots[j].key.load(std::memory_order_relaxed);
+                int i = getHash(key) & mask;
+                while (table->slots[i].key.load(std::memory_order_relaxed) != EMPTY_KEY) i = (i + 1) & mask;
+                table->slots[i].key.store(key, std::memory_order_relaxed);
+                table->slots[i].val.store(chunk, std::memory_order_relaxed);
+                table->numUsed++;
+            }
+
+            // NOTE: this store (and the check of 'numReaders' in `reclaim()`) is sequentially consistent,
+            //   so any reader that could have seen 'old' is counted
+            cur.store(table);
+            retired.push_back(old);
+            reclaim();
+            return table;
+        }
+
+    };
+
+}
+
+#endif /* BLOK_CHUNKTABLE_HH__ */
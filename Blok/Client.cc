@@ -59,6 +59,9 @@ Client::Client(Server* server, int w, int h) {
     dirtyClient = this;
     this->server = server;
 
+    viewDist = 10;
+    view = NULL;
+
     // create an audio engine
     //this->aEngine = new Audio::Engine();
 
@@ -152,6 +155,9 @@ if (!gladLoadGL((GLADloadfunc)glfwGetProcAddress))
 // destroy a client
 Client::~Client() {
     if (dirtyClient == this) dirtyClient = NULL;
+
+    // stop getting updates about chunks
+    if (view != NULL) server->unsubscribe(view);
     // this was constructed for the client
     delete gfx.renderer;
 
@@ -195,25 +201,37 @@ bool Client::frame() {
     ChunkID rendid = { (int)(floor(gfx.renderer->pos.x / CHUNK_SIZE_Z)), (int)(floor(gfx.renderer->pos.z / CHUNK_SIZE_Z)) };
 
     // view distance in chunks
-    int N = 10;
-    // render all these chunks
-    for (int X = -N; X <= N; ++X) {
-        for (int Z = -N; Z <= N; ++Z) {
-
-            if (X * X + Z * Z > N * N) continue;
-            
-            // get the current local chunk ID
-            ChunkID cid = {rendid.X + X, rendid.Z + Z};
+    int N = viewDist;
 
-            // get our chunk from the server
-            Chunk* chunk = server->getChunk(cid);
-
-            // now, render it, if it is currently loaded
-            if (chunk != NULL) gfx.renderer->renderChunk(cid, chunk);
+    // let the server know where we are looking, so it can generate the chunks we need first
+    // The field of view is vertical, so convert it to horizontal
+    float halfFOV = atanf(tanf(glm::radians(gfx.renderer->FOV) / 2.0f) * gfx.renderer->width / gfx.renderer->height);
+    server->setViewer(gfx.renderer->pos, gfx.renderer->forward, halfFOV, N);
 
+    // keep our view centered on us (which does nothing unless we moved to another chunk)
+    if (view == NULL) {
+        view = server->subscribe(rendid, N);
+    } else {
+        server->moveSubscription(view, rendid, N);
+    }
+    visible.recenter(rendid);
+
+    // catch up on what happened to the chunks in view
+    ChunkEvent ev;
+    while (view->events.pop(ev)) {
+        if (ev.kind == ChunkEvent::EVENT_LEFT_VIEW) {
+            visible.erase(ev.id);
+        } else {
+            // NOTE: for changes, the renderer notices the new version by itself
+            visible.set(ev.id, ev.chunk);
         }
     }
 
+    // render all the chunks in view
+    visible.forEach([&](ChunkID cid, Chunk* chunk) {
+        gfx.renderer->renderChunk(cid, chunk);
+    });
+
     // now, render entities
     for (auto& kvp : server->loadedEntities) {
         Render::RenderData rd = kvp.second->getRender();
@@ -245,17 +263,9 @@ bool Client::frame() {
         if (input.mouseButtons[GLFW_MOUSE_BUTTON_RIGHT] && !input.lastMouseButtons[GLFW_MOUSE_BUTTON_RIGHT]) {
             // place block
 
-            // TODO: call a server->setBlock() method
-
             // compute one block off
             vec3i targetPos = vec3i(glm::floor(vec3(hit.blockPos) + hit.normal));
-            if (targetPos.y >= 0 && targetPos.y < CHUNK_SIZE_Y) {
-                // set it
-                Chunk* cur = server->getChunk(ChunkID::fromPos(targetPos), false);
-                vec3i localPos = targetPos - cur->getWorldPos();
-
-                cur->set(localPos.x, localPos.y, localPos.z, {ID::STONE});
-
+            if (server->setBlock(targetPos, {ID::STONE})) {
                 // play sound
                 Audio::Buffer* bk = Audio::Buffer::loadConst("assets/audio/sfx/PlaceBlock.ogg");
                 aEngine->play(bk);
@@ -265,10 +275,7 @@ bool Client::frame() {
 
         } else if (input.mouseButtons[GLFW_MOUSE_BUTTON_LEFT] && !input.lastMouseButtons[GLFW_MOUSE_BUTTON_LEFT]) {
             // delete block
-            Chunk* cur = server->getChunk(ChunkID::fromPos(hit.blockPos), false);
-            vec3i localPos = hit.blockPos - cur->getWorldPos();
-
-            cur->set(localPos.x, localPos.y, localPos.z, {ID::AIR});
+            server->setBlock(hit.blockPos, {ID::AIR});
 
             // play sound
             Audio::Buffer* bk = Audio::Buffer::loadConst("assets/audio/sfx/BreakBlock.ogg");
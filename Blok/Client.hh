@@ -105,6 +105,15 @@ namespace Blok {
         // the internal server/engine
         Server* server;
 
+        // the view distance, in chunks
+        int viewDist;
+
+        // our subscription to the chunks in view (created on the first frame)
+        Subscription* view;
+
+        // the chunks in view that are loaded, which is kept up to date from the events on 'view'
+        ChunkGrid<Chunk*> visible;
+
         // construct a new client, given the server, and window size
         Client(Server* server, int w, int h);
 
@@ -41,6 +41,11 @@ namespace Blok {
             this->uuid = uuid;
         }
 
+        // entities are deleted through 'Entity*', so the subclass destructor must be called
+        virtual ~Entity() {
+            // do nothing by default
+        }
+
     };
 
 
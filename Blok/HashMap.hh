@@ -0,0 +1,433 @@
+/* HashMap.hh - flat open addressing hash maps & sets
+ *
+ * `Map` and `Set` are tree based (see Blok.hh), so every entry is a separate allocation, and every
+ *   lookup chases a pointer per level. That's fine for most things, but containers that are hit every
+ *   frame (the chunk mesh tables, resource caches, etc) should use these instead.
+ *
+ * Entries are stored in a flat array, which is probed linearly from the hash of the key. Next to
+ *   that is an array of control bytes (one per slot), in the style of Swiss tables:
+ *
+ *   * CTRL_EMPTY: the slot has never been used (which ends a probe)
+ *   * CTRL_DELETED: the slot was erased (a 'tombstone', which does not end a probe)
+ *   * otherwise, the slot is full, and the byte holds the low 7 bits of the key's hash, so most
+ *       slots that don't match can be skipped without comparing keys
+ *
+ * Since erasing only marks the slot, iterators stay valid through `erase()` (which returns the next
+ *   one), but inserting may rehash, which invalidates all iterators and references
+ *
+ * Keys need a `Hash<K>` (see below), and `operator==`
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_HASHMAP_HH__
+#define BLOK_HASHMAP_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+namespace Blok {
+
+    /* HASH FUNCTIONS */
+
+    // mix all the bits of 'h' together, so that similar inputs give very different outputs
+    // (this is the finalizer from MurmurHash3)
+    static inline uint64_t hashMix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // combine two hashes into one (order matters)
+    static inline uint64_t hashCombine(uint64_t a, uint64_t b) {
+        return hashMix(a ^ (b + 0x9E3779B97F4A7C15ULL + (a << 6) + (a >> 2)));
+    }
+
+    // Hash - a function object giving a well mixed 64 bit hash of a 'T'
+    // Specialize this to use other types as keys
+    template<typename T>
+    struct Hash;
+
+    // integers just need to be mixed
+    #define BLOK_HASH_INT(T) \
+    template<> \
+    struct Hash<T> { \
+        uint64_t operator()(T val) const { \
+            return hashMix((uint64_t)val); \
+        } \
+    };
+
+    BLOK_HASH_INT(char)
+    BLOK_HASH_INT(int)
+    BLOK_HASH_INT(unsigned int)
+    BLOK_HASH_INT(long)
+    BLOK_HASH_INT(unsigned long)
+    BLOK_HASH_INT(long long)
+    BLOK_HASH_INT(unsigned long long)
+
+    #undef BLOK_HASH_INT
+
+    // pointers are hashed by address (their low bits are usually zero, which mixing takes care of)
+    template<typename T>
+    struct Hash<T*> {
+        uint64_t operator()(T* val) const {
+            return hashMix((uint64_t)(uintptr_t)val);
+        }
+    };
+
+    // strings use FNV-1a over their characters
+    template<>
+    struct Hash<String> {
+        uint64_t operator()(const String& val) const {
+            uint64_t h = 0xCBF29CE484222325ULL;
+            for (char c : val) {
+                h = (h ^ (uint8_t)c) * 0x100000001B3ULL;
+            }
+            return hashMix(h);
+        }
+    };
+
+    // chunk IDs pack both coordinates into one word
+    template<>
+    struct Hash<ChunkID> {
+        uint64_t operator()(ChunkID val) const {
+            return hashMix(((uint64_t)(uint32_t)val.X << 32) | (uint32_t)val.Z);
+        }
+    };
+
+    // pairs combine the hashes of both elements
+    template<typename A, typename B>
+    struct Hash< Pair<A, B> > {
+        uint64_t operator()(const Pair<A, B>& val) const {
+            return hashCombine(Hash<A>()(val.first), Hash<B>()(val.second));
+        }
+    };
+
+
+    // HashTable - the implementation shared by `HashMap` and `HashSet`, which store 'Slot's, whose
+    //   keys are given by `GetKey::get(slot)`
+    template<typename Slot, typename K, typename GetKey, typename H>
+    class HashTable {
+        public:
+
+        // Iterator - iterates through the full slots (of a 'Table', which may be const)
+        template<typename Table, typename Ref>
+        class Iterator {
+            public:
+
+            Iterator(Table* table=NULL, size_t i=0) {
+                this->table = table;
+                this->i = i;
+                if (table != NULL) skip();
+            }
+
+            Ref& operator*() const {
+                return table->slots[i];
+            }
+
+            Ref* operator->() const {
+                return &table->slots[i];
+            }
+
+            Iterator& operator++() {
+                i++;
+                skip();
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator ret = *this;
+                ++*this;
+                return ret;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return i == other.i;
+            }
+
+            bool operator!=(const Iterator& other) const {
+                return i != other.i;
+            }
+
+            // the index of the slot
+            size_t i;
+
+            private:
+
+            Table* table;
+
+            // move forward to the next full slot
+            void skip() {
+                while (i < table->ctrl.size() && !isFull(table->ctrl[i])) i++;
+            }
+
+        };
+
+        typedef Iterator<HashTable, Slot> iterator;
+        typedef Iterator<const HashTable, const Slot> const_iterator;
+
+        HashTable() {
+            num = 0;
+            numDeleted = 0;
+            mask = 0;
+        }
+
+        // return the number of entries
+        size_t size() const {
+            return num;
+        }
+
+        bool empty() const {
+            return num == 0;
+        }
+
+        // remove all entries (but keep the capacity)
+        void clear() {
+            if (num == 0 && numDeleted == 0) return;
+            for (size_t i = 0; i < ctrl.size(); ++i) {
+                if (isFull(ctrl[i])) slots[i] = Slot();
+                ctrl[i] = CTRL_EMPTY;
+            }
+            num = 0;
+            numDeleted = 0;
+        }
+
+        // make sure 'n' entries fit without rehashing
+        void reserve(size_t n) {
+            size_t cap = MIN_CAP;
+            while (cap * 3 < n * 4) cap *= 2;
+            if (cap > ctrl.size()) rehash(cap);
+        }
+
+        iterator begin() {
+            return iterator(this, 0);
+        }
+        iterator end() {
+            return iterator(this, ctrl.size());
+        }
+        const_iterator begin() const {
+            return const_iterator(this, 0);
+        }
+        const_iterator end() const {
+            return const_iterator(this, ctrl.size());
+        }
+
+        iterator find(const K& key) {
+            return iterator(this, findIndex(key));
+        }
+        const_iterator find(const K& key) const {
+            return const_iterator(this, findIndex(key));
+        }
+
+        // return the number of entries with 'key' (i.e. 0 or 1)
+        size_t count(const K& key) const {
+            return findIndex(key) < ctrl.size() ? 1 : 0;
+        }
+
+        // remove the entry with 'key', returning how many were removed (i.e. 0 or 1)
+        size_t erase(const K& key) {
+            size_t i = findIndex(key);
+            if (i >= ctrl.size()) return 0;
+            eraseIndex(i);
+            return 1;
+        }
+
+        // remove the entry at 'it', returning an iterator to the next entry
+        template<typename It>
+        It erase(It it) {
+            eraseIndex(it.i);
+            return ++it;
+        }
+
+        protected:
+
+        // control bytes (see the top of this file)
+        static const uint8_t CTRL_EMPTY = 0x80;
+        static const uint8_t CTRL_DELETED = 0xFE;
+
+        // the smallest (non-zero) number of slots
+        static const size_t MIN_CAP = 16;
+
+        // the control byte for each slot
+        List<uint8_t> ctrl;
+
+        // the slots themselves
+        List<Slot> slots;
+
+        // the number of full slots, and the number of tombstones
+        size_t num, numDeleted;
+
+        // the number of slots minus 1 (which is always a power of 2 minus 1)
+        size_t mask;
+
+        // return whether a control byte is a full slot
+        static bool isFull(uint8_t c) {
+            return (c & 0x80) == 0;
+        }
+
+        // return the index of the slot with 'key', or `ctrl.size()` if there is none
+        size_t findIndex(const K& key) const {
+            if (num == 0) return ctrl.size();
+            uint64_t h = H()(key);
+            uint8_t h2 = h & 0x7F;
+            for (size_t i = (h >> 7) & mask; ; i = (i + 1) & mask) {
+                uint8_t c = ctrl[i];
+                if (c == h2 && GetKey::get(slots[i]) == key) return i;
+                if (c == CTRL_EMPTY) return ctrl.size();
+            }
+        }
+
+        // return the index of the slot with 'key', adding it (with `GetKey::make(key)`) if it isn't there
+        // 'added' is set to whether it was added
+        size_t insertIndex(const K& key, bool& added) {
+            // keep the load (including tombstones) under 3/4, so probes stay short
+            if (4 * (num + numDeleted + 1) > 3 * ctrl.size()) {
+                // if it's mostly tombstones, just clean them up, otherwise grow
+                size_t cap = ctrl.size() < MIN_CAP ? MIN_CAP : ctrl.size();
+                if (4 * (num + 1) > 2 * cap) cap *= 2;
+                rehash(cap);
+            }
+
+            uint64_t h = H()(key);
+            uint8_t h2 = h & 0x7F;
+            size_t firstFree = ctrl.size();
+            for (size_t i = (h >> 7) & mask; ; i = (i + 1) & mask) {
+                uint8_t c = ctrl[i];
+                if (c == h2 && GetKey::get(slots[i]) == key) {
+                    added = false;
+                    return i;
+                }
+                if (c == CTRL_DELETED && firstFree == ctrl.size()) {
+                    firstFree = i;
+                } else if (c == CTRL_EMPTY) {
+                    // reuse a tombstone from earlier in the probe, if there was one
+                    if (firstFree == ctrl.size()) {
+                        firstFree = i;
+                    } else {
+                        numDeleted--;
+                    }
+                    ctrl[firstFree] = h2;
+                    slots[firstFree] = GetKey::make(key);
+                    num++;
+                    added = true;
+                    return firstFree;
+                }
+            }
+        }
+
+        // erase the full slot 'i'
+        void eraseIndex(size_t i) {
+            slots[i] = Slot();
+            // if the next slot is empty, no probe can go through this one, so it can be empty too
+            if (ctrl[(i + 1) & mask] == CTRL_EMPTY) {
+                ctrl[i] = CTRL_EMPTY;
+            } else {
+                ctrl[i] = CTRL_DELETED;
+                numDeleted++;
+            }
+            num--;
+        }
+
+        // move everything into 'cap' slots, dropping all tombstones
+        void rehash(size_t cap) {
+            List<uint8_t> oldCtrl(cap, CTRL_EMPTY);
+            List<Slot> oldSlots(cap);
+            oldCtrl.swap(ctrl);
+            oldSlots.swap(slots);
+            mask = cap - 1;
+            numDeleted = 0;
+
+            for (size_t j = 0; j < oldCtrl.size(); ++j) {
+                if (!isFull(oldCtrl[j])) continue;
+                uint64_t h = H()(GetKey::get(oldSlots[j]));
+                size_t i = (h >> 7) & mask;
+                while (ctrl[i] != CTRL_EMPTY) i = (i + 1) & mask;
+                ctrl[i] = h & 0x7F;
+                slots[i] = std::move(oldSlots[j]);
+            }
+        }
+
+    };
+
+    // the keys of the slots of `HashMap`
+    template<typename K, typename V>
+    struct HashMapKey {
+        static const K& get(const Pair<K, V>& slot) {
+            return slot.first;
+        }
+        static Pair<K, V> make(const K& key) {
+            return Pair<K, V>(key, V());
+        }
+    };
+
+    // HashMap - a flat hash table of 'K' -> 'V', which works like `Map<K, V>` (but unordered)
+    // Iteration gives `Pair<K, V>`s, whose keys must not be modified
+    template<typename K, typename V, typename H=Hash<K> >
+    class HashMap : public HashTable<Pair<K, V>, K, HashMapKey<K, V>, H> {
+        typedef HashTable<Pair<K, V>, K, HashMapKey<K, V>, H> Base;
+        public:
+
+        typedef typename Base::iterator iterator;
+
+        // return the value for 'key', adding a default one if there isn't one
+        V& operator[](const K& key) {
+            bool added;
+            return this->slots[this->insertIndex(key, added)].second;
+        }
+
+        // add 'entry', if its key isn't already in the map, returning where it is, and whether it was added
+        Pair<iterator, bool> insert(const Pair<K, V>& entry) {
+            bool added;
+            size_t i = this->insertIndex(entry.first, added);
+            if (added) this->slots[i].second = entry.second;
+            return Pair<iterator, bool>(iterator(this, i), added);
+        }
+
+    };
+
+    // the keys of the slots of `HashSet`
+    template<typename K>
+    struct HashSetKey {
+        static const K& get(const K& slot) {
+            return slot;
+        }
+        static K make(const K& key) {
+            return key;
+        }
+    };
+
+    // HashSet - a flat hash table of 'K', which works like `Set<K>` (but unordered)
+    template<typename K, typename H=Hash<K> >
+    class HashSet : public HashTable<K, K, HashSetKey<K>, H> {
+        typedef HashTable<K, K, HashSetKey<K>, H> Base;
+        public:
+
+        // elements can't be modified, so all iterators are const
+        typedef typename Base::const_iterator iterator;
+
+        iterator begin() const {
+            return Base::begin();
+        }
+        iterator end() const {
+            return Base::end();
+        }
+        iterator find(const K& key) const {
+            return Base::find(key);
+        }
+
+        // add 'key', if it isn't already in the set, returning where it is, and whether it was added
+        Pair<iterator, bool> insert(const K& key) {
+            bool added;
+            size_t i = this->insertIndex(key, added);
+            return Pair<iterator, bool>(iterator(this, i), added);
+        }
+
+    };
+
+}
+
+#endif /* BLOK_HASHMAP_HH__ */
@@ -0,0 +1,825 @@
+/* NoiseGraph.hh - composable noise, compiled into flat evaluation plans
+ *
+ * Terrain is usually a handful of noise sources (i.e. fBm octaves), bent and combined with simple
+ *   operations (clamping, remapping, blending, splines). Writing these by hand as chains of `noise2d()`
+ *   calls is tedious, and slow, since every sample goes through every step one at a time.
+ *
+ * Instead, a `NoiseGraph` is built up node by node, and compiled into a `NoisePlan`, which is a flat
+ *   list of operations that each run over a whole grid of samples at once:
+ *
+ *   * Constant parts of the graph are evaluated while compiling
+ *   * Affine steps (remaps, and adding or multiplying by constants) are folded into the operation that
+ *       consumes them (clamps, splines, other remaps), instead of making a pass of their own
+ *   * Sums of Perlin layers (i.e. fBm) are a single operation, which adds each layer into the same buffer
+ *   * Perlin layers that aren't domain warped are sampled with the grid routines (see
+ *       `Perlin::noise2dGrid()`), which share work between neighboring samples
+ *   * Buffers are reused once nothing else needs them
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_NOISEGRAPH_HH__
+#define BLOK_NOISEGRAPH_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+// for the noise sources
+#include <Blok/Random.hh>
+
+// for the compiler's memo of what has been emitted
+#include <Blok/HashMap.hh>
+
+#include <limits>
+#include <algorithm>
+
+namespace Blok::Random {
+
+    // forward declaration
+    class NoiseGraph;
+
+    // NoisePlan - a compiled `NoiseGraph`, which evaluates it over grids of points
+    // Evaluating keeps no state between calls, so a plan can be used by many threads at once
+    class NoisePlan {
+        public:
+
+        // construct an empty plan, which should be assigned one from `NoiseGraph::compile()` before use
+        NoisePlan() {
+            numRegs = numCoords = 0;
+            result = -1;
+        }
+
+        // evaluate the graph over a grid of 'nx*ny' points, setting 'out[i*ny+j]' to its value at
+        //   (x0+i, y0+j), in the same order as `Perlin::noise2dGrid()`
+        void eval2d(double x0, double y0, int nx, int ny, double* out) {
+            eval(2, x0, y0, 0.0, nx, ny, 1, out);
+        }
+
+        // evaluate the graph over a grid of 'nx*ny*nz' points, setting 'out[(i*nz+k)*ny+j]' to its
+        //   value at (x0+i, y0+j, z0+k), in the same order as `Perlin::noise3dGrid()`
+        void eval3d(double x0, double y0, double z0, int nx, int ny, int nz, double* out) {
+            eval(3, x0, y0, z0, nx, ny, nz, out);
+        }
+
+        // return the number of operations in the plan
+        int size() const {
+            return ops.size();
+        }
+
+        // return the number of buffers the plan needs (each of which holds a value for every point)
+        int getNumRegs() const {
+            return numRegs;
+        }
+
+        private:
+
+        friend class NoiseGraph;
+
+        // Op - a single operation, which writes a value for every point to 'dst'
+        struct Op {
+
+            enum Kind {
+
+                // dst = val
+                OP_CONST,
+
+                // dst = sum of 'layers' (each with its own affine transform) + val
+                OP_PERLIN,
+
+                // dst = clamp(a * mul + add, lo, hi)
+                OP_AFFINE,
+
+                // dst = a + b, a * b, min(a, b), max(a, b)
+                OP_ADD,
+                OP_MUL,
+                OP_MIN,
+                OP_MAX,
+
+                // dst = a + c * (b - a)
+                OP_BLEND,
+
+                // dst = splines[spline](a * mul + add)
+                OP_SPLINE,
+
+                // coordinates 'dst' = coordinates 'coords' + (a, b, c), where any of them may be -1
+                OP_WARP,
+
+            } kind;
+
+            // the register written to (or for OP_WARP, the coordinate set)
+            int dst;
+
+            // the registers read from, or -1 if unused
+            int a, b, c;
+
+            // the coordinate set that noise is sampled at (0 is the grid itself)
+            int coords;
+
+            // constant parameters, depending on the kind
+            double val, mul, add, lo, hi;
+
+            // for OP_PERLIN, the index of the first layer in 'layers', and how many there are
+            int layer, numLayers;
+
+            // for OP_SPLINE, the index into 'splines'
+            int spline;
+
+            Op(Kind kind) {
+                this->kind = kind;
+                dst = a = b = c = -1;
+                coords = 0;
+                val = add = 0.0;
+                mul = 1.0;
+                lo = -std::numeric_limits<double>::infinity();
+                hi = std::numeric_limits<double>::infinity();
+                layer = numLayers = spline = 0;
+            }
+
+        };
+
+        // Layer - a Perlin layer of an OP_PERLIN, which is added as 'noise * mul + add'
+        struct Layer {
+
+            Perlin perlin;
+            double mul, add;
+
+        };
+
+        // the operations, in the order they are run
+        List<Op> ops;
+
+        // the layers of all OP_PERLIN operations
+        List<Layer> layers;
+
+        // the control points of all OP_SPLINE operations, sorted by X
+        List< List< Pair<double, double> > > splines;
+
+        // the number of registers (value buffers), and coordinate sets (other than the grid)
+        int numRegs, numCoords;
+
+        // the register holding the result
+        int result;
+
+        // evaluate a piecewise linear spline (which is constant past either end), which must have at least
+        //   one point
+        static double evalSpline(const List< Pair<double, double> >& pts, double x) {
+            if (x <= pts[0].first) return pts[0].second;
+            for (size_t i = 1; i < pts.size(); ++i) {
+                if (x < pts[i].first) {
+                    double t = (x - pts[i - 1].first) / (pts[i].first - pts[i - 1].first);
+                    return pts[i - 1].second + t * (pts[i].second - pts[i - 1].second);
+                }
+            }
+            return pts.back().second;
+        }
+
+        // evaluate the plan in 'dims' (2 or 3) dimensions
+        void eval(int dims, double x0, double y0, double z0, int nx, int ny, int nz, double* out) {
+            int n = nx * ny * nz;
+            List< List<double> > regs(numRegs, List<double>(n));
+
+            // the coordinates of every point, for each coordinate set (only filled in if something is
+            //   warped)
+            List< List<double> > cx(numCoords + 1), cy(numCoords + 1), cz(numCoords + 1);
+            if (numCoords > 0) {
+                cx[0].resize(n);
+                cy[0].resize(n);
+                cz[0].resize(n);
+                for (int i = 0; i < nx; ++i) {
+                    for (int k = 0; k < nz; ++k) {
+                        for (int j = 0; j < ny; ++j) {
+                            int idx = (i * nz + k) * ny + j;
+                            cx[0][idx] = x0 + i;
+                            cy[0][idx] = y0 + j;
+                            cz[0][idx] = z0 + k;
+                        }
+                    }
+                }
+            }
+
+            for (const Op& op : ops) {
+                double* dst = op.kind == Op::OP_WARP ? NULL : &regs[op.dst][0];
+                const double* a = op.a >= 0 ? &regs[op.a][0] : NULL;
+                const double* b = op.b >= 0 ? &regs[op.b][0] : NULL;
+                const double* c = op.c >= 0 ? &regs[op.c][0] : NULL;
+
+                if (op.kind == Op::OP_CONST) {
+                    for (int i = 0; i < n; ++i) dst[i] = op.val;
+
+                } else if (op.kind == Op::OP_PERLIN) {
+                    for (int l = 0; l < op.numLayers; ++l) {
+                        Layer& layer = layers[op.layer + l];
+                        bool identity = layer.mul == 1.0 && layer.add == 0.0;
+
+                        // sample into the destination directly if possible, otherwise into a temporary
+                        List<double> tmp;
+                        double* smp = dst;
+                        if (!identity) {
+                            tmp.resize(n);
+                            smp = &tmp[0];
+                        }
+                        bool add = identity && l > 0;
+
+                        if (op.coords == 0) {
+                            if (dims == 2) layer.perlin.noise2dGrid(x0, y0, nx, ny, smp, add);
+                            else layer.perlin.noise3dGrid(x0, y0, z0, nx, ny, nz, smp, add);
+                        } else {
+                            const double* px = &cx[op.coords][0];
+                            const double* py = &cy[op.coords][0];
+                            const double* pz = &cz[op.coords][0];
+                            for (int i = 0; i < n; ++i) {
+                                double v = dims == 2 ? layer.perlin.noise2d(px[i], py[i]) : layer.perlin.noise3d(px[i], py[i], pz[i]);
+                                smp[i] = add ? smp[i] + v : v;
+                            }
+                        }
+
+                        if (!identity) {
+                            if (l > 0) for (int i = 0; i < n; ++i) dst[i] += smp[i] * layer.mul + layer.add;
+                            else for (int i = 0; i < n; ++i) dst[i] = smp[i] * layer.mul + layer.add;
+                        }
+                    }
+                    if (op.val != 0.0) for (int i = 0; i < n; ++i) dst[i] += op.val;
+
+                } else if (op.kind == Op::OP_AFFINE) {
+                    for (int i = 0; i < n; ++i) {
+                        double v = a[i] * op.mul + op.add;
+                        dst[i] = v < op.lo ? op.lo : (v > op.hi ? op.hi : v);
+                    }
+
+                } else if (op.kind == Op::OP_ADD) {
+                    for (int i = 0; i < n; ++i) dst[i] = a[i] + b[i];
+                } else if (op.kind == Op::OP_MUL) {
+                    for (int i = 0; i < n; ++i) dst[i] = a[i] * b[i];
+                } else if (op.kind == Op::OP_MIN) {
+                    for (int i = 0; i < n; ++i) dst[i] = a[i] < b[i] ? a[i] : b[i];
+                } else if (op.kind == Op::OP_MAX) {
+                    for (int i = 0; i < n; ++i) dst[i] = a[i] > b[i] ? a[i] : b[i];
+                } else if (op.kind == Op::OP_BLEND) {
+                    for (int i = 0; i < n; ++i) dst[i] = a[i] + c[i] * (b[i] - a[i]);
+
+                } else if (op.kind == Op::OP_SPLINE) {
+                    const List< Pair<double, double> >& pts = splines[op.spline];
+                    for (int i = 0; i < n; ++i) dst[i] = evalSpline(pts, a[i] * op.mul + op.add);
+
+                } else if (op.kind == Op::OP_WARP) {
+                    cx[op.dst].resize(n);
+                    cy[op.dst].resize(n);
+                    cz[op.dst].resize(n);
+                    for (int i = 0; i < n; ++i) {
+                        cx[op.dst][i] = cx[op.coords][i] + (a != NULL ? a[i] : 0.0);
+                        cy[op.dst][i] = cy[op.coords][i] + (b != NULL ? b[i] : 0.0);
+                        cz[op.dst][i] = cz[op.coords][i] + (c != NULL ? c[i] : 0.0);
+                    }
+                }
+            }
+
+            memcpy(out, &regs[result][0], sizeof(double) * n);
+        }
+
+    };
+
+    // NoiseGraph - a graph of noise sources, and operations on them
+    // Each method adds a node, and returns its index, which later nodes use to refer to it. Then,
+    //   `compile()` turns the graph (starting from one of its nodes) into a `NoisePlan`
+    //
+    // For example, hills with a flat valley floor could be:
+    //
+    //   NoiseGraph g;
+    //   int hills = g.fbm(seed, vec3(0.01), 4);
+    //   int height = g.spline(hills, { {0.0, 40}, {0.6, 40}, {1.875, 90} });
+    //   NoisePlan plan = g.compile(height);
+    //
+    class NoiseGraph {
+        public:
+
+        // Node - a single node of the graph
+        struct Node {
+
+            enum Kind {
+                NODE_CONST,
+                NODE_PERLIN,
+                NODE_ADD,
+                NODE_MUL,
+                NODE_MIN,
+                NODE_MAX,
+                NODE_BLEND,
+                NODE_CLAMP,
+                NODE_REMAP,
+                NODE_SPLINE,
+                NODE_WARP,
+            } kind;
+
+            // the nodes used as inputs, or -1 if unused
+            int a, b, c, d;
+
+            // constant parameters, depending on the kind (i.e. the value, or the range to clamp to)
+            double p0, p1, p2, p3;
+
+            // for NODE_PERLIN, the noise source
+            Perlin perlin;
+
+            // for NODE_SPLINE, the control points, sorted by X
+            List< Pair<double, double> > points;
+
+            Node(Kind kind) {
+                this->kind = kind;
+                a = b = c = d = -1;
+                p0 = p1 = p2 = p3 = 0.0;
+            }
+
+        };
+
+        // all the nodes, where nodes only ever refer to nodes before them
+        List<Node> nodes;
+
+        // a constant value
+        int constant(double val) {
+            Node node(Node::NODE_CONST);
+            node.p0 = val;
+            return addNode(node);
+        }
+
+        // a single Perlin noise layer (including its scale, clipping, and output range)
+        int perlin(const Perlin& layer) {
+            Node node(Node::NODE_PERLIN);
+            node.perlin = layer;
+            return addNode(node);
+        }
+
+        // fractal Brownian motion: 'octaves' Perlin layers, each at 'lacunarity' times the frequency, and
+        //   'gain' times the amplitude, of the one before. The first is in [0, 1], so the total is in
+        //   [0, (1 - gain^octaves) / (1 - gain)]
+        int fbm(uint32_t seed, vec3 scale, int octaves, double lacunarity=2.0, double gain=0.5) {
+            int res = -1;
+            double freq = 1.0, amp = 1.0;
+            for (int i = 0; i < octaves; ++i) {
+                int octave = perlin(Perlin(seed + i, scale * (float)freq, vec2(0.0, 1.0), vec2(0.0, amp)));
+                res = res < 0 ? octave : add(res, octave);
+                freq *= lacunarity;
+                amp *= gain;
+            }
+            return res;
+        }
+
+        // 'a + b'
+        int add(int a, int b) {
+            return addBinary(Node::NODE_ADD, a, b);
+        }
+
+        // 'a * b'
+        int mul(int a, int b) {
+            return addBinary(Node::NODE_MUL, a, b);
+        }
+
+        // the smaller of 'a' and 'b'
+        int min(int a, int b) {
+            return addBinary(Node::NODE_MIN, a, b);
+        }
+
+        // the larger of 'a' and 'b'
+        int max(int a, int b) {
+            return addBinary(Node::NODE_MAX, a, b);
+        }
+
+        // 'a' when 't' is 0, and 'b' when 't' is 1, linearly in between
+        int blend(int a, int b, int t) {
+            Node node(Node::NODE_BLEND);
+            node.a = a;
+            node.b = b;
+            node.c = t;
+            return addNode(node);
+        }
+
+        // 'src', clamped to [lo, hi]
+        int clamp(int src, double lo, double hi) {
+            Node node(Node::NODE_CLAMP);
+            node.a = src;
+            node.p0 = lo;
+            node.p1 = hi;
+            return addNode(node);
+        }
+
+        // 'src', linearly mapped from [fromLo, fromHi] to [toLo, toHi] (without clamping)
+        // An empty range (fromLo == fromHi) can't be mapped, so it is an error, and gives 'toLo'
+        int remap(int src, double fromLo, double fromHi, double toLo, double toHi) {
+            if (fromLo == fromHi) {
+                blok_error("NoiseGraph::remap() given an empty range [%f, %f]", fromLo, fromHi);
+                return constant(toLo);
+            }
+
+            Node node(Node::NODE_REMAP);
+            node.a = src;
+            node.p0 = fromLo;
+            node.p1 = fromHi;
+            node.p2 = toLo;
+            node.p3 = toHi;
+            return addNode(node);
+        }
+
+        // 'src', mapped through a piecewise linear curve through 'points' (as (in, out) pairs), which is
+        //   flat past the first and last points. This is how terrain shapes (i.e. plateaus, and cliffs) are
+        //   made out of smooth noise
+        // There must be at least one point, otherwise it is an error, and gives 0
+        int spline(int src, const List< Pair<double, double> >& points) {
+            if (points.size() == 0) {
+                blok_error("NoiseGraph::spline() given no points");
+                return constant(0.0);
+            }
+
+            Node node(Node::NODE_SPLINE);
+            node.a = src;
+            node.points = points;
+            std::sort(node.points.begin(), node.points.end());
+            return addNode(node);
+        }
+
+        // 'src', sampled at coordinates offset by 'amount' times (dx, dy, dz), which bends its features
+        //   around. Any of the offsets can be -1 for none
+        int warp(int src, int dx, int dy, int dz, double amount) {
+            Node node(Node::NODE_WARP);
+            node.a = src;
+            node.b = dx;
+            node.c = dy;
+            node.d = dz;
+            node.p0 = amount;
+            return addNode(node);
+        }
+
+        // compile the graph into a plan that evaluates node 'output'
+        // Only the nodes that 'output' depends on are included
+        NoisePlan compile(int output) const {
+            Compiler comp(this);
+            Value res = comp.emit(output, 0);
+            comp.plan.result = comp.materialize(res);
+            comp.allocate();
+            return comp.plan;
+        }
+
+        private:
+
+        int addNode(const Node& node) {
+            nodes.push_back(node);
+            return nodes.size() - 1;
+        }
+
+        int addBinary(Node::Kind kind, int a, int b) {
+            Node node(kind);
+            node.a = a;
+            node.b = b;
+            return addNode(node);
+        }
+
+        // Value - the result of compiling a node, which is 'reg * mul + add' (where 'reg' is a register),
+        //   or a constant (if 'reg<0'). The affine part is only applied when something needs it
+        struct Value {
+
+            int reg;
+            double mul, add;
+
+            Value(int reg=-1, double mul=1.0, double add=0.0) {
+                this->reg = reg;
+                this->mul = mul;
+                this->add = add;
+            }
+
+            bool isConst() const {
+                return reg < 0;
+            }
+
+            // return this value, mapped by 'x * m + c'
+            Value affine(double m, double c) const {
+                return Value(reg, mul * m, add * m + c);
+            }
+
+        };
+
+        // Compiler - the state while compiling a graph
+        // Registers are first given out one per operation ('virtual' registers), and then packed into as
+        //   few as possible by `allocate()`
+        struct Compiler {
+
+            const NoiseGraph* graph;
+            NoisePlan plan;
+
+            // what each (node, coordinate set) has already compiled to, keyed by 'node * 65536 + coords'
+            HashMap<int64_t, Value> memo;
+
+            Compiler(const NoiseGraph* graph) {
+                this->graph = graph;
+            }
+
+            // add an operation writing a new register, and return the register
+            int addOp(NoisePlan::Op op) {
+                op.dst = plan.numRegs++;
+                plan.ops.push_back(op);
+                return op.dst;
+            }
+
+            // return a register holding 'val' exactly
+            int materialize(const Value& val) {
+                if (val.isConst()) {
+                    NoisePlan::Op op(NoisePlan::Op::OP_CONST);
+                    op.val = val.add;
+                    return addOp(op);
+                }
+                if (val.mul == 1.0 && val.add == 0.0) return val.reg;
+                NoisePlan::Op op(NoisePlan::Op::OP_AFFINE);
+                op.a = val.reg;
+                op.mul = val.mul;
+                op.add = val.add;
+                return addOp(op);
+            }
+
+            // compile node 'idx', sampling noise at coordinate set 'coords'
+            Value emit(int idx, int coords) {
+                int64_t key = (int64_t)idx * 65536 + coords;
+                auto it = memo.find(key);
+                if (it != memo.end()) return it->second;
+                Value res = emitNode(idx, coords);
+                memo[key] = res;
+                return res;
+            }
+
+            // collect the terms of a tree of NODE_ADD's, so that Perlin layers anywhere in it can be summed
+            //   by a single operation
+            void collectTerms(int idx, List<int>& terms) {
+                const Node& node = graph->nodes[idx];
+                if (node.kind == Node::NODE_ADD) {
+                    collectTerms(node.a, terms);
+                    collectTerms(node.b, terms);
+                } else {
+                    terms.push_back(idx);
+                }
+            }
+
+            // if node 'idx' is a Perlin layer with only affine steps after it, return the layer and the
+            //   steps (as 'noise * mul + add')
+            bool asLayer(int idx, NoisePlan::Layer& layer) {
+                const Node& node = graph->nodes[idx];
+                if (node.kind == Node::NODE_PERLIN) {
+                    layer.perlin = node.perlin;
+                    layer.mul = 1.0;
+                    layer.add = 0.0;
+                    return true;
+                } else if (node.kind == Node::NODE_REMAP) {
+                    if (!asLayer(node.a, layer)) return false;
+                    double m = (node.p3 - node.p2) / (node.p1 - node.p0), c = node.p2 - node.p0 * m;
+                    layer.mul *= m;
+                    layer.add = layer.add * m + c;
+                    return true;
+                } else if (node.kind == Node::NODE_MUL) {
+                    double k;
+                    if (isConst(node.b, k) && asLayer(node.a, layer)) {}
+                    else if (isConst(node.a, k) && asLayer(node.b, layer)) {}
+                    else return false;
+                    layer.mul *= k;
+                    layer.add *= k;
+                    return true;
+                }
+                return false;
+            }
+
+            // return whether node 'idx' is constant (i.e. doesn't depend on any noise), setting 'val'
+            // This only looks at the graph, so it never emits anything
+            bool isConst(int idx, double& val) {
+                const Node& node = graph->nodes[idx];
+                double a, b, c;
+                switch (node.kind) {
+                case Node::NODE_CONST:
+                    val = node.p0;
+                    return true;
+                case Node::NODE_ADD:
+                case Node::NODE_MUL:
+                case Node::NODE_MIN:
+                case Node::NODE_MAX:
+                    if (!isConst(node.a, a) || !isConst(node.b, b)) return false;
+                    if (node.kind == Node::NODE_ADD) val = a + b;
+                    else if (node.kind == Node::NODE_MUL) val = a * b;
+                    else if (node.kind == Node::NODE_MIN) val = glm::min(a, b);
+                    else val = glm::max(a, b);
+                    return true;
+                case Node::NODE_BLEND:
+                    if (!isConst(node.a, a) || !isConst(node.b, b) || !isConst(node.c, c)) return false;
+                    val = a + c * (b - a);
+                    return true;
+                case Node::NODE_CLAMP:
+                    if (!isConst(node.a, a)) return false;
+                    val = glm::clamp(a, node.p0, node.p1);
+                    return true;
+                case Node::NODE_REMAP:
+                    if (!isConst(node.a, a)) return false;
+                    val = node.p2 + (a - node.p0) * ((node.p3 - node.p2) / (node.p1 - node.p0));
+                    return true;
+                case Node::NODE_SPLINE:
+                    if (!isConst(node.a, a)) return false;
+                    val = NoisePlan::evalSpline(node.points, a);
+                    return true;
+                case Node::NODE_WARP:
+                    // moving a constant around doesn't change it
+                    return isConst(node.a, val);
+                default:
+                    return false;
+                }
+            }
+
+            Value emitNode(int idx, int coords) {
+                const Node& node = graph->nodes[idx];
+                Value a, b, c;
+
+                switch (node.kind) {
+                case Node::NODE_CONST:
+                    return Value(-1, 0.0, node.p0);
+
+                case Node::NODE_PERLIN:
+                case Node::NODE_ADD: {
+                    // sum up all the terms, with the Perlin layers (and constants) in a single operation
+                    List<int> terms;
+                    collectTerms(idx, terms);
+
+                    // NOTE: emitting the other terms can add layers of their own, so this op's layers are only
+                    //   added to the plan at the end, to keep them together
+                    NoisePlan::Op op(NoisePlan::Op::OP_PERLIN);
+                    op.coords = coords;
+                    List<NoisePlan::Layer> layers;
+                    List<Value> rest;
+                    for (int term : terms) {
+                        NoisePlan::Layer layer;
+                        if (asLayer(term, layer)) {
+                            layers.push_back(layer);
+                            continue;
+                        }
+                        Value val = emit(term, coords);
+                        if (val.isConst()) op.val += val.add;
+                        else rest.push_back(val);
+                    }
+                    op.layer = plan.layers.size();
+                    op.numLayers = layers.size();
+                    plan.layers.insert(plan.layers.end(), layers.begin(), layers.end());
+
+                    // add up whatever couldn't be fused
+                    Value res = op.numLayers > 0 ? Value(addOp(op)) : Value(-1, 0.0, op.val);
+                    for (const Value& val : rest) {
+                        if (res.isConst()) {
+                            res = val.affine(1.0, res.add);
+                            continue;
+                        }
+                        NoisePlan::Op sum(NoisePlan::Op::OP_ADD);
+                        sum.a = materialize(res);
+                        sum.b = materialize(val);
+                        res = Value(addOp(sum));
+                    }
+                    return res;
+                }
+
+                case Node::NODE_MUL:
+                    a = emit(node.a, coords);
+                    b = emit(node.b, coords);
+                    if (a.isConst()) return b.affine(a.add, 0.0);
+                    if (b.isConst()) return a.affine(b.add, 0.0);
+                    return binary(NoisePlan::Op::OP_MUL, a, b);
+
+                case Node::NODE_MIN:
+                case Node::NODE_MAX: {
+                    a = emit(node.a, coords);
+                    b = emit(node.b, coords);
+                    bool isMin = node.kind == Node::NODE_MIN;
+                    if (a.isConst() && b.isConst()) return Value(-1, 0.0, isMin ? glm::min(a.add, b.add) : glm::max(a.add, b.add));
+
+                    // against a constant, it is just a clamp on one side
+                    if (a.isConst()) std::swap(a, b);
+                    if (b.isConst()) return clampValue(a, isMin ? -std::numeric_limits<double>::infinity() : b.add, isMin ? b.add : std::numeric_limits<double>::infinity());
+                    return binary(isMin ? NoisePlan::Op::OP_MIN : NoisePlan::Op::OP_MAX, a, b);
+                }
+
+                case Node::NODE_BLEND: {
+                    a = emit(node.a, coords);
+                    b = emit(node.b, coords);
+                    c = emit(node.c, coords);
+                    if (a.isConst() && b.isConst() && c.isConst()) return Value(-1, 0.0, a.add + c.add * (b.add - a.add));
+
+                    // with a constant 't', or a constant 'a' and 'b', it is affine
+                    if (c.isConst() && a.isConst()) return b.affine(c.add, (1.0 - c.add) * a.add);
+                    if (c.isConst() && b.isConst()) return a.affine(1.0 - c.add, c.add * b.add);
+                    if (a.isConst() && b.isConst()) return c.affine(b.add - a.add, a.add);
+
+                    NoisePlan::Op op(NoisePlan::Op::OP_BLEND);
+                    op.a = materialize(a);
+                    op.b = materialize(b);
+                    op.c = materialize(c);
+                    return Value(addOp(op));
+                }
+
+                case Node::NODE_CLAMP:
+                    return clampValue(emit(node.a, coords), node.p0, node.p1);
+
+                case Node::NODE_REMAP: {
+                    double m = (node.p3 - node.p2) / (node.p1 - node.p0);
+                    return emit(node.a, coords).affine(m, node.p2 - node.p0 * m);
+                }
+
+                case Node::NODE_SPLINE: {
+                    a = emit(node.a, coords);
+                    if (a.isConst()) return Value(-1, 0.0, NoisePlan::evalSpline(node.points, a.add));
+
+                    // the affine steps before it are done by the spline operation itself
+                    NoisePlan::Op op(NoisePlan::Op::OP_SPLINE);
+                    op.a = a.reg;
+                    op.mul = a.mul;
+                    op.add = a.add;
+                    op.spline = plan.splines.size();
+                    plan.splines.push_back(node.points);
+                    return Value(addOp(op));
+                }
+
+                case Node::NODE_WARP: {
+                    // compute the offsets (scaled by the amount), and then the source at the new coordinates
+                    NoisePlan::Op op(NoisePlan::Op::OP_WARP);
+                    op.coords = coords;
+                    int* offs[3] = { &op.a, &op.b, &op.c };
+                    int srcs[3] = { node.b, node.c, node.d };
+                    for (int i = 0; i < 3; ++i) {
+                        if (srcs[i] >= 0) *offs[i] = materialize(emit(srcs[i], coords).affine(node.p0, 0.0));
+                    }
+                    op.dst = ++plan.numCoords;
+                    plan.ops.push_back(op);
+                    return emit(node.a, op.dst);
+                }
+                }
+
+                return Value();
+            }
+
+            // emit a binary operation on two (non-constant) values
+            Value binary(NoisePlan::Op::Kind kind, const Value& a, const Value& b) {
+                NoisePlan::Op op(kind);
+                op.a = materialize(a);
+                op.b = materialize(b);
+                return Value(addOp(op));
+            }
+
+            // clamp a value, which includes its affine part in the same operation
+            Value clampValue(const Value& a, double lo, double hi) {
+                if (a.isConst()) return Value(-1, 0.0, glm::clamp(a.add, lo, hi));
+                NoisePlan::Op op(NoisePlan::Op::OP_AFFINE);
+                op.a = a.reg;
+                op.mul = a.mul;
+                op.add = a.add;
+                op.lo = lo;
+                op.hi = hi;
+                return Value(addOp(op));
+            }
+
+            // pack the virtual registers into as few real ones as possible, reusing a register once its
+            //   value has been read for the last time
+            // NOTE: every operation reads all of a point's inputs before writing it, so an operation can
+            //   write to a register it reads from
+            void allocate() {
+                List<int> lastUse(plan.numRegs, -1);
+                for (int i = 0; i < (int)plan.ops.size(); ++i) {
+                    const NoisePlan::Op& op = plan.ops[i];
+                    int srcs[3] = { op.a, op.b, op.c };
+                    for (int s : srcs) if (s >= 0) lastUse[s] = i;
+                }
+                lastUse[plan.result] = plan.ops.size();
+
+                List<int> mapping(plan.numRegs, -1), freeRegs;
+                int numReal = 0;
+                for (int i = 0; i < (int)plan.ops.size(); ++i) {
+                    NoisePlan::Op& op = plan.ops[i];
+                    int* srcs[3] = { &op.a, &op.b, &op.c };
+                    for (int* s : srcs) {
+                        if (*s < 0) continue;
+                        int virt = *s;
+                        *s = mapping[virt];
+                        // free it after this operation, if nothing else reads it
+                        if (lastUse[virt] == i) {
+                            freeRegs.push_back(*s);
+                            lastUse[virt] = -1;
+                        }
+                    }
+                    if (op.kind == NoisePlan::Op::OP_WARP) continue;
+
+                    // values that are never read still need somewhere to go
+                    int virt = op.dst;
+                    if (freeRegs.size() > 0) {
+                        mapping[virt] = freeRegs.back();
+                        freeRegs.pop_back();
+                    } else {
+                        mapping[virt] = numReal++;
+                    }
+                    op.dst = mapping[virt];
+                    if (lastUse[virt] < 0) freeRegs.push_back(op.dst);
+                }
+
+                plan.result = mapping[plan.result];
+                plan.numRegs = numReal;
+            }
+
+        };
+
+    };
+
+}
+
+#endif /* BLOK_NOISEGRAPH_HH__ */
@@ -0,0 +1,92 @@
+/* Queue.hh - lock-free queues for passing messages between threads
+ *
+ * These are for the cases where one thread (i.e. the main thread) consumes things that any number
+ *   of other threads produce, and the consumer should never have to wait on a producer
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_QUEUE_HH__
+#define BLOK_QUEUE_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+#include <atomic>
+
+namespace Blok {
+
+    // MPSCQueue - an unbounded, lock-free, multi-producer single-consumer FIFO queue
+    // `push()` may be called from any thread, but `pop()` may only be called by one thread at a time
+    // This is Vyukov's intrusive MPSC queue: producers swap themselves in as the new head with a
+    //   single atomic exchange, and the consumer follows the links from a dummy node at the tail. A
+    //   producer that has swapped in but not linked yet just looks like the queue ends there, until
+    //   it does
+    template<typename T>
+    class MPSCQueue {
+        public:
+
+        MPSCQueue() {
+            Node* stub = new Node();
+            head.store(stub);
+            tail = stub;
+        }
+
+        // free everything that is still in the queue
+        ~MPSCQueue() {
+            T val;
+            while (pop(val)) ;
+            delete tail;
+        }
+
+        // queues own their nodes, so they should not be copied
+        MPSCQueue(const MPSCQueue& other) = delete;
+        MPSCQueue& operator=(const MPSCQueue& other) = delete;
+
+        // add 'val' to the end of the queue
+        void push(const T& val) {
+            Node* node = new Node();
+            node->val = val;
+            Node* prev = head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // take the value at the front of the queue, setting 'val', and returning whether there was one
+        bool pop(T& val) {
+            Node* next = tail->next.load(std::memory_order_acquire);
+            if (next == NULL) return false;
+
+            // 'next' becomes the new dummy node, so its value is moved out
+            val = next->val;
+            delete tail;
+            tail = next;
+            return true;
+        }
+
+        private:
+
+        // Node - a single link in the queue
+        struct Node {
+
+            // the next (newer) node, or NULL if this is the newest
+            std::atomic<Node*> next;
+
+            // the value (unused for the dummy node)
+            T val;
+
+            Node() : next(NULL), val() {}
+
+        };
+
+        // the newest node, which producers swap out
+        std::atomic<Node*> head;
+
+        // the dummy node before the oldest value (only touched by the consumer)
+        Node* tail;
+
+    };
+
+}
+
+#endif /* BLOK_QUEUE_HH__ */
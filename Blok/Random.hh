@@ -15,6 +15,11 @@
 // general Blok library
 #include <Blok/Blok.hh>
 
+// SSE2 is always available on x86-64, and is used for batches of noise samples
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace Blok::Random {
 
 // XorShift - simple XOR-shift (https://en.wikipedia.org/wiki/Xorshift) based
@@ -69,8 +74,133 @@ class XorShift {
 };
 
 
+// mix the bits of 'x', so that every bit of the result depends on every bit of 'x'
+// This is Chris Wellons' 'lowbias32' (https://nullprogram.com/blog/2018/07/31/), which is a bijection,
+//   and only needs 32 bit multiplies (so it can be done 4 at a time with SSE2)
+static inline uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// the odd constants that each coordinate is multiplied by before it is mixed into a hash (see `hash()`)
+#define RANDOM_HASH_X 0x85ebca77U
+#define RANDOM_HASH_Y 0xc2b2ae3dU
+#define RANDOM_HASH_Z 0x27d4eb2fU
+
+// return a random value for the position 'x, y, z', which only depends on its arguments
+// Different 'stream's give unrelated values for the same position, so each kind of feature (i.e. ores,
+//   or boulders) should use its own
+// Each coordinate is spread out by its own odd multiplier, and then mixed in separately, so a step
+//   along one axis isn't undone by a step along the next (i.e. (x+1, y) and (x, y+1) are unrelated)
+static inline uint32_t hash(uint32_t seed, int x, int y, int z, uint32_t stream=0) {
+    uint32_t h = mix32(seed ^ mix32(stream + 0x9e3779b9U));
+    h = mix32(h ^ (uint32_t)x * RANDOM_HASH_X);
+    h = mix32(h ^ (uint32_t)y * RANDOM_HASH_Y);
+    return mix32(h ^ (uint32_t)z * RANDOM_HASH_Z);
+}
+
+// PosHash - a stateless ('counter based') random number generator, which gives a random value for each
+//   position (see `hash()`)
+// Unlike `XorShift`, values don't depend on what was generated before them, so generation gives the
+//   same results no matter what order (or on which thread) chunks are generated in
+// For whole grids of values (i.e. one per block in a chunk), use `getU32Grid()`, which computes them 4
+//   at a time (with SSE2), and gives the same results as `getU32()`
+class PosHash {
+    public:
+
+    // construct a generator for a given seed and stream
+    PosHash(uint32_t seed=0, uint32_t stream=0) {
+        key = mix32(seed ^ mix32(stream + 0x9e3779b9U));
+    }
+
+    // return the value at 'x, y, z' (the same as `hash(seed, x, y, z, stream)`)
+    uint32_t getU32(int x, int y, int z) const {
+        return mix32(mix32(mix32(key ^ (uint32_t)x * RANDOM_HASH_X) ^ (uint32_t)y * RANDOM_HASH_Y) ^ (uint32_t)z * RANDOM_HASH_Z);
+    }
+
+    // return the value at 'x, y, z', as a floating point value in [0, 1)
+    double getD(int x, int y, int z) const {
+        return getU32(x, y, z) * (1.0 / 4294967296.0);
+    }
+
+    // return the value at 'x, y, z', as an integer in [0, n)
+    // This is the high part of 'value * n', which (unlike 'value % n') has no bias towards low results
+    //   beyond that of dividing 2^32 values into 'n' parts
+    uint32_t getRange(int x, int y, int z, uint32_t n) const {
+        return (uint32_t)(((uint64_t)getU32(x, y, z) * n) >> 32);
+    }
+
+    // set 'out[j]' to the value at 'x, y0+j, z', for 0 <= j < n
+    void getU32Row(int x, int y0, int z, int n, uint32_t* out) const {
+        uint32_t hx = mix32(key ^ (uint32_t)x * RANDOM_HASH_X), hz = (uint32_t)z * RANDOM_HASH_Z;
+        int j = 0;
+#ifdef __SSE2__
+        __m128i vy = _mm_add_epi32(_mm_set1_epi32(y0), _mm_set_epi32(3, 2, 1, 0));
+        __m128i vhx = _mm_set1_epi32((int)hx), vhz = _mm_set1_epi32((int)hz);
+        __m128i ky = _mm_set1_epi32((int)RANDOM_HASH_Y), step = _mm_set1_epi32(4);
+        for (; j + 4 <= n; j += 4) {
+            __m128i h = mix32(_mm_xor_si128(vhx, mullo32(vy, ky)));
+            h = mix32(_mm_xor_si128(h, vhz));
+            _mm_storeu_si128((__m128i*)(out + j), h);
+            vy = _mm_add_epi32(vy, step);
+        }
+#endif
+        for (; j < n; ++j) {
+            out[j] = mix32(mix32(hx ^ (uint32_t)(y0 + j) * RANDOM_HASH_Y) ^ hz);
+        }
+    }
+
+    // set 'out[(i*nz+k)*ny+j]' to the value at (x0+i, y0+j, z0+k), in the same order as
+    //   `Perlin::noise3dGrid()` (which is the order of blocks in a chunk)
+    void getU32Grid(int x0, int y0, int z0, int nx, int ny, int nz, uint32_t* out) const {
+        for (int i = 0; i < nx; ++i) {
+            for (int k = 0; k < nz; ++k) {
+                getU32Row(x0 + i, y0, z0 + k, ny, out + (i * nz + k) * ny);
+            }
+        }
+    }
+
+    private:
+
+    // the seed and stream, already mixed
+    uint32_t key;
+
+#ifdef __SSE2__
+    // the low 32 bits of each product 'a * b' (SSE2 only has 32x32->64 bit multiplies of the even lanes,
+    //   so the odd lanes are shifted down and done separately)
+    static inline __m128i mullo32(__m128i a, __m128i b) {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // `mix32()` on 4 values at once
+    static inline __m128i mix32(__m128i x) {
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = mullo32(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = mullo32(x, _mm_set1_epi32((int)0x846ca68bU));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        return x;
+    }
+
+    // the scalar version, which the overload above would otherwise hide
+    static inline uint32_t mix32(uint32_t x) {
+        return Random::mix32(x);
+    }
+#endif
+
+};
+
+
 // Perlin - a Perlin noise (https://en.wikipedia.org/wiki/Perlin_noise) generator
 // Generates a value in `outputSpace` (default 0 to 1)
+// For whole grids of samples (i.e. every block in a chunk), use `noise2dGrid()` and `noise3dGrid()`,
+//   which give the same results as sampling one at a time, but are much faster
 class Perlin {
     public:
 
@@ -80,6 +210,10 @@ class Perlin {
     // a list of values to be used in the internal algorithm
     List<uint32_t> perms;
 
+    // 'perms', repeated twice, so that 'perms2[i] == perms[i % tableSize]' for any index the algorithm
+    //   can produce (which are all less than '2*tableSize'), without the modulo
+    int perms2[2 * tableSize];
+
     // the scale of the perlin noise, i.e. the input coordinates
     //   are multiplied by this
     vec3 scale;
@@ -92,12 +226,20 @@ class Perlin {
     // default is (0, 1) which does nothing
     vec2 outputSpace;
 
+    // the spacing of the lattice that `noise2dGrid()` and `noise3dGrid()` actually sample (with 2D noise
+    //   only using X and Y), interpolating everything in between
+    // Noise that varies slowly (relative to the grid) looks almost the same, but is many times cheaper
+    //   to generate. The default, (1, 1, 1), samples every point exactly, and spacings below 1 are
+    //   treated as 1
+    vec3i lattice;
+
     // construct a perlin generator from a given seed
     Perlin(uint32_t seed=0, vec3 scale={1.0, 1.0, 1.0}, vec2 clipSpace={0.0, 1.0}, vec2 outputSpace={0.0, 1.0}) {
         // set member vars
         this->scale = scale;
         this->clipSpace = clipSpace;
         this->outputSpace = outputSpace;
+        this->lattice = vec3i(1, 1, 1);
 
         // generate random integers from an XorShift generator
         XorShift permgen(seed);
@@ -108,6 +250,10 @@ class Perlin {
         for (int i = 0; i < tableSize; ++i) {
             perms.push_back(permgen.getU32() % tableSize);
         }
+
+        for (int i = 0; i < 2 * tableSize; ++i) {
+            perms2[i] = perms[i % tableSize];
+        }
     }
 
     // apply clipping & scaling to a value
@@ -263,6 +409,350 @@ class Perlin {
         return toOutput(res);
 
     }
+
+    // generate 2D noise over a grid of 'nx*ny' points, setting 'out[i*ny+j]' to `noise2d(x0+i, y0+j)`
+    //   (or, if 'add' is true, adding it to 'out[i*ny+j]')
+    // The results are exactly the same as `noise2d()` (as long as the compiler doesn't fuse multiplies
+    //   and adds in one but not the other, which it doesn't without -ffp-contract=fast and FMA
+    //   instructions enabled), unless a coarser 'lattice' is set, in which case they are interpolated
+    void noise2dGrid(double x0, double y0, int nx, int ny, double* out, bool add=false) {
+        if (lattice.x > 1 || lattice.y > 1) {
+            noise2dLattice(x0, y0, nx, ny, out, add);
+            return;
+        }
+        for (int i = 0; i < nx; ++i) {
+            noise2dRow(x0 + i, y0, 1.0, ny, out + i * ny, add);
+        }
+    }
+
+    // generate 3D noise over a grid of 'nx*ny*nz' points, setting 'out[(i*nz+k)*ny+j]' to
+    //   `noise3d(x0+i, y0+j, z0+k)` (or, if 'add' is true, adding it)
+    // This is the same order as blocks in a chunk (XZY, Y changing fastest), and the results are exactly
+    //   the same as `noise3d()` (see `noise2dGrid()`)
+    void noise3dGrid(double x0, double y0, double z0, int nx, int ny, int nz, double* out, bool add=false) {
+        if (lattice.x > 1 || lattice.y > 1 || lattice.z > 1) {
+            noise3dLattice(x0, y0, z0, nx, ny, nz, out, add);
+            return;
+        }
+        for (int i = 0; i < nx; ++i) {
+            for (int k = 0; k < nz; ++k) {
+                noise3dRow(x0 + i, y0, 1.0, z0 + k, ny, out + (i * nz + k) * ny, add);
+            }
+        }
+    }
+
+    private:
+
+    // the gradient that `grad()` picks for each hash, as the coefficients of x, y and z (which are
+    //   each -1, 0, or 1), so it can be computed without branching
+    static double gradCoef(int hash, int axis) {
+        static const double coefs[16][3] = {
+            { 1,  1,  0}, {-1,  1,  0}, { 1, -1,  0}, {-1, -1,  0},
+            { 1,  0,  1}, {-1,  0,  1}, { 1,  0, -1}, {-1,  0, -1},
+            { 0,  1,  1}, { 0, -1,  1}, { 0,  1, -1}, { 0, -1, -1},
+            { 1,  1,  0}, { 0, -1,  1}, {-1,  1,  0}, { 0, -1, -1},
+        };
+        return coefs[hash & 15][axis];
+    }
+
+    // compute the hashes of the 4 corners of the 2D cell at (X, Y) (which are already wrapped), where
+    //   'pA' and 'pB' are 'perms2[X]' and 'perms2[X+1]', in the order used by `noise2d()`
+    void cellHashes2d(int pA, int pB, int Y, int* h) const {
+        int A = pA + Y, B = pB + Y;
+        h[0] = perms2[perms2[A]];
+        h[1] = perms2[perms2[B]];
+        h[2] = perms2[perms2[A + 1]];
+        h[3] = perms2[perms2[B + 1]];
+    }
+
+    // compute the hashes of the 8 corners of the 3D cell at (X, Y, Z) (see `cellHashes2d()`)
+    void cellHashes3d(int pA, int pB, int Y, int Z, int* h) const {
+        int A = pA + Y, B = pB + Y;
+        int AA = perms2[A] + Z, AB = perms2[A + 1] + Z;
+        int BA = perms2[B] + Z, BB = perms2[B + 1] + Z;
+        h[0] = perms2[AA];
+        h[1] = perms2[BA];
+        h[2] = perms2[AB];
+        h[3] = perms2[BB];
+        h[4] = perms2[AA + 1];
+        h[5] = perms2[BA + 1];
+        h[6] = perms2[AB + 1];
+        h[7] = perms2[BB + 1];
+    }
+
+    // split a (scaled) coordinate into its cell (wrapped to the table) and its position in the cell
+    static void splitCoord(double x, int& X, double& xr) {
+        double fx = floor(x);
+        X = (int)fx % tableSize;
+        if (X < 0) X += tableSize;
+        xr = x - fx;
+    }
+
+    // store (or add) the final value of a sample, or if 'raw' is true, store it before `toOutput()`
+    void putOutput(double res, double* out, bool add, bool raw=false) {
+        res = (res + 1.0)/2.0;
+        if (raw) {
+            *out = res;
+            return;
+        }
+        res = toOutput(res);
+        if (add) *out += res;
+        else *out = res;
+    }
+
+#ifdef __SSE2__
+    // vector versions of `fade()` and `lerp()`, which do the exact same operations
+    static __m128d fade(__m128d t) {
+        __m128d inner = _mm_add_pd(_mm_mul_pd(t, _mm_sub_pd(_mm_mul_pd(t, _mm_set1_pd(6)), _mm_set1_pd(15))), _mm_set1_pd(10));
+        return _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(t, t), t), inner);
+    }
+    static __m128d lerp(__m128d t, __m128d a, __m128d b) {
+        return _mm_add_pd(a, _mm_mul_pd(t, _mm_sub_pd(b, a)));
+    }
+
+    // vector version of `grad()`, with the hash for each lane in 'h0' and 'h1'
+    // NOTE: adding the zero term can only change the sign of a zero, which never reaches the output
+    static __m128d grad(int h0, int h1, __m128d x, __m128d y, __m128d z) {
+        __m128d cx = _mm_set_pd(gradCoef(h1, 0), gradCoef(h0, 0));
+        __m128d cy = _mm_set_pd(gradCoef(h1, 1), gradCoef(h0, 1));
+        __m128d cz = _mm_set_pd(gradCoef(h1, 2), gradCoef(h0, 2));
+        return _mm_add_pd(_mm_add_pd(_mm_mul_pd(cx, x), _mm_mul_pd(cy, y)), _mm_mul_pd(cz, z));
+    }
+
+    // vector version of `putOutput()`, for 2 samples
+    void putOutput(__m128d res, double* out, bool add, bool raw=false) {
+        res = _mm_div_pd(_mm_add_pd(res, _mm_set1_pd(1.0)), _mm_set1_pd(2.0));
+        if (raw) {
+            _mm_storeu_pd(out, res);
+            return;
+        }
+
+        // clip it, in the same order as `toOutput()`
+        __m128d c0 = _mm_set1_pd(clipSpace[0]), c1 = _mm_set1_pd(clipSpace[1]);
+        __m128d hi = _mm_cmpgt_pd(res, c1);
+        res = _mm_or_pd(_mm_and_pd(hi, c1), _mm_andnot_pd(hi, res));
+        __m128d lo = _mm_cmplt_pd(res, c0);
+        res = _mm_or_pd(_mm_and_pd(lo, c0), _mm_andnot_pd(lo, res));
+
+        // and scale it (NOTE: the ranges are floats, so their widths are computed as floats too)
+        __m128d clipWidth = _mm_set1_pd(clipSpace[1] - clipSpace[0]), outputWidth = _mm_set1_pd(outputSpace[1] - outputSpace[0]);
+        res = _mm_add_pd(_mm_mul_pd(_mm_div_pd(_mm_sub_pd(res, c0), clipWidth), outputWidth), _mm_set1_pd(outputSpace[0]));
+
+        if (add) res = _mm_add_pd(_mm_loadu_pd(out), res);
+        _mm_storeu_pd(out, res);
+    }
+#endif
+
+    // generate `noise2d(x, y0+j*dy)` for 'j' in [0, n), into 'out' (see `noise2dGrid()`)
+    // If 'raw' is true, the values are stored before `toOutput()` is applied
+    void noise2dRow(double x, double y0, double dy, int n, double* out, bool add, bool raw=false) {
+        // the X coordinate is the same for the whole row
+        int X;
+        double xr;
+        splitCoord(x * scale.x, X, xr);
+        double xf = fade(xr);
+        int pA = perms2[X], pB = perms2[X + 1];
+
+        // the cell only changes every few samples, so keep the last one's hashes around
+        int h[2][4], lastY[2] = {-1, -1};
+
+        int j = 0;
+#ifdef __SSE2__
+        // two samples at a time
+        __m128d vx = _mm_set1_pd(xr), vx1 = _mm_set1_pd(xr - 1), vxf = _mm_set1_pd(xf), vzero = _mm_set1_pd(0.0);
+        for (; j + 2 <= n; j += 2) {
+            double yr[2];
+            for (int l = 0; l < 2; ++l) {
+                int Y;
+                splitCoord((y0 + (j + l) * dy) * scale.y, Y, yr[l]);
+                if (Y != lastY[l]) cellHashes2d(pA, pB, Y, h[l]);
+                lastY[l] = Y;
+            }
+            __m128d vy = _mm_loadu_pd(yr), vy1 = _mm_sub_pd(vy, _mm_set1_pd(1.0));
+            __m128d vyf = fade(vy);
+
+            __m128d res = lerp(vyf,
+                lerp(vxf, grad(h[0][0], h[1][0], vx, vy, vzero), grad(h[0][1], h[1][1], vx1, vy, vzero)),
+                lerp(vxf, grad(h[0][2], h[1][2], vx, vy1, vzero), grad(h[0][3], h[1][3], vx1, vy1, vzero))
+            );
+
+            putOutput(res, out + j, add, raw);
+        }
+#endif
+        // and the rest, one at a time
+        for (; j < n; ++j) {
+            int Y;
+            double yr;
+            splitCoord((y0 + j * dy) * scale.y, Y, yr);
+            if (Y != lastY[0]) cellHashes2d(pA, pB, Y, h[0]);
+            lastY[0] = Y;
+            double yf = fade(yr);
+
+            double res = lerp(yf,
+                lerp(xf, grad(h[0][0], xr, yr), grad(h[0][1], xr-1, yr)),
+                lerp(xf, grad(h[0][2], xr, yr-1), grad(h[0][3], xr-1, yr-1))
+            );
+            putOutput(res, out + j, add, raw);
+        }
+    }
+
+    // generate `noise3d(x, y0+j*dy, z)` for 'j' in [0, n), into 'out' (see `noise2dRow()`)
+    void noise3dRow(double x, double y0, double dy, double z, int n, double* out, bool add, bool raw=false) {
+        // the X and Z coordinates are the same for the whole row
+        int X, Z;
+        double xr, zr;
+        splitCoord(x * scale.x, X, xr);
+        splitCoord(z * scale.z, Z, zr);
+        double xf = fade(xr), zf = fade(zr);
+        int pA = perms2[X], pB = perms2[X + 1];
+
+        // the cell only changes every few samples, so keep the last one's hashes around
+        int h[2][8], lastY[2] = {-1, -1};
+
+        int j = 0;
+#ifdef __SSE2__
+        // two samples at a time
+        __m128d vx = _mm_set1_pd(xr), vx1 = _mm_set1_pd(xr - 1), vxf = _mm_set1_pd(xf);
+        __m128d vz = _mm_set1_pd(zr), vz1 = _mm_set1_pd(zr - 1), vzf = _mm_set1_pd(zf);
+        for (; j + 2 <= n; j += 2) {
+            double yr[2];
+            for (int l = 0; l < 2; ++l) {
+                int Y;
+                splitCoord((y0 + (j + l) * dy) * scale.y, Y, yr[l]);
+                if (Y != lastY[l]) cellHashes3d(pA, pB, Y, Z, h[l]);
+                lastY[l] = Y;
+            }
+            __m128d vy = _mm_loadu_pd(yr), vy1 = _mm_sub_pd(vy, _mm_set1_pd(1.0));
+            __m128d vyf = fade(vy);
+
+            __m128d res = lerp(vzf,
+                lerp(vyf,
+                    lerp(vxf, grad(h[0][0], h[1][0], vx, vy, vz), grad(h[0][1], h[1][1], vx1, vy, vz)),
+                    lerp(vxf, grad(h[0][2], h[1][2], vx, vy1, vz), grad(h[0][3], h[1][3], vx1, vy1, vz))
+                ),
+                lerp(vyf,
+                    lerp(vxf, grad(h[0][4], h[1][4], vx, vy, vz1), grad(h[0][5], h[1][5], vx1, vy, vz1)),
+                    lerp(vxf, grad(h[0][6], h[1][6], vx, vy1, vz1), grad(h[0][7], h[1][7], vx1, vy1, vz1))
+                )
+            );
+
+            putOutput(res, out + j, add, raw);
+        }
+#endif
+        // and the rest, one at a time
+        for (; j < n; ++j) {
+            int Y;
+            double yr;
+            splitCoord((y0 + j * dy) * scale.y, Y, yr);
+            if (Y != lastY[0]) cellHashes3d(pA, pB, Y, Z, h[0]);
+            lastY[0] = Y;
+            double yf = fade(yr);
+
+            double res = lerp(zf,
+                lerp(yf,
+                    lerp(xf, grad(h[0][0], xr, yr, zr), grad(h[0][1], xr-1, yr, zr)),
+                    lerp(xf, grad(h[0][2], xr, yr-1, zr), grad(h[0][3], xr-1, yr-1, zr))
+                ),
+                lerp(yf,
+                    lerp(xf, grad(h[0][4], xr, yr, zr-1), grad(h[0][5], xr-1, yr, zr-1)),
+                    lerp(xf, grad(h[0][6], xr, yr-1, zr-1), grad(h[0][7], xr-1, yr-1, zr-1))
+                )
+            );
+            putOutput(res, out + j, add, raw);
+        }
+    }
+
+    // LatticeAxis - where the points of a grid fall on the lattice, along one axis
+    struct LatticeAxis {
+
+        // the spacing of the lattice points
+        int step;
+
+        // the first lattice point (which is a multiple of the spacing, so that neighboring grids share
+        //   their lattice points, and line up exactly)
+        double start;
+
+        // the number of lattice points needed to cover the grid
+        int num;
+
+        // for each grid point, the lattice point before it, and how far it is towards the next one
+        List<int> idx;
+        List<double> t;
+
+        LatticeAxis(double x0, int n, int step) {
+            // a spacing of 0 (or less) would never reach the next point, so sample every point instead
+            this->step = step = glm::max(step, 1);
+
+            start = floor(x0 / step) * step;
+            num = (int)floor((x0 + n - 1 - start) / step) + 2;
+            for (int i = 0; i < n; ++i) {
+                double f = (x0 + i - start) / step;
+                idx.push_back((int)f);
+                t.push_back(f - (int)f);
+            }
+        }
+
+    };
+
+    // generate 2D noise over a grid by sampling the lattice, and bilinearly interpolating
+    // The noise is interpolated before it is clipped, so that clipping still gives sharp edges
+    void noise2dLattice(double x0, double y0, int nx, int ny, double* out, bool add) {
+        LatticeAxis ax(x0, nx, lattice.x), ay(y0, ny, lattice.y);
+
+        List<double> coarse(ax.num * ay.num);
+        for (int ci = 0; ci < ax.num; ++ci) {
+            noise2dRow(ax.start + ci * ax.step, ay.start, ay.step, ay.num, &coarse[ci * ay.num], false, true);
+        }
+
+        for (int i = 0; i < nx; ++i) {
+            const double* c0 = &coarse[ax.idx[i] * ay.num];
+            const double* c1 = c0 + ay.num;
+            double tx = ax.t[i];
+            for (int j = 0; j < ny; ++j) {
+                int cj = ay.idx[j];
+                double val = toOutput(lerp(ay.t[j], lerp(tx, c0[cj], c1[cj]), lerp(tx, c0[cj + 1], c1[cj + 1])));
+                if (add) out[i * ny + j] += val;
+                else out[i * ny + j] = val;
+            }
+        }
+    }
+
+    // generate 3D noise over a grid by sampling the lattice, and trilinearly interpolating (before
+    //   clipping, like `noise2dLattice()`)
+    void noise3dLattice(double x0, double y0, double z0, int nx, int ny, int nz, double* out, bool add) {
+        LatticeAxis ax(x0, nx, lattice.x), ay(y0, ny, lattice.y), az(z0, nz, lattice.z);
+
+        // the lattice, in the same order as the output
+        List<double> coarse(ax.num * az.num * ay.num);
+        for (int ci = 0; ci < ax.num; ++ci) {
+            for (int ck = 0; ck < az.num; ++ck) {
+                noise3dRow(ax.start + ci * ax.step, ay.start, ay.step, az.start + ck * az.step, ay.num, &coarse[(ci * az.num + ck) * ay.num], false, true);
+            }
+        }
+
+        // for each column, interpolate the 4 surrounding lattice columns in XZ first, and then along Y
+        List<double> col(ay.num);
+        for (int i = 0; i < nx; ++i) {
+            for (int k = 0; k < nz; ++k) {
+                const double* c00 = &coarse[(ax.idx[i] * az.num + az.idx[k]) * ay.num];
+                const double* c01 = c00 + ay.num;
+                const double* c10 = c00 + az.num * ay.num;
+                const double* c11 = c10 + ay.num;
+                double tx = ax.t[i], tz = az.t[k];
+                for (int cj = 0; cj < ay.num; ++cj) {
+                    col[cj] = lerp(tz, lerp(tx, c00[cj], c10[cj]), lerp(tx, c01[cj], c11[cj]));
+                }
+
+                double* o = out + (i * nz + k) * ny;
+                for (int j = 0; j < ny; ++j) {
+                    int cj = ay.idx[j];
+                    double val = toOutput(lerp(ay.t[j], col[cj], col[cj + 1]));
+                    if (add) o[j] += val;
+                    else o[j] = val;
+                }
+            }
+        }
+    }
 };
 
 
@@ -324,6 +814,23 @@ class PerlinMux {
         return val;
     }
 
+    // generate 2D noise over a grid, in the same order as `Perlin::noise2dGrid()`
+    void noise2dGrid(double x0, double y0, int nx, int ny, double* out) {
+        // sum up the layers in the same order as `noise2d()`, so the results are exactly the same
+        for (int i = 0; i < nx * ny; ++i) out[i] = 0.0;
+        for (Perlin& lyr : layers) {
+            lyr.noise2dGrid(x0, y0, nx, ny, out, true);
+        }
+    }
+
+    // generate 3D noise over a grid, in the same order as `Perlin::noise3dGrid()`
+    void noise3dGrid(double x0, double y0, double z0, int nx, int ny, int nz, double* out) {
+        for (int i = 0; i < nx * ny * nz; ++i) out[i] = 0.0;
+        for (Perlin& lyr : layers) {
+            lyr.noise3dGrid(x0, y0, z0, nx, ny, nz, out, true);
+        }
+    }
+
 
 };
 
@@ -18,6 +18,19 @@
 
 namespace Blok::Render {
 
+// unlink 'chunk' from its neighbors (see 'Chunk::rcache'), once it is no longer being rendered, and add
+//   the neighbors that lost it to 'changed' (since they need to be meshed again). Neighbors only relink
+//   themselves while they are being rendered, so this keeps the links on both sides the same, which
+//   `~Chunk()` relies on
+static void unlinkChunk(Chunk* chunk, List<Chunk*>& changed) {
+    Chunk* cR = chunk->rcache.cR, *cT = chunk->rcache.cT, *cL = chunk->rcache.cL, *cB = chunk->rcache.cB;
+    if (cR != NULL && cR->rcache.cL == chunk) { cR->rcache.cL = NULL; changed.push_back(cR); }
+    if (cT != NULL && cT->rcache.cB == chunk) { cT->rcache.cB = NULL; changed.push_back(cT); }
+    if (cL != NULL && cL->rcache.cR == chunk) { cL->rcache.cR = NULL; changed.push_back(cL); }
+    if (cB != NULL && cB->rcache.cT == chunk) { cB->rcache.cT = NULL; changed.push_back(cB); }
+    chunk->rcache.cL = chunk->rcache.cT = chunk->rcache.cR = chunk->rcache.cB = NULL;
+}
+
 // resize the rendering engine to a new output size
 void Renderer::resize(int w, int h) {
     // if nothing has changed, return
@@ -33,9 +46,12 @@ void Renderer::resize(int w, int h) {
 
 // render a chunk of data
 void Renderer::renderChunk(ChunkID id, Chunk* chunk) {
+    // the first chunk of the frame, so center the grid on the camera (where all the chunks will be)
+    if (queue.chunks.size() == 0) queue.chunks.recenter(ChunkID((int)floor(pos.x / CHUNK_SIZE_X), (int)floor(pos.z / CHUNK_SIZE_Z)));
+
     // add this to the render queue
     //torender[id] = chunk;
-    queue.chunks[id] = chunk;
+    queue.chunks.set(id, chunk);
 }
 
 // render a render data
@@ -82,6 +98,8 @@ void Renderer::renderFrame() {
 
     // keep track of how many triangles there are
     stats.n_tris = 0;
+    stats.n_chunk_tris = 0;
+    stats.n_naive_tris = 0;
 
     // number of chunk recalculations (i.e. lighting/mesh/etc )
     stats.n_chunk_recalcs = 0;
@@ -119,17 +137,14 @@ void Renderer::renderFrame() {
 
     /* COLLECT CHUNKS */
 
-    // the number of chunk re-hashes
-    int num_rehashes = 0;
-
     // #1: Go through and filter all the chunks that were requested to be renderered
 
     // first, decompose the map into a linear list, for quick iteration
     List<Chunk*> torender = {};
-    for (auto item : queue.chunks) {
+    queue.chunks.forEach([&](ChunkID, Chunk* chunk) {
         // TODO: perhaps filter/cull based on bounding boxes?
-        if (item.second != NULL) torender.push_back(item.second);
-    }
+        if (chunk != NULL) torender.push_back(chunk);
+    });
 
     // capture the number of chunks we need to compute, for a for loop index
     int N_chunks = torender.size();
@@ -138,41 +153,45 @@ void Renderer::renderFrame() {
     stats.n_chunks = N_chunks;
 
     // first, remove any rendering ChunkMeshes that are not being rendered
-    auto cmit = chunkMeshes.cbegin();
+    // the neighbors they are unlinked from are remembered in 'unlinked'
+    List<Chunk*> unlinked;
+    auto cmit = chunkMeshes.begin();
 
 
-    while (cmit != chunkMeshes.cend()) {
-        if (std::find(torender.begin(), torender.end(), cmit->first) == torender.end()) {
+    while (cmit != chunkMeshes.end()) {
+        // NOTE: the chunk was rendered last frame, so the server can't have unloaded it yet
+        if (queue.chunks.get(cmit->first->XZ, NULL) != cmit->first) {
             // if we didn't find it, remove it from our meshes
             // TODO: use a chunkMesh pool?
             //delete cmit->second;
             // add back to the pool
             chunkMeshPool.push_back(cmit->second);
+            unlinkChunk(cmit->first, unlinked);
 
             //erase from the current chunk meshes
-            chunkMeshes.erase(cmit++);
+            cmit = chunkMeshes.erase(cmit);
         } else {
             cmit++;
         }
     }
 
-
-    // first, make sure all hashes are up to date
-    // NOTE: we seperate this into a loop before the main recalculation, so that
-    //   we can also tell if any neightbors hashes have changed. Without this,
-    //   a chunk could have a neighbor that has not had its hash updated, so may not update correctly
-    //   itself
-    for (int idx = 0; idx < N_chunks; ++idx) {
-        Chunk* chunk = torender[idx];
-
-        // clear any previous current render hashes, if it has not been computed, or it has
-        //   been modified (i.e. is dirty)
-        if (chunk->rcache.curHash == 0 || chunk->rcache.isDirty) {
-            chunk->rcache.curHash = chunk->calcHash();
-            num_rehashes++;
+    // also forget about any pending mesh updates for chunks that are not being rendered, since the
+    //   server may unload them at any point after this frame
+    auto cmrit = chunkMeshRequests.begin();
+    while (cmrit != chunkMeshRequests.end()) {
+        if (queue.chunks.get((*cmrit)->XZ, NULL) != *cmrit) {
+            unlinkChunk(*cmrit, unlinked);
+            cmrit = chunkMeshRequests.erase(cmrit);
+        } else {
+            cmrit++;
         }
     }
 
+    // the neighbors that are still being rendered now have an open border where a chunk used to be
+    for (Chunk* chunk : unlinked) {
+        if (queue.chunks.get(chunk->XZ, NULL) == chunk) chunkMeshRequests.insert(chunk);
+    }
+
 
     for (int idx = 0; idx < N_chunks; ++idx) {
         double stime = getTime();
@@ -190,42 +209,34 @@ void Renderer::renderFrame() {
         ChunkID oid;
         
         oid = cid + ChunkID(1, 0);
-        cR = queue.chunks.find(oid) == queue.chunks.end() ? NULL : queue.chunks[oid];
+        cR = queue.chunks.get(oid, NULL);
 
         oid = cid + ChunkID(0, 1);
-        cT = queue.chunks.find(oid) == queue.chunks.end() ? NULL : queue.chunks[oid];
+        cT = queue.chunks.get(oid, NULL);
 
         oid = cid + ChunkID(-1, 0);
-        cL = queue.chunks.find(oid) == queue.chunks.end() ? NULL : queue.chunks[oid];
+        cL = queue.chunks.get(oid, NULL);
       
         oid = cid + ChunkID(0, -1);
-        cB = queue.chunks.find(oid) == queue.chunks.end() ? NULL : queue.chunks[oid];
-
-        // check if the hash has stayed the same, and if so, try and skip the chunk update
-        // TODO: maybe add a specific range of values that have been modified. For example,
-        //   if an interior block is modified that won't affect neighboring chunks, don't update
-        //   or recalculate the neighbors
-        // This makes the queuing code more complex, but it shouldn't be too bad
-        if (chunk->rcache.curHash != 0 && chunk->rcache.curHash == chunk->rcache.lastHash) {
-
-            if (chunkMeshes.find(chunk) != chunkMeshes.end()) {
-            
-                // if the chunk's hash didn't change, make sure none of the neighbors have changed
-                if (cL == chunk->rcache.cL && cT == chunk->rcache.cT && cR == chunk->rcache.cR && cB == chunk->rcache.cB) {
-                    
-                    // make sure the neighors either don't exist (and so couldn't have changed), or the hash is the same
-                    // if nothing has changed, we can skip this iteration of the for loop, because we don't need to recalculate the VBO
-                    // TODO: just check if the dirtyMin/Max includes near the edge of the chunk
-                    //   if just interior blocks of the neighbors have changed, we don't need to recalculate our geometry
-                    if (!cL || cL->rcache.curHash == cL->rcache.lastHash)
-                    if (!cT || cT->rcache.curHash == cT->rcache.lastHash)
-                    if (!cR || cR->rcache.curHash == cR->rcache.lastHash)
-                    if (!cB || cB->rcache.curHash == cB->rcache.lastHash) {
-                        // skip ahead
-                        continue;
-                    }
+        cB = queue.chunks.get(oid, NULL);
+
+        // the versions of the neighbors' borders that face this chunk (or 0 if they don't exist)
+        uint32_t bL = cL ? cL->versions.borders[Chunk::BORDER_R] : 0;
+        uint32_t bT = cT ? cT->versions.borders[Chunk::BORDER_B] : 0;
+        uint32_t bR = cR ? cR->versions.borders[Chunk::BORDER_L] : 0;
+        uint32_t bB = cB ? cB->versions.borders[Chunk::BORDER_T] : 0;
+
+        // check if the chunk has stayed the same since it was last meshed, and if so, skip the update
+        // We only need to recalculate if this chunk changed, a neighbor appeared/disappeared, or a
+        //   neighbor changed a block on the border touching this chunk (interior changes of the neighbors
+        //   can't affect our geometry)
+        if (chunk->rcache.lastVersion == chunk->versions.all && chunkMeshes.find(chunk) != chunkMeshes.end()) {
+            if (cL == chunk->rcache.cL && cT == chunk->rcache.cT && cR == chunk->rcache.cR && cB == chunk->rcache.cB) {
+                if (bL == chunk->rcache.lastBorders[Chunk::BORDER_L] && bT == chunk->rcache.lastBorders[Chunk::BORDER_T] &&
+                    bR == chunk->rcache.lastBorders[Chunk::BORDER_R] && bB == chunk->rcache.lastBorders[Chunk::BORDER_B]) {
+                    // skip ahead
+                    continue;
                 }
-
             }
         }
 
@@ -237,7 +248,12 @@ void Renderer::renderFrame() {
         chunk->rcache.cR = cR;
         chunk->rcache.cB = cB;
 
-        // the hash should already be up-to-date at this point
+        // remember what we are meshing, so we can tell if anything changes later
+        chunk->rcache.lastVersion = chunk->versions.all;
+        chunk->rcache.lastBorders[Chunk::BORDER_L] = bL;
+        chunk->rcache.lastBorders[Chunk::BORDER_T] = bT;
+        chunk->rcache.lastBorders[Chunk::BORDER_R] = bR;
+        chunk->rcache.lastBorders[Chunk::BORDER_B] = bB;
 
         // otherwise, we need to recalculate it
         chunkMeshRequests.insert(chunk);
@@ -268,7 +284,7 @@ void Renderer::renderFrame() {
         }
 
         // calculate the update
-        newcm->update(*cmit);
+        newcm->update(*cmit, meshMode);
         stats.n_chunk_recalcs++;
 
         chunkMeshRequests.erase(cmit);
@@ -277,16 +293,13 @@ void Renderer::renderFrame() {
 
 
     // now, reset the Chunk variables, mark them as rendered
-    //   and update their last render hash to their current, for next time
+    //   and clear their dirty state for next time
     for (int idx = 0; idx < N_chunks; ++idx) {
         // just expand out the queue entry
         Chunk* chunk = torender[idx];
 
         // it is not dirty any more
         chunk->rcache.isDirty = false;
-
-        // update the render hash as well
-        chunk->rcache.lastHash = chunk->rcache.curHash;
     }
 
     // record the time it took
@@ -363,6 +376,8 @@ void Renderer::renderFrame() {
      
             // add the number of triangles we requested to render
             stats.n_tris += cm->faces.size();
+            stats.n_chunk_tris += cm->faces.size();
+            stats.n_naive_tris += cm->numNaiveTris;
         }
 
     } 
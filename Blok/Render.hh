@@ -13,6 +13,12 @@
 /* main Blok library */
 #include <Blok/Blok.hh>
 
+/* grid of chunks around the camera */
+#include <Blok/ChunkGrid.hh>
+
+/* flat hash tables, for the per-frame lookups */
+#include <Blok/HashMap.hh>
+
 /* std libraries */
 #include <algorithm>
 #include <thread>
@@ -41,7 +47,7 @@ namespace Blok::Render {
         public:
 
         // a cache of constant textures that have been loaded
-        static Map<String, Texture*> cache;
+        static HashMap<String, Texture*> cache;
 
         // load a new copy of the texture
         // NOTE: the caller is responsible for deleting the texture after it is done
@@ -101,7 +107,7 @@ namespace Blok::Render {
         public:
 
         // cache of already existing fonts
-        static Map<String, FontTexture*> cache;    
+        static HashMap<String, FontTexture*> cache;    
     
         // load a constant, shared reference of the font-texture
         // NOTE: the caller should NOT free this texture, and it should also not
@@ -250,7 +256,7 @@ namespace Blok::Render {
         public:
 
         // a cache of constant, shared meshes
-        static Map<String, Mesh*> cache;
+        static HashMap<String, Mesh*> cache;
 
         // load a new copy of the mesh
         // NOTE: the caller is responsible for deleting the mesh after it is done
@@ -295,12 +301,13 @@ namespace Blok::Render {
         vec3 pos;
 
         // the texture coordinates (u, v)
+        // For faces that were merged (see `ChunkMesh::MODE_GREEDY`), these run past the block's part of
+        //   its texture, and are wrapped back into it, starting at 'tile'
         vec2 uv;
 
-        // the Tangent direction
-        vec3 T;
-        // the Bitangent direction
-        vec3 B;
+        // the corner of the block's texture that 'uv' is wrapped into
+        vec2 tile;
+
         // the Normal direction
         vec3 N;
 
@@ -311,9 +318,10 @@ namespace Blok::Render {
         float ao;
 
         // ambient occlusion?
-        ChunkMeshVertex(vec3 pos, vec2 uv, vec3 N, int blockID, float ao) {
+        ChunkMeshVertex(vec3 pos, vec2 uv, vec2 tile, vec3 N, int blockID, float ao) {
             this->pos = pos;
             this->uv = uv;
+            this->tile = tile;
             this->N = N;
             this->blockID = blockID;
             this->ao = ao;
@@ -335,11 +343,30 @@ namespace Blok::Render {
         // list of verteices, in no particular order. They are indexed by 'faces' list
         List<ChunkMeshVertex> vertices;
 
+        // Mode - how the visible faces of blocks are turned into quads
+        enum Mode {
+
+            // a quad for every face
+            MODE_NAIVE = 0,
+
+            // neighboring faces that look exactly the same (i.e. the same block, with the same ambient
+            //   occlusion) are merged into larger quads, with their texture repeated across them
+            MODE_GREEDY
+
+        };
+
         // list of all the faces, as triplets referring to indices in the 'vertices' list
         List<Face> faces;
 
-        // recalculate the mesh, do not update OpenGL though
-        void update(Chunk* chunk);
+        // the number of triangles the mesh would have with MODE_NAIVE, to compare against 'faces'
+        int numNaiveTris;
+
+        // recalculate the mesh, and upload it to OpenGL
+        void update(Chunk* chunk, Mode mode=MODE_GREEDY);
+
+        // calculate the mesh of 'chunk' with 'mode' into 'vertices' and 'faces' (without touching OpenGL),
+        //   and return the number of triangles it would have with MODE_NAIVE
+        static int build(Chunk* chunk, Mode mode, List<ChunkMeshVertex>& vertices, List<Face>& faces);
 
         // construct a new chunk mesh, with nothing in it.
         // call `update(chunk)` to cause a recalculation
@@ -472,20 +499,23 @@ namespace Blok::Render {
         int width, height;
 
         // various render targets, for different stages in processing
-        Map<String, Target*> targets;
+        HashMap<String, Target*> targets;
 
         // various shaders that are used
-        Map<String, Shader*> shaders;
+        HashMap<String, Shader*> shaders;
 
 
         // array of freely allocated ChunkMeshes
         List<ChunkMesh*> chunkMeshPool;
 
         // chunk mesh requests
-        Set<Chunk*> chunkMeshRequests;
+        HashSet<Chunk*> chunkMeshRequests;
         
         // chunk mesh objects
-        Map<Chunk*, ChunkMesh*> chunkMeshes;
+        HashMap<Chunk*, ChunkMesh*> chunkMeshes;
+
+        // how chunks are meshed
+        ChunkMesh::Mode meshMode;
 
 
         // the default background color
@@ -510,8 +540,9 @@ namespace Blok::Render {
         // the current queue of things that need to be rendered in the current frame
         struct RendererQueue {
             
-            // all requested chunks that need to be rendered
-            Map<ChunkID, Chunk*> chunks;
+            // all requested chunks that need to be rendered, in a grid around the camera, so that
+            //   finding neighbors is just an array access
+            ChunkGrid<Chunk*> chunks;
 
             // the list of misc. meshes to render
             // See here: https://computergraphics.stackexchange.com/questions/37/what-is-the-cost-of-changing-state/46#46
@@ -554,12 +585,18 @@ namespace Blok::Render {
             // number of triangles (total) send to OpenGL
             int n_tris;
 
+            // number of those that were for chunks, and how many there would have been with the naive
+            //   mesher (see `ChunkMesh::MODE_NAIVE`)
+            int n_chunk_tris, n_naive_tris;
+
             Stats() {
                 // reset all statistics by default
                 t_chunks = 0.0;
                 n_chunks = 0;
                 n_chunk_recalcs = 0;
                 n_tris = 0;
+                n_chunk_tris = 0;
+                n_naive_tris = 0;
             }
 
         } stats;
@@ -584,6 +621,9 @@ namespace Blok::Render {
             // add a nice default color
             clearColor = vec3(0.1f, 0.1f, 0.1f);
 
+            // merge faces, unless asked not to
+            meshMode = ChunkMesh::MODE_GREEDY;
+
             // construct our geometry pass
             targets["GEOM"] = new Target(width, height, 5);
             
@@ -0,0 +1,278 @@
+/* Save.hh - on-disk persistence of worlds
+ *
+ * Worlds are stored as a directory of 'region files', each of which holds a REGION_SIZE x REGION_SIZE
+ *   square of chunks. Only chunks that have been saved are in a region file; anything else can
+ *   just be generated again.
+ *
+ * A region file looks like:
+ *
+ *   [header (REGION_HEADER_SECTORS sectors)]
+ *     magic ("BLKR"), format version (uint32), world generator fingerprint (uint64)
+ *     offset table: REGION_NUM_CHUNKS entries of (uint32 first sector, uint32 number of sectors),
+ *       indexed by `REGION_SIZE * localZ + localX`. A first sector of 0 means the chunk is not stored
+ *   [chunk payloads]
+ *     each takes up a whole number of REGION_SECTOR_SIZE byte sectors, and starts with its
+ *       compressed length (uint32), followed by the compressed data
+ *
+ * A chunk payload (before compression) is either:
+ *
+ *   * full (PAYLOAD_FULL): every section of the chunk
+ *   * delta (PAYLOAD_DELTA): a bitmask of sections (uint16), and then only those sections, which
+ *       are applied on top of what the world generator produces for the chunk. Sections are
+ *       usually stored as a sparse list of changed blocks (SECTION_SPARSE)
+ *
+ * Since the world generator is a pure function of the seed and chunk ID, delta saves only have to
+ *   store what the player changed, which for most worlds is a tiny fraction of the blocks (and
+ *   chunks that were never edited aren't stored at all). The tradeoff is that loading a chunk
+ *   means generating it again (see `RegionStore::Mode`)
+ *
+ * That only works if the generator makes exactly the same chunks it did when they were saved, so each
+ *   region file records the fingerprint of the generator it was made with (see `WG::getFingerprint()`),
+ *   and a file with a different one is refused, rather than applying its deltas to the wrong chunks
+ *
+ * When a chunk is saved again, it is written to the first run of free sectors large enough (or, the
+ *   file is extended), and its old sectors are only freed once the offset table points to the new ones
+ *
+ * Reads go through a read-only mmap() of the whole file, so loading a chunk is just a page fault and
+ *   a decompress. Writes go through pwrite()
+ *
+ * All values are stored in the native (little endian, on all the platforms we support) byte order
+ *
+ * See `save/Region.cc` for the implementation
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_SAVE_HH__
+#define BLOK_SAVE_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+// delta saves need to generate the original chunks
+#include <Blok/WG.hh>
+
+#include <mutex>
+
+namespace Blok::Save {
+
+    // the number of chunks along each side of a region
+    #define REGION_SIZE 32
+
+    // the number of chunks in a region
+    #define REGION_NUM_CHUNKS (REGION_SIZE * REGION_SIZE)
+
+    // the size of a sector in a region file, which is the unit space is allocated in
+    // This is kept small, since delta saves are often only a few bytes
+    #define REGION_SECTOR_SIZE 256
+
+    // the offset of the offset table in the header
+    #define REGION_TABLE_OFFSET 16
+
+    // the number of sectors taken up by the header (which includes the offset table)
+    #define REGION_HEADER_SECTORS ((REGION_TABLE_OFFSET + 8 * REGION_NUM_CHUNKS + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE)
+
+    // the current version of the region file format
+    #define REGION_VERSION 3
+
+    // the kinds of chunk payloads (the first byte of the payload)
+    enum {
+        PAYLOAD_FULL = 0,
+        PAYLOAD_DELTA = 1
+    };
+
+    // the kinds of encoded sections (the first byte of each section)
+    enum {
+        // the section is a single value (uint16)
+        SECTION_UNIFORM = 0,
+
+        // the section's palette-compressed storage: lbits (uint8), palette size (uint16), the palette
+        //   (uint16 each), then the index words
+        SECTION_PALETTE = 1,
+
+        // (only in delta payloads) a list of changes: the number of changes (uint16), then that many
+        //   pairs of index within the section (uint16) and value (uint16)
+        SECTION_SPARSE = 2
+    };
+
+
+    /* CHUNK ENCODING */
+
+    // serialize 'chunk' (its blocks, not its entities) into 'out', as an uncompressed full payload
+    // Sections are written in their palette-compressed form, so this is just a copy
+    void encodeChunk(const Chunk* chunk, List<uint8_t>& out);
+
+    // serialize the differences between 'chunk' and 'base' (what the world generator produces for
+    //   it) into 'out', as an uncompressed delta payload
+    // Only sections in `chunk->editedSections` are compared, and if there are none, 'base' may be NULL
+    void encodeChunkDelta(const Chunk* chunk, const Chunk* base, List<uint8_t>& out);
+
+    // create a new chunk from a payload written by `encodeChunk()` or `encodeChunkDelta()`, returning
+    //   NULL if it was invalid. Delta payloads are applied on top of a chunk from 'worldGen'
+    Chunk* decodeChunk(ChunkID id, const uint8_t* data, size_t len, WG::WG* worldGen);
+
+    // compress 'len' bytes of 'data', appending to 'out'
+    // This is a simple run-length encoding (i.e. PackBits), which works well on chunks, since
+    //   they are mostly long runs of the same palette index
+    void compress(const uint8_t* data, size_t len, List<uint8_t>& out);
+
+    // decompress 'len' bytes of 'data' (given by `compress()`), appending to 'out'. Returns whether it
+    //   was valid
+    bool decompress(const uint8_t* data, size_t len, List<uint8_t>& out);
+
+
+    // RegionFile - a single file holding a square of REGION_SIZE x REGION_SIZE chunks
+    // All methods are thread-safe
+    class RegionFile {
+        public:
+
+        // the path of the file
+        String path;
+
+        // open the region file at 'path', returning NULL if it does not exist (and 'create' is false),
+        //   or if it could not be opened
+        // New files are stamped with the generator 'fingerprint', and existing ones with a different
+        //   fingerprint are refused (unless 'fingerprint' is 0, i.e. there is no generator)
+        static RegionFile* open(const String& path, bool create, uint64_t fingerprint);
+
+        // close the file
+        ~RegionFile();
+
+        // region files own their file descriptor and mapping, so they should not be copied
+        RegionFile(const RegionFile& other) = delete;
+        RegionFile& operator=(const RegionFile& other) = delete;
+
+        // return whether the chunk at local index 'idx' is stored in this region
+        bool hasChunk(int idx);
+
+        // read the chunk at local index 'idx' (decompressed), into 'out'. Returns false if it is not
+        //   stored (or could not be read)
+        bool readChunk(int idx, List<uint8_t>& out);
+
+        // write (or overwrite) the chunk at local index 'idx' with the (uncompressed) payload 'data',
+        //   returning whether it succeeded
+        bool writeChunk(int idx, const List<uint8_t>& data);
+
+        // flush all writes to the disk
+        void sync();
+
+        private:
+
+        // the file descriptor
+        int fd;
+
+        // the current read-only mapping of the file, and its size in bytes
+        // This is remapped whenever the file has grown past it
+        const uint8_t* map;
+        size_t mapSize;
+
+        // the size of the file, in sectors
+        uint32_t numSectors;
+
+        // the offset table (see the top of this file), as {first sector, number of sectors}
+        uint32_t table[REGION_NUM_CHUNKS][2];
+
+        // which sectors are in use (either by the header, or a chunk)
+        List<bool> used;
+
+        // the lock for all of the above
+        std::mutex L_file;
+
+        // use `open()` to create region files
+        RegionFile() {}
+
+        // make sure 'map' covers at least 'size' bytes of the file (with `L_file` held), returning
+        //   whether it does
+        bool ensureMapped(size_t size);
+
+        // find 'num' free sectors in a row (with `L_file` held), marking them used, and returning the first
+        uint32_t allocSectors(uint32_t num);
+
+    };
+
+
+    // RegionStore - the collection of region files for a world, which are stored in a directory
+    // All methods are thread-safe
+    class RegionStore {
+        public:
+
+        // the directory the region files are in
+        String dir;
+
+        // Mode - how chunks are saved
+        enum Mode {
+
+            // save every chunk in full, so loading a chunk never has to generate it
+            MODE_FULL = 0,
+
+            // only save what has been edited (see the top of this file), so saves are tiny, and chunks
+            //   that were never edited are never saved
+            MODE_DELTA = 1
+
+        };
+
+        // the mode chunks are saved in (chunks saved in either mode can always be loaded)
+        Mode mode;
+
+        // the world generator, which is used to generate the chunks that delta saves apply to
+        WG::WG* worldGen;
+
+        // open the world stored in 'dir' (which is created if it does not exist)
+        // The world generator is required to load (or save) in delta mode
+        RegionStore(const String& dir, Mode mode=MODE_FULL, WG::WG* worldGen=NULL);
+
+        // close all region files
+        ~RegionStore();
+
+        // return whether the chunk 'id' has been saved
+        bool hasChunk(ChunkID id);
+
+        // load the chunk 'id', returning NULL if it has never been saved
+        Chunk* loadChunk(ChunkID id);
+
+        // save the chunk, returning whether it succeeded
+        bool saveChunk(const Chunk* chunk);
+
+        // return whether a chunk that has not been modified since it was generated or loaded (see
+        //   `Chunk::isModified()`) should still be saved
+        // In full mode, that is if it has never been saved, and in delta mode, never (since it is the
+        //   same as what is stored, or what would be generated)
+        bool needsSave(const Chunk* chunk) {
+            return mode == MODE_FULL && !hasChunk(chunk->XZ);
+        }
+
+        // flush all region files to the disk
+        void sync();
+
+        // return the region that a chunk is in, and its index within that region
+        static ChunkID getRegionID(ChunkID id, int& idx) {
+            // NOTE: round towards negative infinity, so negative chunks work
+            ChunkID rid = ChunkID((int)floor(id.X / (double)REGION_SIZE), (int)floor(id.Z / (double)REGION_SIZE));
+            idx = REGION_SIZE * (id.Z - REGION_SIZE * rid.Z) + (id.X - REGION_SIZE * rid.X);
+            return rid;
+        }
+
+        // return the path of the file for region 'rid'
+        String getRegionPath(ChunkID rid) const;
+
+        private:
+
+        // the region files that have been opened so far
+        Map<ChunkID, RegionFile*> regions;
+
+        // the regions that could not be opened (i.e. they were made by a different generator), which
+        //   are never tried again, so they are left as they are instead of being overwritten
+        Set<ChunkID> failed;
+
+        // the lock for 'regions' and 'failed'
+        std::mutex L_regions;
+
+        // get the region 'rid', opening it if it exists (or, creating it if 'create' is true)
+        RegionFile* getRegion(ChunkID rid, bool create);
+
+    };
+
+}
+
+#endif /* BLOK_SAVE_HH__ */
@@ -0,0 +1,152 @@
+/* SectionTable.hh - table of interned (shared) chunk section storage
+ *
+ * Many non-uniform sections in a world are exactly the same (i.e. the layers of a flat world, or the
+ *   same patch of terrain in chunks that were saved and loaded again), but each chunk keeps its own
+ *   copy. Block storage is reference counted and copied on write (see `BlockStorage`), so identical
+ *   sections can point to a single copy instead.
+ *
+ * This table keeps one copy of each distinct storage it has seen, keyed by the hash of its contents
+ *   (see `BlockStorage::calcHash()`). Interning a chunk replaces each of its storages with the copy
+ *   in the table (if there is one), and adds the rest to the table. The table holds a reference to
+ *   everything in it (marking it with `BlockStorage::isInterned`, so chunks don't count it as a user in
+ *   `Chunk::getMemoryUsage()`), so entries that no chunk uses anymore are only freed by `prune()`
+ *
+ */
+
+#pragma once
+
+#ifndef BLOK_SECTIONTABLE_HH__
+#define BLOK_SECTIONTABLE_HH__
+
+// general Blok library
+#include <Blok/Blok.hh>
+
+// for the buckets of storages
+#include <Blok/HashMap.hh>
+
+#include <mutex>
+
+namespace Blok {
+
+    // SectionTable - a set of distinct block storages, which chunks can share
+    // All methods are thread-safe
+    class SectionTable {
+        public:
+
+        // statistics about what has been interned
+        struct {
+
+            // the number of storages that were interned
+            std::atomic<int> n_interned;
+
+            // the number of those that were replaced by an existing copy
+            std::atomic<int> n_shared;
+
+        } stats;
+
+        // construct an empty table
+        SectionTable() {
+            stats.n_interned = 0;
+            stats.n_shared = 0;
+            num = 0;
+        }
+
+        // release everything in the table (chunks still using them keep them)
+        ~SectionTable() {
+            for (auto& entry : buckets) {
+                for (BlockStorage* blocks : entry.second) {
+                    blocks->release();
+                }
+            }
+        }
+
+        // the table holds references, so it should not be copied
+        SectionTable(const SectionTable& other) = delete;
+        SectionTable& operator=(const SectionTable& other) = delete;
+
+        // return a storage with the same contents as 'blocks', which is either 'blocks' itself (which is
+        //   then added to the table), or an existing copy. This takes over the caller's reference to
+        //   'blocks', and gives the caller a reference to the result
+        BlockStorage* intern(BlockStorage* blocks) {
+            // hash it before taking the lock, since that is the slowest part
+            uint64_t hash = blocks->calcHash();
+            stats.n_interned.fetch_add(1, std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(L_table);
+            List<BlockStorage*>& bucket = buckets[hash];
+            for (BlockStorage* other : bucket) {
+                if (other == blocks) return blocks;
+                if (other->equals(*blocks)) {
+                    other->acquire();
+                    blocks->release();
+                    stats.n_shared.fetch_add(1, std::memory_order_relaxed);
+                    return other;
+                }
+            }
+
+            blocks->isInterned.store(true, std::memory_order_relaxed);
+            bucket.push_back(blocks->acquire());
+            num++;
+            return blocks;
+        }
+
+        // intern the storage of every section in 'chunk'
+        // NOTE: the chunk must not be in use by any other thread (i.e. it has just been generated)
+        void internChunk(Chunk* chunk) {
+            for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+                ChunkSection& sec = chunk->sections[i];
+                if (sec.blocks != NULL) sec.blocks = intern(sec.blocks);
+            }
+        }
+
+        // free any storages that only the table is using, and return the number freed
+        // This looks at the whole table, so it shouldn't be done too often (the server does it every
+        //   SECTION_PRUNE_INTERVAL ticks)
+        int prune() {
+            std::lock_guard<std::mutex> lock(L_table);
+            int res = 0;
+            auto it = buckets.begin();
+            while (it != buckets.end()) {
+                List<BlockStorage*>& bucket = it->second;
+                for (size_t i = 0; i < bucket.size(); ) {
+                    // NOTE: nobody else can add a reference to an entry without the lock, so if it is
+                    //   only ours, it stays that way
+                    if (!bucket[i]->isShared()) {
+                        bucket[i]->isInterned.store(false, std::memory_order_relaxed);
+                        bucket[i]->release();
+                        bucket[i] = bucket.back();
+                        bucket.pop_back();
+                        res++;
+                    } else {
+                        i++;
+                    }
+                }
+                if (bucket.size() == 0) it = buckets.erase(it);
+                else it++;
+            }
+            num -= res;
+            return res;
+        }
+
+        // return the number of distinct storages in the table
+        int size() {
+            std::lock_guard<std::mutex> lock(L_table);
+            return num;
+        }
+
+        private:
+
+        // the storages, indexed by the hash of their contents
+        HashMap<uint64_t, List<BlockStorage*> > buckets;
+
+        // the number of storages in 'buckets'
+        int num;
+
+        // held while using 'buckets'
+        std::mutex L_table;
+
+    };
+
+}
+
+#endif /* BLOK_SECTIONTABLE_HH__ */
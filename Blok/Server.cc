@@ -88,8 +88,11 @@ bool LocalServer::raycastBlock(Ray ray, float maxDist, RayHit& hitInfo) {
             //printf("local:%i,%i,%i\n", local.x, local.y, local.z);
             //dirtyClient->gfx.renderer->renderMesh(Render::Mesh::loadConst("assets/obj/Sphere.obj"), glm::translate(xyz + vec3(0.5)) * glm::scale(vec3(0.3)));
 
-            // probe the block, and check if it is not air
-            if (local.y >= 0 && local.y < CHUNK_SIZE_Y && (hitInfo.blockData = cc->get(local.x, local.y, local.z)).id != ID::AIR) {
+            // probe the block, and check if it is not air (using the column's height and solid bits, so
+            //   the block itself is only looked up once it's hit)
+            if (local.y >= 0 && local.y <= cc->getHeight(local.x, local.z) && cc->isSolid(local.x, local.y, local.z)) {
+                hitInfo.blockData = cc->get(local.x, local.y, local.z);
+
                 // obviously, we've hit
                 hitInfo.hit = true;
 
@@ -159,54 +162,429 @@ bool LocalServer::raycastBlock(Ray ray, float maxDist, RayHit& hitInfo) {
 }
 
 
-// this is the target that should be ran all the time, by the T_chunkLoad thread,
-//   which attempts to service the chunk loader
-void LocalServer::T_chunkLoad_run() {
-    while (true) {
-        struct timespec tim;
-        // wait for a second
-        tim.tv_sec = 0;
-        // run every 100 ms
-        tim.tv_nsec = 25 * 1000000;
-
-        // wait until there was something
-        while (chunkRequests.size() == 0) {
-            nanosleep(&tim, NULL);
+void Server::addTicket(ChunkID id, TicketLevel level) {
+    lockChunks();
+    changeTicketLocked(id, level, +1);
+    unlockChunks();
+}
+
+void Server::removeTicket(ChunkID id, TicketLevel level) {
+    lockChunks();
+    changeTicketLocked(id, level, -1);
+    unlockChunks();
+}
+
+void Server::changeTicketLocked(ChunkID id, TicketLevel level, int delta) {
+    changeTicketCount(id, level, delta);
+
+    // full chunks need their neighbors around
+    if (level == TICKET_FULL) {
+        for (int X = -1; X <= 1; ++X) {
+            for (int Z = -1; Z <= 1; ++Z) {
+                if (X != 0 || Z != 0) changeTicketCount(id + ChunkID(X, Z), TICKET_BORDER, delta);
+            }
         }
+    }
+}
 
+void Server::changeTicketCount(ChunkID id, TicketLevel level, int delta) {
+    if (level == TICKET_NONE) return;
+    ChunkTickets& ct = tickets[id];
+    if (ct.counts[level] + delta < 0) {
+        blok_warn("removed a ticket (level %i) on chunk (%i, %i) that was never added!", (int)level, id.X, id.Z);
+        if (ct.getLevel() == TICKET_NONE) tickets.erase(id);
+        return;
+    }
 
-        L_chunks.lock();
+    TicketLevel before = ct.getLevel();
+    ct.counts[level] += delta;
+    TicketLevel after = ct.getLevel();
+    if (after == TICKET_NONE) tickets.erase(id);
+
+    if (before == TICKET_NONE && after != TICKET_NONE) {
+        // newly needed, so make sure it gets loaded
+        requestChunkLocked(id);
+    } else if (before >= TICKET_BORDER && after < TICKET_BORDER) {
+        // it was in use up until now, and may be unloaded from here on, which goes by last use
+        Chunk* chunk = loadedChunks.find(id);
+        if (chunk != NULL) chunk->lastAccess = tick.load();
+    }
+}
+
+Subscription* Server::subscribe(ChunkID center, int radius) {
+    // start with nothing in view, and then move it into place, so everything comes into view
+    Subscription* sub = new Subscription();
+    sub->center = center;
+    sub->radius = -1;
+
+    lockChunks();
+    subscriptions.push_back(sub);
+    unlockChunks();
+
+    moveSubscription(sub, center, radius);
+    return sub;
+}
+
+void Server::moveSubscription(Subscription* sub, ChunkID center, int radius) {
+    lockChunks();
+    if (sub->center == center && sub->radius == radius) {
+        unlockChunks();
+        return;
+    }
+
+    ChunkID oldCenter = sub->center;
+    int oldRadius = sub->radius;
+    sub->center = center;
+    sub->radius = radius;
+
+    // first, anything that left the view
+    // NOTE: only loaded chunks could have been sent to the subscriber
+    for (int X = -oldRadius; X <= oldRadius; ++X) {
+        for (int Z = -oldRadius; Z <= oldRadius; ++Z) {
+            ChunkID id = oldCenter + ChunkID(X, Z);
+            if (!Subscription::isInView(oldCenter, oldRadius, id) || sub->contains(id)) continue;
+
+            if (loadedChunks.find(id) != NULL) sub->events.push(ChunkEvent(ChunkEvent::EVENT_LEFT_VIEW, id, NULL));
+            changeTicketLocked(id, TICKET_FULL, -1);
+        }
+    }
 
-        auto it = chunkRequests.cbegin();
-        int ct = 0;
+    // then, anything that came into view
+    for (int X = -radius; X <= radius; ++X) {
+        for (int Z = -radius; Z <= radius; ++Z) {
+            ChunkID id = center + ChunkID(X, Z);
+            if (!sub->contains(id) || Subscription::isInView(oldCenter, oldRadius, id)) continue;
 
-        chunkRequestsInProgress.clear();
+            // this requests it, if it isn't loaded
+            changeTicketLocked(id, TICKET_FULL, +1);
 
-        // grab off some chunk requests
-        while (it != chunkRequests.cend() && ct < 8) {
-            chunkRequestsInProgress.insert(*it);
-            chunkRequests.erase(it++);
-            ct++;
+            Chunk* chunk = loadedChunks.find(id);
+            if (chunk != NULL) sub->events.push(ChunkEvent(ChunkEvent::EVENT_READY, id, chunk));
         }
+    }
 
-        L_chunks.unlock();
+    unlockChunks();
+}
 
-        Map<ChunkID, Chunk*> gen;
+void Server::unsubscribe(Subscription* sub) {
+    lockChunks();
+    subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), sub), subscriptions.end());
 
-        for (auto cid : chunkRequestsInProgress) {
-            gen[cid] = worldGen->getChunk(cid);
+    // release everything in view
+    for (int X = -sub->radius; X <= sub->radius; ++X) {
+        for (int Z = -sub->radius; Z <= sub->radius; ++Z) {
+            ChunkID id = sub->center + ChunkID(X, Z);
+            if (sub->contains(id)) changeTicketLocked(id, TICKET_FULL, -1);
         }
+    }
+    unlockChunks();
+
+    delete sub;
+}
 
-        // store them back
+bool Server::setBlock(vec3i pos, BlockData data) {
+    if (pos.y < 0 || pos.y >= CHUNK_SIZE_Y) return false;
 
-        L_chunks.lock();
-        for (auto elem : gen) {
-            loadedChunks[elem.first] = elem.second;
+    ChunkID id = ChunkID::fromPos(pos);
+    Chunk* chunk = getChunk(id, false);
+    if (chunk == NULL) return false;
+
+    vec3i local = pos - chunk->getWorldPos();
+    chunk->set(local.x, local.y, local.z, data);
+
+    lockChunks();
+    notifySubscriptions(ChunkEvent::EVENT_CHANGED, id, chunk);
+    unlockChunks();
+    return true;
+}
+
+
+// the maximum number of requests a worker takes from the global requests at once
+// Taking a batch means less contention on `L_chunks`, and the rest of the batch can still be stolen
+//   by idle workers
+#define MAX_BATCH 16
+
+// the number of ticks between looking for shared sections that nothing uses anymore (which means
+//   looking at every section in `sectionTable`)
+#define SECTION_PRUNE_INTERVAL 64
+
+// this is the target that is ran by each worker thread, which generates chunks
+//   until the server is destroyed
+void LocalServer::T_worker_run(Worker* w) {
+    ChunkID id;
+    while (nextRequest(w, id)) {
+        // if the chunk was just evicted, wait until it has been saved, so it isn't loaded from the store
+        //   before then
+        // NOTE: the lock is only held to check for work here, so the wait isn't counted in `lockStats`
+        std::unique_lock<std::mutex> lock(L_chunks);
+        CV_saved.wait(lock, [&]() { return chunksSaving.count(id) == 0; });
+        beginHold();
+
+        // the request may have been cancelled (i.e. the viewer moved away) while it sat in a queue, or
+        //   the chunk may have been kept (if it couldn't be saved)
+        bool isWanted = (chunkRequests.isInRange(id) || getTicketLevelLocked(id) != TICKET_NONE) && loadedChunks.find(id) == NULL;
+        if (!isWanted) chunkRequestsInProgress.erase(id);
+        endHold();
+        lock.unlock();
+        if (!isWanted) continue;
+
+        // first, try and load it, and only generate it if it has never been saved
+        double st = getTime();
+        Chunk* chunk = store != NULL ? store->loadChunk(id) : NULL;
+        bool isLoaded = chunk != NULL;
+        if (!isLoaded) {
+            chunk = worldGen->getChunk(id);
+
+            // all of its blocks are exactly what the generator made
+            chunk->editedSections = 0;
         }
-        chunkRequestsInProgress.clear();
-        L_chunks.unlock();
 
+        // share any sections that other chunks already have
+        if (sectionTable != NULL) sectionTable->internChunk(chunk);
+        st = getTime() - st;
+
+        // nothing has been changed yet
+        chunk->cleanVersion = chunk->versions.all;
+
+        // store it back
+        lockChunks();
+        chunk->lastAccess = tick.load();
+        loadedChunks.insert(id, chunk);
+        chunkRequestsInProgress.erase(id);
+        notifySubscriptions(ChunkEvent::EVENT_READY, id, chunk);
+        unlockChunks();
+
+        // we are the only writer, so there's no need for an atomic add
+        w->stats.n_chunks.store(w->stats.n_chunks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        w->stats.t_chunks.store(w->stats.t_chunks.load(std::memory_order_relaxed) + st, std::memory_order_relaxed);
+        if (isLoaded) w->stats.n_loaded.store(w->stats.n_loaded.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+bool LocalServer::saveChunk(Chunk* chunk) {
+    if (store == NULL) return !chunk->isModified();
+
+    // unmodified chunks are already saved (or, can be generated again)
+    if (!chunk->isModified() && !store->needsSave(chunk)) return true;
+
+    if (!store->saveChunk(chunk)) return !chunk->isModified();
+
+    chunk->cleanVersion = chunk->versions.all;
+    return true;
+}
+
+int LocalServer::evictChunks() {
+    // every so often, free the shared sections that were left behind by evictions (or edits)
+    // NOTE: this doesn't need `L_chunks`, since nothing but the table can reach the ones it frees
+    if (sectionTable != NULL && tick.load() % SECTION_PRUNE_INTERVAL == 0) sectionTable->prune();
+
+    lockChunks();
+
+    // nothing is holding on to chunks (or lookups) between frames, so now is a good time to free
+    //   any old tables
+    loadedChunks.reclaim();
+
+    // anything requested during the previous tick (i.e. the last frame) is still in use
+    uint64_t minTick = tick;
+    tick++;
+
+    // tally up what is loaded, including the chunks the generator has staged
+    int numChunks = loadedChunks.size();
+    size_t stagedBytes = worldGen->pipeline.getMemoryUsage();
+    size_t numBytes = stagedBytes;
+    for (Chunk* chunk : loadedChunks) {
+        numBytes += chunk->getMemoryUsage();
     }
+
+    // staged chunks are only a cache, so if they put us over budget, free them before any loaded chunk
+    if (budget.maxBytes > 0 && numBytes > budget.maxBytes && stagedBytes > 0) {
+        worldGen->pipeline.clear();
+        numBytes -= stagedBytes - worldGen->pipeline.getMemoryUsage();
+    }
+
+    // check if we are within budget
+    if ((budget.maxChunks <= 0 || numChunks <= budget.maxChunks) && (budget.maxBytes <= 0 || numBytes <= budget.maxBytes)) {
+        unlockChunks();
+        return 0;
+    }
+
+    // sort the candidates by their ticket level, and then from least to most recently used
+    List< Pair< Pair<int, uint64_t>, Chunk*> > candidates;
+    for (Chunk* chunk : loadedChunks) {
+        // chunks with tickets at or above TICKET_BORDER (i.e. in view) are always in use, even if nobody
+        //   asks for them
+        TicketLevel level = getTicketLevelLocked(chunk->XZ);
+        if (level < TICKET_BORDER && chunk->lastAccess < minTick) {
+            candidates.push_back({ { (int)level, chunk->lastAccess.load() }, chunk });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // take them out until we are within budget
+    List<Chunk*> evicted;
+    for (auto& cand : candidates) {
+        if ((budget.maxChunks <= 0 || numChunks <= budget.maxChunks) && (budget.maxBytes <= 0 || numBytes <= budget.maxBytes)) break;
+        Chunk* chunk = cand.second;
+
+        // there's nowhere to save edits to, so they have to stay loaded
+        if (store == NULL && chunk->isModified()) continue;
+
+        numChunks--;
+        numBytes -= chunk->getMemoryUsage();
+        loadedChunks.erase(chunk->XZ);
+        chunksSaving.insert(chunk->XZ);
+        evicted.push_back(chunk);
+
+        // unlink it from the neighbors that are still loaded (by looking them up), and forget its own
+        //   links without following them, since they can't be trusted to point at live chunks unless
+        //   whoever set them kept both sides the same (like the renderer does)
+        Chunk* cR = loadedChunks.find(chunk->XZ + ChunkID(1, 0));
+        Chunk* cT = loadedChunks.find(chunk->XZ + ChunkID(0, 1));
+        Chunk* cL = loadedChunks.find(chunk->XZ + ChunkID(-1, 0));
+        Chunk* cB = loadedChunks.find(chunk->XZ + ChunkID(0, -1));
+        if (cR != NULL && cR->rcache.cL == chunk) cR->rcache.cL = NULL;
+        if (cT != NULL && cT->rcache.cB == chunk) cT->rcache.cB = NULL;
+        if (cL != NULL && cL->rcache.cR == chunk) cL->rcache.cR = NULL;
+        if (cB != NULL && cB->rcache.cT == chunk) cB->rcache.cT = NULL;
+        chunk->rcache.cL = chunk->rcache.cT = chunk->rcache.cR = chunk->rcache.cB = NULL;
+    }
+
+    unlockChunks();
+
+    // save them outside of the lock, since encoding (which, for delta saves, generates the chunk again),
+    //   compressing, and writing them are all slow. Nothing else can get to these chunks anymore, and
+    //   any worker asked to load one waits on `CV_saved` until it is done
+    List<Chunk*> kept;
+    for (size_t i = 0; i < evicted.size(); ++i) {
+        if (!saveChunk(evicted[i])) {
+            kept.push_back(evicted[i]);
+            evicted.erase(evicted.begin() + i--);
+        }
+    }
+
+    lockChunks();
+    chunksSaving.clear();
+
+    // anything that failed to save is loaded again, so its edits aren't lost
+    for (Chunk* chunk : kept) {
+        numChunks++;
+        numBytes += chunk->getMemoryUsage();
+        loadedChunks.insert(chunk->XZ, chunk);
+        notifySubscriptions(ChunkEvent::EVENT_READY, chunk->XZ, chunk);
+    }
+    unlockChunks();
+    CV_saved.notify_all();
+
+    // The renderer has already dropped these, since it only keeps what was requested last frame, and
+    //   they were unlinked from their neighbors above
+    for (Chunk* chunk : evicted) {
+        delete chunk;
+    }
+
+    if (evicted.size() > 0) blok_trace("evicted %i chunks (%i loaded, %.1lfmb)", (int)evicted.size(), numChunks, numBytes / (1024.0 * 1024.0));
+
+    return evicted.size();
+}
+
+bool LocalServer::nextRequest(Worker* w, ChunkID& id) {
+    while (true) {
+
+        // first, check our own queue, newest first
+        w->L_queue.lock();
+        if (w->queue.size() > 0) {
+            id = w->queue.back();
+            w->queue.pop_back();
+            numQueued--;
+            w->L_queue.unlock();
+            return true;
+        }
+        w->L_queue.unlock();
+
+        // then, take a batch from the global requests
+        std::unique_lock<std::mutex> lock(L_chunks);
+        beginHold();
+        if (isStopping) {
+            endHold();
+            return false;
+        }
+
+        if (chunkRequests.size() > 0) {
+            // take an even share of what's there, so that the other workers don't have to steal
+            int num = chunkRequests.size() / workers.size();
+            if (num < 1) num = 1;
+            if (num > MAX_BATCH) num = MAX_BATCH;
+
+            // these come out most important first
+            ChunkID batch[MAX_BATCH];
+            for (int i = 0; i < num; ++i) {
+                batch[i] = chunkRequests.pop();
+                chunkRequestsInProgress.insert(batch[i]);
+            }
+
+            // the rest of the batch will be in our queue, so make sure that is visible to anyone
+            //   about to sleep
+            numQueued += num - 1;
+            endHold();
+            lock.unlock();
+
+            id = batch[0];
+            if (num > 1) {
+                // we take from the back, so add the most important last (and thieves get the least important)
+                w->L_queue.lock();
+                for (int i = num - 1; i >= 1; --i) {
+                    w->queue.push_back(batch[i]);
+                }
+                w->L_queue.unlock();
+
+                // let any idle workers come and steal some
+                CV_chunks.notify_all();
+            }
+            return true;
+        }
+        endHold();
+        lock.unlock();
+
+        // then, try and steal from another worker
+        if (stealRequests(w, id)) return true;
+
+        // otherwise, there is no work anywhere, so sleep until there is
+        // NOTE: the lock is only held to check for work here, so it isn't counted in `lockStats`
+        lock.lock();
+        CV_chunks.wait(lock, [&]() { return isStopping || chunkRequests.size() > 0 || numQueued.load() > 0; });
+    }
+}
+
+bool LocalServer::stealRequests(Worker* w, ChunkID& id) {
+    int N = workers.size();
+    for (int i = 1; i < N; ++i) {
+        Worker* victim = workers[(w->idx + i) % N];
+
+        // take half of their queue (rounded up), from the least important end
+        List<ChunkID> stolen;
+        victim->L_queue.lock();
+        int num = (victim->queue.size() + 1) / 2;
+        for (int j = 0; j < num; ++j) {
+            stolen.push_back(victim->queue.front());
+            victim->queue.pop_front();
+        }
+        victim->L_queue.unlock();
+
+        if (stolen.size() > 0) {
+            // keep the most important one, and queue the rest in the same order
+            id = stolen.back();
+            stolen.pop_back();
+            numQueued--;
+
+            w->L_queue.lock();
+            for (ChunkID sid : stolen) {
+                w->queue.push_back(sid);
+            }
+            w->L_queue.unlock();
+            return true;
+        }
+    }
+
+    return false;
 }
 
 };
@@ -26,15 +26,312 @@
 // include entity protocol
 #include <Blok/Entity.hh>
 
+// world persistence
+#include <Blok/Save.hh>
+
+// the table of loaded chunks
+#include <Blok/ChunkTable.hh>
+
+// identical sections can be shared between chunks
+#include <Blok/SectionTable.hh>
+
+// flat hash tables, for chunk requests and entities
+#include <Blok/HashMap.hh>
+
+// lock-free queues, for chunk events
+#include <Blok/Queue.hh>
+
 // for MP processing
 #include <mutex> 
 #include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <algorithm>
 #include <time.h>
 #include <chrono> 
 
 
 namespace Blok {
 
+    // TicketLevel - how badly a chunk is needed, which is held as a 'ticket' on that chunk (see
+    //   `Server::addTicket()`). The level of a chunk is the highest level of any ticket on it, and
+    //   decides what the server does with it
+    enum TicketLevel {
+
+        // no tickets, so the chunk is only loaded if someone asked for it (with `Server::getChunk()`),
+        //   and may be unloaded at any time
+        TICKET_NONE = 0,
+
+        // the chunk should be generated, but it may be unloaded (before any chunks with no tickets)
+        //   to stay within the memory budget
+        TICKET_PRELOAD = 1,
+
+        // the chunk is needed as the neighbor of a full chunk (i.e. so the full chunk can be meshed
+        //   against its borders), so it is kept loaded
+        TICKET_BORDER = 2,
+
+        // the chunk is in use (i.e. in view, or holding an entity), so it is kept loaded, and so are
+        //   its neighbors (which all get TICKET_BORDER)
+        TICKET_FULL = 3
+
+    };
+
+    // the number of ticket levels
+    #define TICKET_NUM_LEVELS 4
+
+    // ChunkTickets - the tickets held on a single chunk
+    struct ChunkTickets {
+
+        // the number of tickets held at each level
+        int counts[TICKET_NUM_LEVELS];
+
+        ChunkTickets() {
+            for (int i = 0; i < TICKET_NUM_LEVELS; ++i) counts[i] = 0;
+        }
+
+        // return the level of the chunk, i.e. the highest level with any tickets
+        TicketLevel getLevel() const {
+            for (int i = TICKET_NUM_LEVELS - 1; i > TICKET_NONE; --i) {
+                if (counts[i] > 0) return (TicketLevel)i;
+            }
+            return TICKET_NONE;
+        }
+
+    };
+
+    // ChunkRequestQueue - a queue of chunk requests, which gives out the most important ones first
+    // Requests are prioritized by their distance to the viewer, and whether they are in the viewer's
+    //   field of view (chunks behind the viewer are needed later, if at all)
+    // The priorities are all recalculated at once (in `setViewer()`) whenever the viewer moves to
+    //   another chunk or turns, which is also when requests that are now out of range are cancelled
+    // NOTE: this class is not thread-safe; the server guards it with `L_chunks`
+    class ChunkRequestQueue {
+        public:
+
+        // information about the viewer, which is what requests are prioritized against
+        struct {
+
+            // position in world space
+            vec3 pos;
+
+            // the direction being looked in
+            vec3 forward;
+
+            // half of the horizontal field of view, in radians
+            float halfFOV;
+
+            // the view distance, in chunks. Any requests farther than this (plus a small margin) are
+            //   cancelled. If 0, nothing is ever cancelled
+            int dist;
+
+        } viewer;
+
+        ChunkRequestQueue() {
+            viewer.pos = vec3(0);
+            viewer.forward = vec3(0, 0, 1);
+            viewer.halfFOV = M_PI;
+            viewer.dist = 0;
+            lastViewerID = ChunkID(0, 0);
+            lastForward = vec3(0, 0, 1);
+        }
+
+        // return the number of requests
+        int size() const {
+            return heap.size();
+        }
+
+        // return whether 'id' has been requested (and not yet given out)
+        bool contains(ChunkID id) const {
+            return ids.find(id) != ids.end();
+        }
+
+        // add a request for 'id' (which should not already be in the queue)
+        void push(ChunkID id) {
+            heap.push_back(Entry(getPriority(id), id));
+            std::push_heap(heap.begin(), heap.end());
+            ids.insert(id);
+        }
+
+        // remove the most important request, and return it
+        // NOTE: there must be at least 1 request
+        ChunkID pop() {
+            std::pop_heap(heap.begin(), heap.end());
+            ChunkID id = heap.back().id;
+            heap.pop_back();
+            ids.erase(id);
+            return id;
+        }
+
+        // update the viewer, and if it has moved to another chunk or turned significantly, recalculate
+        //   the priority of every request, and cancel any that are now out of range (unless they have
+        //   tickets in 'tickets')
+        // Returns the number of requests cancelled
+        int setViewer(vec3 pos, vec3 forward, float halfFOV, int dist, const HashMap<ChunkID, ChunkTickets>* tickets=NULL) {
+            viewer.pos = pos;
+            viewer.forward = forward;
+            viewer.halfFOV = halfFOV;
+            viewer.dist = dist;
+
+            // only re-prioritize when it would make a difference
+            ChunkID viewerID = ChunkID::fromPos(vec3i(glm::floor(pos)));
+            if (viewerID == lastViewerID && glm::dot(forward, lastForward) > 0.996f) return 0;
+            lastViewerID = viewerID;
+            lastForward = forward;
+
+            // re-prioritize everything, removing requests that are out of range
+            int ct = 0;
+            for (size_t i = 0; i < heap.size(); ++i) {
+                if (isInRange(heap[i].id) || (tickets != NULL && tickets->count(heap[i].id) > 0)) {
+                    heap[i].priority = getPriority(heap[i].id);
+                    heap[ct++] = heap[i];
+                } else {
+                    ids.erase(heap[i].id);
+                }
+            }
+            int numCancelled = heap.size() - ct;
+            heap.resize(ct);
+
+            // and rebuild the heap all at once (O(N))
+            std::make_heap(heap.begin(), heap.end());
+            return numCancelled;
+        }
+
+        // return whether 'id' is within the viewer's range (i.e. whether it is still worth generating)
+        bool isInRange(ChunkID id) const {
+            if (viewer.dist <= 0) return true;
+            float maxDist = viewer.dist + 2.0f;
+            return getDist(id) <= maxDist;
+        }
+
+        // return the priority of a request for 'id' (lower values are more important)
+        float getPriority(ChunkID id) const {
+            float dist = getDist(id);
+
+            // chunks right next to the viewer are always needed, even if they are behind, since
+            //   the viewer may turn around at any time
+            if (dist < 2.0f) return dist;
+
+            // project everything onto the XZ plane, since chunks are columns
+            vec2 fwd = vec2(viewer.forward.x, viewer.forward.z);
+
+            // looking (nearly) straight up or down, so every direction is in view
+            if (glm::length(fwd) < 0.2f) return dist;
+            fwd = glm::normalize(fwd);
+
+            // the direction to the center of the chunk, in chunks
+            vec2 dir = vec2((id.X + 0.5f) * CHUNK_SIZE_X - viewer.pos.x, (id.Z + 0.5f) * CHUNK_SIZE_Z - viewer.pos.z) / (float)CHUNK_SIZE_X;
+
+            // widen the view cone by the angle the chunk itself takes up (with a radius of sqrt(2)/2),
+            //   so that chunks partially in view count as being in view
+            float angle = acosf(glm::clamp(glm::dot(dir, fwd) / dist, -1.0f, 1.0f));
+            if (angle <= viewer.halfFOV + asinf(glm::min(1.0f, 0.71f / dist))) return dist;
+
+            // outside of the view, so it is much less important
+            return 2.0f * dist + 2.0f;
+        }
+
+        private:
+
+        // Entry - a single request in the heap
+        struct Entry {
+            float priority;
+            ChunkID id;
+
+            Entry(float priority=0.0f, ChunkID id=ChunkID()) {
+                this->priority = priority;
+                this->id = id;
+            }
+
+            // reversed, so that the heap has the lowest priority value on top
+            bool operator<(const Entry& other) const {
+                return priority > other.priority;
+            }
+        };
+
+        // the binary heap of requests
+        List<Entry> heap;
+
+        // the set of IDs that are in the heap, to quickly check for duplicates
+        HashSet<ChunkID> ids;
+
+        // the state of the viewer the last time priorities were calculated
+        ChunkID lastViewerID;
+        vec3 lastForward;
+
+        // return the distance from the viewer to the center of the chunk 'id', in chunks
+        float getDist(ChunkID id) const {
+            vec2 dir = vec2((id.X + 0.5f) * CHUNK_SIZE_X - viewer.pos.x, (id.Z + 0.5f) * CHUNK_SIZE_Z - viewer.pos.z) / (float)CHUNK_SIZE_X;
+            return glm::length(dir);
+        }
+
+    };
+
+    // ChunkEvent - a notification about a chunk, that is sent to subscriptions (see `Server::subscribe()`)
+    struct ChunkEvent {
+
+        // the kinds of events
+        enum Kind {
+
+            // the chunk is loaded, and in view (either it was just loaded, or it just came into view)
+            EVENT_READY = 0,
+
+            // the chunk's blocks were changed (through `Server::setBlock()`)
+            EVENT_CHANGED = 1,
+
+            // the chunk is no longer in view, so the server may unload it at any point after this
+            //   frame, and 'chunk' must no longer be used
+            EVENT_LEFT_VIEW = 2
+
+        };
+
+        // what happened
+        Kind kind;
+
+        // the chunk it happened to
+        ChunkID id;
+        Chunk* chunk;
+
+        ChunkEvent(Kind kind=EVENT_READY, ChunkID id=ChunkID(), Chunk* chunk=NULL) {
+            this->kind = kind;
+            this->id = id;
+            this->chunk = chunk;
+        }
+
+    };
+
+    // Subscription - a disc of chunks that a client wants to be kept up to date about
+    // Instead of asking for every chunk in view every frame, clients subscribe to their view, and
+    //   the server pushes events as chunks in it are loaded, changed, or leave it. So, the per-frame
+    //   cost only depends on what changed
+    // Every chunk in view holds a TICKET_FULL ticket (see `TicketLevel`), so they are never unloaded. Requests
+    //   are only sent once, so the radius should be within the viewer's distance (see `Server::setViewer()`),
+    //   otherwise requests at the edge may be cancelled
+    struct Subscription {
+
+        // the center of the view, and its radius (in chunks). Chunks within 'radius' of 'center' are
+        //   in view (i.e. the same disc the client renders)
+        // NOTE: guarded by `Server::L_chunks`, use `Server::moveSubscription()` to change them
+        ChunkID center;
+        int radius;
+
+        // events about chunks in view, which the subscriber takes out (with `events.pop()`) without
+        //   ever waiting on the server
+        MPSCQueue<ChunkEvent> events;
+
+        // return whether the chunk 'id' is in view
+        bool contains(ChunkID id) const {
+            return isInView(center, radius, id);
+        }
+
+        // return whether the chunk 'id' is in a view of 'radius' around 'center'
+        static bool isInView(ChunkID center, int radius, ChunkID id) {
+            int dX = id.X - center.X, dZ = id.Z - center.Z;
+            return radius >= 0 && dX * dX + dZ * dZ <= radius * radius;
+        }
+
+    };
+
     // Server - an abstract class describing the server/game engine protocol,
     //   for management & gameplay
     // Most requests are performed async, but without handles, so that they put in a 'request',
@@ -43,26 +340,112 @@ namespace Blok {
         public:
 
         // this mutex controls access to all chunk request variables.
-        // But, use the `getChunk()` method to perform locking
+        // But, use the `getChunk()` method to perform locking, or `lockChunks()`/`unlockChunks()` so that
+        //   the time it is held shows up in `lockStats`
         std::mutex L_chunks;
 
-        // a set (i.e. no duplicates) of active chunk requests
+        // statistics about `L_chunks`, which are only written while holding it
+        struct {
+
+            // the number of times it was locked
+            std::atomic<int> n_locks;
+
+            // the total time spent waiting to lock it
+            std::atomic<double> t_wait;
+
+            // the total (and longest) time it was held
+            std::atomic<double> t_held, t_maxHeld;
+
+        } lockStats;
+
+        // signalled (with `L_chunks`) whenever a new chunk request is added, so that background
+        //   threads can sleep while there is nothing to do, rather than polling
+        std::condition_variable CV_chunks;
+
+        // the queue (with no duplicates) of active chunk requests, with the most important first
         // NOTE: do not modify this variable directly; either use `getChunk()`, or lock `L_chunks` for
         //   a critical section
-        Set<ChunkID> chunkRequests;
+        ChunkRequestQueue chunkRequests;
 
         // the set of currently being worked on in a background thread
         // NOTE: do not modify this variable directly; either use `getChunk()`, or lock `L_chunks` for
         //   a critical section
-        Set<ChunkID> chunkRequestsInProgress;
+        HashSet<ChunkID> chunkRequestsInProgress;
 
         // set of all chunks that are currently loaded by the server
-        // NOTE: do not modify this variable directly; either use `getChunk()`, or lock `L_chunks` for
-        //   a critical section
-        Map<ChunkID, Chunk*> loadedChunks;
+        // Lookups (`loadedChunks.find()`) never lock, but everything else (modifying or iterating it)
+        //   must be done while holding `L_chunks`
+        ChunkTable loadedChunks;
 
         // A map between the unique id's and the entity
-        Map<UUID, Entity*> loadedEntities;
+        HashMap<UUID, Entity*> loadedEntities;
+
+        // the current tick of the server, which is used to track when chunks were last requested
+        // NOTE: only advanced while holding `L_chunks`
+        std::atomic<uint64_t> tick;
+
+        Server() {
+            tick = 0;
+            numNewRequests = 0;
+
+            lockStats.n_locks = 0;
+            lockStats.t_wait = 0.0;
+            lockStats.t_held = 0.0;
+            lockStats.t_maxHeld = 0.0;
+        }
+
+        // servers are deleted through 'Server*', so the subclass destructor must be called
+        virtual ~Server() {
+            // do nothing by default
+        }
+
+        // lock `L_chunks`, keeping track of how long it takes
+        void lockChunks() {
+            double st = getTime();
+            L_chunks.lock();
+            beginHold();
+            lockStats.t_wait.store(lockStats.t_wait.load(std::memory_order_relaxed) + (holdStart - st), std::memory_order_relaxed);
+        }
+
+        // unlock `L_chunks`, keeping track of how long it was held
+        // If any requests were added while it was held, the workers are woken up now (rather than as
+        //   they were added), so they don't wake up just to wait on the lock
+        void unlockChunks() {
+            int num = numNewRequests;
+            numNewRequests = 0;
+            endHold();
+            L_chunks.unlock();
+
+            if (num == 1) {
+                CV_chunks.notify_one();
+            } else if (num > 1) {
+                CV_chunks.notify_all();
+            }
+        }
+
+        // start timing a hold of `L_chunks`, which must have just been locked (i.e. for code that locks
+        //   it through a `std::unique_lock`)
+        void beginHold() {
+            holdStart = getTime();
+        }
+
+        // finish timing a hold of `L_chunks`, which is about to be unlocked
+        void endHold() {
+            double held = getTime() - holdStart;
+
+            // we hold the lock, so there's no need for atomic adds
+            lockStats.n_locks.store(lockStats.n_locks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            lockStats.t_held.store(lockStats.t_held.load(std::memory_order_relaxed) + held, std::memory_order_relaxed);
+            if (held > lockStats.t_maxHeld.load(std::memory_order_relaxed)) lockStats.t_maxHeld.store(held, std::memory_order_relaxed);
+        }
+
+        // return whether there are any chunk requests that haven't been finished yet
+        bool hasPendingRequests() {
+            lockChunks();
+            bool ret = chunkRequests.size() > 0 || chunkRequestsInProgress.size() > 0;
+            unlockChunks();
+            return ret;
+        }
 
         // If the chunk is currently loaded, just return a pointer to that chunk, which can be modified (see Blok.hh)
         // If it is not loaded, the behaviour depends on the 'request' parameter
@@ -73,41 +456,158 @@ namespace Blok {
         //
         // NOTE: The caller should never delete a returned chunk; the server does its own memory management,
         //   and will free the chunk once the server object is deleted
+        // NOTE: If the chunk is loaded, this never locks (or waits on the workers)
         virtual Chunk* getChunk(ChunkID id, bool request=true) {
-            // enter critical section, we are accessing variables
-            L_chunks.lock();
-
-            auto seq = loadedChunks.find(id);
-            // by default, we didn't find it
-            Chunk* ret = NULL;
-            if (seq == loadedChunks.end()) {
-                // not found
-                if (request) {
-                    // add to the requests
-                    // make sure it is not currently being requested
-                    if (chunkRequests.find(id) == chunkRequests.end() && chunkRequestsInProgress.find(id) == chunkRequestsInProgress.end()) {
-                        chunkRequests.insert(id);
-                    }
-                }
-            } else {
-                // found, so just return it
-                ret = seq->second;
+            Chunk* ret = loadedChunks.find(id);
+            if (ret != NULL) {
+                // remember that it is still in use
+                ret->lastAccess.store(tick.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            } else if (request) {
+                requestChunk(id);
             }
+            return ret;
+        }
+
+        // request that the chunk 'id' be loaded (the slow path of `getChunk()`), if it isn't
+        //   already loaded or requested
+        void requestChunk(ChunkID id) {
+            // enter critical section, we are accessing variables
+            lockChunks();
+            requestChunkLocked(id);
 
             // end critical section
-            L_chunks.unlock();
+            unlockChunks();
+        }
+
+        // add a ticket of 'level' on the chunk 'id', which (if it is not loaded) requests it
+        // Tickets are counted, so each one must be removed (with the same level) exactly once
+        // A TICKET_FULL ticket also adds TICKET_BORDER tickets to the 8 chunks around it
+        virtual void addTicket(ChunkID id, TicketLevel level);
+
+        // remove a ticket given by `addTicket()`. Once a chunk has no tickets at or above TICKET_BORDER,
+        //   it may be unloaded (see `LocalServer::evictChunks()`)
+        virtual void removeTicket(ChunkID id, TicketLevel level);
+
+        // return the level of the chunk 'id' (see `TicketLevel`)
+        TicketLevel getTicketLevel(ChunkID id) {
+            lockChunks();
+            TicketLevel ret = getTicketLevelLocked(id);
+            unlockChunks();
             return ret;
         }
 
+        // subscribe to the disc of chunks within 'radius' of 'center', returning the subscription
+        // All chunks in view get a TICKET_FULL ticket (which requests them), and an EVENT_READY is
+        //   sent for each of them as soon as it is loaded (right away, for those that already are)
+        // The subscription must be given back to `unsubscribe()` once it is no longer needed
+        virtual Subscription* subscribe(ChunkID center, int radius);
+
+        // move the view of 'sub', sending EVENT_READY for loaded chunks that came into view (and
+        //   requesting the rest), and EVENT_LEFT_VIEW for loaded chunks that left it. Tickets are moved
+        //   along with it
+        // This only does anything if the view actually changed, so it can be called every frame
+        virtual void moveSubscription(Subscription* sub, ChunkID center, int radius);
+
+        // stop sending events to 'sub' (and release its tickets), and delete it
+        virtual void unsubscribe(Subscription* sub);
+
+        // set the block at 'pos' (in world space) to 'data', sending EVENT_CHANGED to subscriptions that
+        //   can see it. Returns false if the chunk is not loaded (in which case nothing is changed)
+        virtual bool setBlock(vec3i pos, BlockData data);
+
+        // set the viewer that chunk requests are prioritized for (see `ChunkRequestQueue`), i.e. the
+        //   position and direction of the camera, half of its horizontal field of view (in radians), and
+        //   the view distance (in chunks)
+        // This should be called every frame, before requesting chunks. Requests that have fallen out of
+        //   range are cancelled
+        virtual void setViewer(vec3 pos, vec3 forward, float halfFOV, int dist) {
+            lockChunks();
+            chunkRequests.setViewer(pos, forward, halfFOV, dist, &tickets);
+            unlockChunks();
+        }
+
         // attempt to cast a ray (in world space), up to 'dist', returning whether or not it hit something
         // In the case that it did hit something, also set `hitInfo` to the relevant data about the collision
         // See `Blok.hh`, specifically around `struct RayHit` for more information
         virtual bool raycastBlock(Ray ray, float dist, RayHit& hitInfo) = 0;
 
+        // add an entity to the world, which holds a TICKET_FULL ticket on the chunk it is in
         void addEntity(Entity* ent) {
+            vec3 pos = ent->getPos();
+            ChunkID id = ChunkID::fromPos(vec3i(glm::floor(pos)));
             loadedEntities[ent->uuid] = ent;
+            entityChunks[ent->uuid] = id;
+            addTicket(id, TICKET_FULL);
+        }
+
+        // move an entity, moving its ticket along with it if it crossed into another chunk
+        void moveEntity(Entity* ent, vec3 pos) {
+            ent->setPos(pos);
+            ChunkID id = ChunkID::fromPos(vec3i(glm::floor(pos)));
+            ChunkID& cur = entityChunks[ent->uuid];
+            if (id != cur) {
+                addTicket(id, TICKET_FULL);
+                removeTicket(cur, TICKET_FULL);
+                cur = id;
+            }
+        }
+
+        // remove an entity from the world (which does not delete it), releasing its ticket
+        void removeEntity(Entity* ent) {
+            auto it = entityChunks.find(ent->uuid);
+            if (it == entityChunks.end()) return;
+            removeTicket(it->second, TICKET_FULL);
+            entityChunks.erase(it);
+            loadedEntities.erase(ent->uuid);
+        }
+
+        protected:
+
+        // all the current subscriptions (guarded by `L_chunks`)
+        List<Subscription*> subscriptions;
+
+        // the tickets on each chunk, for chunks that have any (guarded by `L_chunks`)
+        HashMap<ChunkID, ChunkTickets> tickets;
+
+        // the chunk that each entity holds its ticket on
+        HashMap<UUID, ChunkID> entityChunks;
+
+        // add (or remove, if 'delta' is -1) a ticket (and the tickets it implies), with `L_chunks` held
+        void changeTicketLocked(ChunkID id, TicketLevel level, int delta);
+
+        // add (or remove) a single ticket, with `L_chunks` held
+        void changeTicketCount(ChunkID id, TicketLevel level, int delta);
+
+        // return the level of the chunk 'id', with `L_chunks` held
+        TicketLevel getTicketLevelLocked(ChunkID id) const {
+            auto it = tickets.find(id);
+            return it == tickets.end() ? TICKET_NONE : it->second.getLevel();
+        }
+
+        // request the chunk 'id', with `L_chunks` held (and which must be unlocked through `unlockChunks()`)
+        void requestChunkLocked(ChunkID id) {
+            // it may have been loaded since we last looked, so check again while nothing can change
+            if (loadedChunks.find(id) == NULL && !chunkRequests.contains(id) && chunkRequestsInProgress.find(id) == chunkRequestsInProgress.end()) {
+                chunkRequests.push(id);
+                numNewRequests++;
+            }
         }
 
+        // send an event about the chunk 'id' to every subscription that can see it, with `L_chunks` held
+        void notifySubscriptions(ChunkEvent::Kind kind, ChunkID id, Chunk* chunk) {
+            for (Subscription* sub : subscriptions) {
+                if (sub->contains(id)) sub->events.push(ChunkEvent(kind, id, chunk));
+            }
+        }
+
+        private:
+
+        // the time `L_chunks` was last locked (guarded by `L_chunks`)
+        double holdStart;
+
+        // the number of requests added since `L_chunks` was locked (guarded by `L_chunks`)
+        int numNewRequests;
+
     };
 
     // LocalServer - a server implementation that operates locally (i.e. on the current machine,
@@ -121,44 +621,176 @@ namespace Blok {
         // a structure describing statistics of performance
         struct {
 
-            // the number of chunks generated
+            // the number of chunks generated (or loaded)
             int n_chunks;
 
-            // the total time spent generating chunks
+            // the number of those chunks that were loaded from `store`
+            int n_loaded;
+
+            // the total time spent generating chunks (summed across all workers)
             double t_chunks;
 
         } stats;
 
+        // Worker - a background thread that generates chunks
+        // Each worker has its own queue of chunk requests. When it runs out, it takes a batch from the
+        //   global requests (`chunkRequests`), and if those are empty too, it steals half of another
+        //   worker's queue. Only once there is no work anywhere does it sleep (on `CV_chunks`)
+        struct Worker {
+
+            // the index of the worker, within `workers`
+            int idx;
+
+            // the thread running `T_worker_run()`
+            std::thread thread;
+
+            // the lock controlling access to `queue`
+            std::mutex L_queue;
+
+            // the chunk requests claimed by this worker (and moved to `chunkRequestsInProgress`), but
+            //   not yet started. The worker takes from the back, and thieves take from the front
+            std::deque<ChunkID> queue;
+
+            // statistics for this worker, which are only ever written by the worker itself
+            struct {
+
+                // the number of chunks generated (or loaded)
+                std::atomic<int> n_chunks;
+
+                // the number of those chunks that were loaded from `store`
+                std::atomic<int> n_loaded;
+
+                // the total time spent generating chunks
+                std::atomic<double> t_chunks;
+
+            } stats;
+
+        };
+
+        // the limits on loaded chunks, beyond which `evictChunks()` unloads the least recently used
+        //   ones. A limit of 0 means no limit
+        struct {
+
+            // the maximum number of chunks loaded
+            int maxChunks;
+
+            // the maximum number of bytes used by loaded chunks (see `Chunk::getMemoryUsage()`), and the
+            //   chunks staged by the generator (see `WG::Pipeline`), which are freed first
+            size_t maxBytes;
+
+        } budget;
+
         // the world generator that is currently being used to generate chunks
+        // NOTE: `getChunk()` is called by all workers at once, so it must be thread-safe
         WG::WG* worldGen;
 
-        // thread to run the chunk loading
-        std::thread T_chunkLoad;
+        // the region files that chunks are saved to and loaded from, or NULL if the world is not saved
+        // Workers check here before generating a chunk
+        Save::RegionStore* store;
+
+        // the pool of worker threads that generate chunks
+        List<Worker*> workers;
 
-        // construct a new local server.
+        // the table that identical sections of generated (and loaded) chunks are shared through, or
+        //   NULL if sections aren't shared (see `SectionTable`)
+        SectionTable* sectionTable;
+
+        // construct a new local server, with 'numWorkers' background threads to generate chunks
+        //   (or, if 'numWorkers<=0', one for every core but the main thread's)
+        // If 'worldDir' is given, chunks are saved in (and loaded from) that directory (in the given
+        //   'saveMode'), otherwise nothing is saved
+        // If 'shareSections' is true, identical sections are shared between chunks (see `SectionTable`)
         // For now, just create a default world generator
-        LocalServer() {
+        LocalServer(int numWorkers=0, const String& worldDir="", Save::RegionStore::Mode saveMode=Save::RegionStore::MODE_FULL, bool shareSections=false) {
             worldGen = new WG::DefaultWG(0);
             //worldGen = new WG::FlatWG(0);
 
-            // start the thread to load chunks & handle requests
-            T_chunkLoad = std::thread(&LocalServer::T_chunkLoad_run, this);
+            store = worldDir.size() > 0 ? new Save::RegionStore(worldDir, saveMode, worldGen) : NULL;
+            sectionTable = shareSections ? new SectionTable() : NULL;
 
             // initialize statistics to nothing
             stats.n_chunks = 0;
+            stats.n_loaded = 0;
             stats.t_chunks = 0.0;
+
+            isStopping = false;
+            numQueued = 0;
+
+            // by default, keep plenty more than the view distance needs
+            budget.maxChunks = 4096;
+            budget.maxBytes = 256 * 1024 * 1024;
+
+            if (numWorkers <= 0) numWorkers = (int)std::thread::hardware_concurrency() - 1;
+            if (numWorkers < 1) numWorkers = 1;
+
+            // create all the workers before starting any of them, since they look at each other
+            for (int i = 0; i < numWorkers; ++i) {
+                Worker* w = new Worker();
+                w->idx = i;
+                w->stats.n_chunks = 0;
+                w->stats.n_loaded = 0;
+                w->stats.t_chunks = 0.0;
+                workers.push_back(w);
+            }
+
+            // start the threads to load chunks & handle requests
+            for (Worker* w : workers) {
+                w->thread = std::thread(&LocalServer::T_worker_run, this, w);
+            }
         }
 
         // destroy server & its resources
         ~LocalServer() {
-            // remove our generator
-            delete worldGen;
+            // tell the workers to stop, and wait for them to finish their current chunk
+            lockChunks();
+            isStopping = true;
+            unlockChunks();
+            CV_chunks.notify_all();
+
+            for (Worker* w : workers) {
+                w->thread.join();
+                delete w;
+            }
 
-            // delete all loaded chunks
-            for (auto& entry : loadedChunks) {
-                delete entry.second;
+            // save and delete all loaded chunks
+            for (Chunk* chunk : loadedChunks) {
+                saveChunk(chunk);
+                delete chunk;
             }
 
+            if (store != NULL) delete store;
+            if (sectionTable != NULL) delete sectionTable;
+
+            // remove our generator (which the store may have needed)
+            delete worldGen;
+
+        }
+
+        // advance the server tick, and if the loaded chunks are over `budget`, unload the least recently
+        //   used chunks until they are within it. Returns the number of chunks unloaded
+        // Chunks with tickets at or above TICKET_BORDER, and chunks that were requested during the last
+        //   tick, are never unloaded. Chunks with no tickets go before TICKET_PRELOAD ones (see `TicketLevel`)
+        // Chunks are saved to `store` before they are unloaded, and if there is no store (or saving
+        //   fails), modified chunks (see `Chunk::isModified()`) are kept, so that edits are never lost
+        // Saving is done without holding `L_chunks`, so the workers can keep going in the meantime
+        // NOTE: this must be called from the main thread, between frames (i.e. when nothing is holding
+        //   on to chunk pointers)
+        int evictChunks();
+
+        // save 'chunk' to `store`, if it isn't already up to date there, returning whether it is safe
+        //   to unload (i.e. whether it has no edits that would be lost)
+        bool saveChunk(Chunk* chunk);
+
+        // update `stats` from the statistics of all the workers
+        void updateStats() {
+            stats.n_chunks = 0;
+            stats.n_loaded = 0;
+            stats.t_chunks = 0.0;
+            for (Worker* w : workers) {
+                stats.n_chunks += w->stats.n_chunks.load(std::memory_order_relaxed);
+                stats.n_loaded += w->stats.n_loaded.load(std::memory_order_relaxed);
+                stats.t_chunks += w->stats.t_chunks.load(std::memory_order_relaxed);
+            }
         }
 
         // raycast() should seek through all possible chunks, checking intersection along 'ray',
@@ -167,11 +799,35 @@ namespace Blok {
         bool raycastBlock(Ray ray, float dist, RayHit& hitInfo);
 
         private:
+
+        // whether the server is being destroyed, and the workers should exit (guarded by `L_chunks`)
+        bool isStopping;
+
+        // the total number of requests sitting in worker queues, so that idle workers know whether
+        //   there is anything to steal. It is only ever increased while holding `L_chunks`
+        std::atomic<int> numQueued;
+
+        // the chunks that `evictChunks()` has taken out of `loadedChunks`, but is still saving (which
+        //   it does without holding `L_chunks`). Workers wait for these before loading them from `store`
+        //   again (guarded by `L_chunks`)
+        HashSet<ChunkID> chunksSaving;
+
+        // signalled (with `L_chunks`) whenever `chunksSaving` is emptied
+        std::condition_variable CV_saved;
+
         /* internal methods */
 
-        // this is the target that should be ran all the time, by the T_chunkLoad thread,
-        //   which attempts to service the chunk loader
-        void T_chunkLoad_run();
+        // this is the target that is ran by each worker thread, which generates chunks
+        //   until the server is destroyed
+        void T_worker_run(Worker* w);
+
+        // get the next chunk request for worker 'w' to generate, setting 'id', sleeping if there
+        //   are none. Returns false if the server is stopping
+        bool nextRequest(Worker* w, ChunkID& id);
+
+        // try and steal requests from another worker's queue, keeping one in 'id' and putting the
+        //   rest in 'w's queue. Returns whether anything was stolen
+        bool stealRequests(Worker* w, ChunkID& id);
 
     };
 
@@ -8,6 +8,12 @@
  * World Generators can have internal state (i.e. caching, list of worms for cave generation, 
  *   tree generation, etc)
  * 
+ * Anything that crosses chunk borders (i.e. boulders, or trees) can't be made by a chunk in isolation, so
+ *   generators can instead be split into stages (i.e. terrain, carving, decorating), where each stage can
+ *   look at the chunks around it, as they were after the previous stage. The `Pipeline` runs chunks
+ *   through the stages, and keeps partially generated chunks around, so that each stage of each chunk
+ *   is only run once, no matter how many neighbors need it
+ * 
  */
 
 #pragma once
@@ -21,17 +27,193 @@
 // generators use the randomness library
 #include <Blok/Random.hh>
 
+// and biomes
+#include <Blok/Biome.hh>
+
+// for the staging area
+#include <Blok/HashMap.hh>
+
+#include <mutex>
+#include <condition_variable>
+
 namespace Blok::WG {
 
+    // forward declaration
+    class WG;
+
+    // ChunkArea - read-only access to a square of chunks around a center chunk, which is what a stage
+    //   of generation sees (see `WG::runStage()`)
+    struct ChunkArea {
+
+        // the chunk in the middle
+        ChunkID center;
+
+        // how many chunks the area reaches out in each direction
+        int radius;
+
+        // the chunks, in X-major order, starting at 'center - (radius, radius)'
+        List<const Chunk*> chunks;
+
+        // return the chunk at 'id', or NULL if it is outside of the area
+        const Chunk* getChunk(ChunkID id) const {
+            int X = id.X - center.X + radius, Z = id.Z - center.Z + radius, W = 2 * radius + 1;
+            if (X < 0 || X >= W || Z < 0 || Z >= W) return NULL;
+            return chunks[X * W + Z];
+        }
+
+        // return the block at 'x, y, z', in local coordinates of the center chunk, which may reach into
+        //   its neighbors (i.e. x=-1 is in the chunk to the left). Anything outside of the area is air
+        BlockData get(int x, int y, int z) const {
+            if (y < 0 || y >= CHUNK_SIZE_Y) return BlockData(ID::AIR);
+            int X = x >= 0 ? x / CHUNK_SIZE_X : (x + 1) / CHUNK_SIZE_X - 1;
+            int Z = z >= 0 ? z / CHUNK_SIZE_Z : (z + 1) / CHUNK_SIZE_Z - 1;
+            const Chunk* chunk = getChunk(center + ChunkID(X, Z));
+            if (chunk == NULL) return BlockData(ID::AIR);
+            return chunk->get(x - X * CHUNK_SIZE_X, y, z - Z * CHUNK_SIZE_Z);
+        }
+
+    };
+
+    // Pipeline - runs chunks through the stages of a generator
+    // Chunks that have been through some of the stages (because a neighbor needed them) are kept in a
+    //   staging area, keyed by their ID and stage. These are never modified after they are made, and
+    //   later stages start from a clone of them (which shares their storage, see `Chunk::clone()`), so
+    //   each stage of each chunk is run once, and what a stage sees never depends on the order that
+    //   chunks were requested in
+    // Stages with a radius of 0 don't need to look at their neighbors, so they are run straight after
+    //   the stage before them, without going through the staging area
+    // All methods are thread-safe. Different threads generating nearby chunks share the work: a thread
+    //   that needs a staged chunk that another thread is making waits for it, instead of making its own
+    // The staging area counts towards the server's memory budget (see `LocalServer::budget`)
+    class Pipeline {
+        public:
+
+        // Stats - statistics about what the pipeline has done
+        struct Stats {
+
+            // the number of times each stage has been run, and the total time spent in it (in seconds)
+            List<int> n_runs;
+            List<double> t_runs;
+
+            // the number of times a thread had to wait for another to finish a staged chunk
+            int n_waits;
+
+            // the number of staged chunks that were freed to stay within 'maxStaged'
+            int n_evicted;
+
+        };
+
+        // construct a pipeline for the stages of 'wg', keeping at most (about) 'maxStaged' chunks in the
+        //   staging area
+        Pipeline(WG* wg, int maxStaged=1024);
+
+        // free everything in the staging area
+        ~Pipeline();
+
+        // the staging area holds chunks, so it should not be copied
+        Pipeline(const Pipeline& other) = delete;
+        Pipeline& operator=(const Pipeline& other) = delete;
+
+        // generate a finished chunk (i.e. through every stage), which the caller owns
+        Chunk* getChunk(ChunkID id);
+
+        // return the number of chunks in the staging area
+        int size();
+
+        // return the number of bytes used by the chunks in the staging area (see `Chunk::getMemoryUsage()`,
+        //   as of when they were staged)
+        size_t getMemoryUsage();
+
+        // free every chunk in the staging area that isn't in use
+        void clear();
+
+        // return a copy of the statistics
+        Stats getStats();
+
+        private:
+
+        // Staged - a chunk in the staging area, which has been through the stages up to some stage
+        struct Staged {
+
+            // the chunk, or NULL while it is still being made
+            Chunk* chunk;
+
+            // the memory used by 'chunk', when it was staged (which is what 'stagedBytes' counts)
+            size_t bytes;
+
+            // the number of stages currently reading it (which includes whoever is making it)
+            int users;
+
+            // the value of 'tick' when it was last used, to free the least recently used first
+            uint64_t lastUse;
+
+        };
+
+        // the generator whose stages are run
+        WG* wg;
+
+        // the soft limit on the number of staged chunks
+        int maxStaged;
+
+        // the staged chunks, by their ID and the last stage they have been through
+        HashMap< Pair<ChunkID, int>, Staged* > staged;
+
+        // the total 'bytes' of everything in 'staged'
+        size_t stagedBytes;
+
+        // counts up on each use of a staged chunk
+        uint64_t tick;
+
+        Stats stats;
+
+        // held while using 'staged' (or 'stats'), and signalled whenever a staged chunk is finished
+        std::mutex L_staged;
+        std::condition_variable CV_staged;
+
+        // return chunk 'id' as it was after stage 'stage', making it (or waiting for it) if it isn't
+        //   staged, and marking it as in use until `release()`
+        const Chunk* acquire(ChunkID id, int stage);
+
+        // stop using a chunk returned from `acquire()`
+        void release(ChunkID id, int stage);
+
+        // make a new chunk 'id', which has been through the stages up to 'stage'
+        Chunk* build(ChunkID id, int stage);
+
+        // free the least recently used staged chunks, if there are too many
+        // NOTE: 'L_staged' must be held
+        void trim();
+
+    };
+
     // WG - abstract class describing a world WorldGenerator
     class WG {
         public:
 
+        // Stage - a single step of generating a chunk (i.e. terrain, carving caves, or decorating)
+        struct Stage {
+
+            // the name of the stage, for statistics
+            String name;
+
+            // how many chunks out (in each direction) the stage needs to look at, which must have been
+            //   through the stage before this one first. The first stage must have a radius of 0
+            int radius;
+
+        };
+
         // the seed for the world generator
         uint32_t seed;
 
+        // the stages that chunks are generated in, in order. Generators that override `getChunk()` (i.e.
+        //   ones that never need their neighbors) can leave this empty
+        List<Stage> stages;
+
+        // runs chunks through 'stages' for the default `getChunk()`
+        Pipeline pipeline;
+
         // construct a world generator from the seed
-        WG(uint32_t seed=0) {
+        WG(uint32_t seed=0) : pipeline(this) {
             this->seed = seed;
         }
         
@@ -41,27 +223,73 @@ namespace Blok::WG {
 
         // method to generate a single chunk, given the ChunkID macro coordinates
         // the position of the given chunk is CHUNK_SIZE * cx, 0 through CHUNK_HEIGHT, CHUNK_SIZE * cz
-        virtual Chunk* getChunk(ChunkID id) = 0;
+        // By default, this runs the chunk through 'stages'
+        virtual Chunk* getChunk(ChunkID id) {
+            return pipeline.getChunk(id);
+        }
+
+        // return a fingerprint of the generator (i.e. which generator it is, its version, seed, and
+        //   settings), which must change whenever the chunks it generates would
+        // Delta saves are only applied to chunks from a generator with the same fingerprint as the one
+        //   they were saved against (see `Save.hh`)
+        virtual uint64_t getFingerprint() = 0;
+
+        // run stage 'idx' on 'chunk', which has already been through the stages before it
+        // 'area' holds the chunks within the stage's radius (including 'chunk' itself) as they were after
+        //   the previous stage, which never change, so stages can read them from any thread. For stages
+        //   with a radius of 0, the area is just 'chunk'
+        // Only 'chunk' may be modified
+        virtual void runStage(int /*idx*/, Chunk* /*chunk*/, const ChunkArea& /*area*/) {
+            // nothing by default, for generators that override `getChunk()` instead
+        }
 
     };
 
 
     // DefaultWG - the default world generator used by Blok.
+    // Chunks are generated in stages: the terrain, then caves are carved out of it, and then it is
+    //   decorated with boulders (which may cross into neighboring chunks)
+    // The height of the land, and how hilly and grassy it is, come from the biome map (see `BiomeMap`),
+    //   and the hills and ridges on top of that from 'pmgen'
     // See the file `WG/Default.cc` for the implmentation
     class DefaultWG : public WG {
         public:
 
-        // perlin noise generator
+        // the stages, as indices into 'stages'
+        enum {
+            STAGE_TERRAIN = 0,
+            STAGE_CARVE,
+            STAGE_DECORATE,
+        };
+
+        // perlin noise generator, with the layers for the rolling hills and the ridges
         Random::PerlinMux pmgen;
 
         // cave generator
         Random::PerlinMux cavegen;
 
+        // the biomes and climate
+        BiomeMap biomes;
+
         // construct given a seed
         DefaultWG(uint32_t seed=0);
 
-        // generate a chunk from a given ChunkID
-        Chunk* getChunk(ChunkID id);
+        // return the fingerprint of the generator, from its version and seed
+        uint64_t getFingerprint();
+
+        // run a stage on a chunk
+        void runStage(int idx, Chunk* chunk, const ChunkArea& area);
+
+        private:
+
+        // fill in the stone, dirt, and grass of each column
+        void genTerrain(Chunk* chunk);
+
+        // carve out caves
+        void carveCaves(Chunk* chunk);
+
+        // place boulders from all chunks in 'area' that fall in 'chunk'
+        void decorate(Chunk* chunk, const ChunkArea& area);
 
     };
 
@@ -69,6 +297,8 @@ namespace Blok::WG {
     // FlatWG - a 'flat' world generator, with constant, unchanging layers, which can be set by
     // "addLayer()", so the random seed does nothing
     // See the file `WG/Flat.cc` for the implmentation
+    // Every chunk is the same, so a single prototype chunk is built (whenever 'layers' changes), and
+    //   every chunk is a clone of it, sharing its storage (see `Chunk::clone()`)
     class FlatWG : public WG {
         public:
 
@@ -78,9 +308,29 @@ namespace Blok::WG {
         // construct given a seed (seed is never used)
         FlatWG(uint32_t seed=0);
 
+        // free the prototype (chunks cloned from it keep their storage)
+        ~FlatWG();
+
         // generate a chunk from a given ChunkID
         Chunk* getChunk(ChunkID id);
 
+        // return the fingerprint of the generator, from its layers
+        uint64_t getFingerprint();
+
+        private:
+
+        // the chunk that all others are cloned from, or NULL if it hasn't been built yet
+        Chunk* proto;
+
+        // the value of 'layers' that 'proto' was built with
+        List< Pair<ID, int> > protoLayers;
+
+        // held while checking (or rebuilding) the prototype, since workers generate chunks concurrently
+        std::mutex protoMutex;
+
+        // build a new chunk out of 'layers'
+        Chunk* buildChunk();
+
     };
 
 
@@ -0,0 +1,205 @@
+/* WG/Biome.cc - implementation of the biome map
+ *
+ */
+
+#include <Blok/Biome.hh>
+
+#include <algorithm>
+
+namespace Blok::WG {
+
+// round down 'a / b' (for any sign of 'a')
+static inline int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+BiomeMap::BiomeMap(uint32_t seed, int maxTiles) {
+    this->maxTiles = maxTiles;
+    tick = 0;
+    stats.n_requests = 0;
+    stats.n_tiles = 0;
+    stats.t_tiles = 0;
+
+    // all of the noise is in cell coordinates, so it is scaled up by the size of a cell
+    float cs = CELL_SIZE;
+    Random::NoiseGraph graph;
+
+    // this used to be the first layer of DefaultWG's height map
+    int height = graph.perlin(Random::Perlin(seed + 1, vec3(0.002f * cs), vec2(0.3, 0.65), vec2(30, 80)));
+    heightPlan = graph.compile(height);
+
+    int temperature = graph.remap(graph.fbm(seed + 5, vec3(cs / 700.0f), 2), 0.0, 1.5, 0.0, 1.0);
+    temperaturePlan = graph.compile(temperature);
+
+    int humidity = graph.remap(graph.fbm(seed + 7, vec3(cs / 500.0f), 2), 0.0, 1.5, 0.0, 1.0);
+    humidityPlan = graph.compile(humidity);
+}
+
+BiomeMap::~BiomeMap() {
+    for (auto& entry : tiles) {
+        delete entry.second;
+    }
+}
+
+Biome BiomeMap::classify(float height, float temperature, float humidity) {
+    if (height > 62.0f && temperature < 0.45f) return BIOME_MOUNTAINS;
+    if (temperature > 0.55f && humidity < 0.45f) return BIOME_BADLANDS;
+    if (humidity > 0.55f) return BIOME_HILLS;
+    return BIOME_PLAINS;
+}
+
+BiomeCell BiomeMap::calcCell(int cx, int cz) {
+    double height, temperature, humidity;
+    heightPlan.eval2d(cx, cz, 1, 1, &height);
+    temperaturePlan.eval2d(cx, cz, 1, 1, &temperature);
+    humidityPlan.eval2d(cx, cz, 1, 1, &humidity);
+
+    BiomeCell res;
+    res.height = height;
+    res.temperature = temperature;
+    res.humidity = humidity;
+    res.biome = classify(res.height, res.temperature, res.humidity);
+    return res;
+}
+
+void BiomeMap::buildTile(int tx, int tz, Tile* tile) {
+    double st = getTime();
+    const int N = TILE_CELLS * TILE_CELLS;
+    List<double> height(N), temperature(N), humidity(N);
+    heightPlan.eval2d(tx * TILE_CELLS, tz * TILE_CELLS, TILE_CELLS, TILE_CELLS, &height[0]);
+    temperaturePlan.eval2d(tx * TILE_CELLS, tz * TILE_CELLS, TILE_CELLS, TILE_CELLS, &temperature[0]);
+    humidityPlan.eval2d(tx * TILE_CELLS, tz * TILE_CELLS, TILE_CELLS, TILE_CELLS, &humidity[0]);
+
+    tile->cells.resize(N);
+    for (int i = 0; i < N; ++i) {
+        BiomeCell& cell = tile->cells[i];
+        cell.height = height[i];
+        cell.temperature = temperature[i];
+        cell.humidity = humidity[i];
+        cell.biome = classify(cell.height, cell.temperature, cell.humidity);
+    }
+
+    stats.n_tiles.fetch_add(1, std::memory_order_relaxed);
+    stats.t_tiles.fetch_add((int64_t)(1e6 * (getTime() - st)), std::memory_order_relaxed);
+}
+
+BiomeMap::Tile* BiomeMap::getTile(std::unique_lock<std::mutex>& lock, int tx, int tz) {
+    Pair<int, int> key(tx, tz);
+    while (true) {
+        auto it = tiles.find(key);
+        if (it == tiles.end()) break;
+
+        Tile* tile = it->second;
+        if (!tile->isReady) {
+            // someone else is making it
+            CV_tiles.wait(lock);
+            continue;
+        }
+
+        tile->lastUse = tick++;
+        return tile;
+    }
+
+    // make it ourselves, while anyone else who needs it waits
+    // NOTE: tiles that aren't ready are never freed, so 'tile' stays valid while we are unlocked
+    Tile* tile = new Tile();
+    tile->isReady = false;
+    tile->lastUse = tick++;
+    tiles[key] = tile;
+
+    lock.unlock();
+    buildTile(tx, tz, tile);
+    lock.lock();
+
+    tile->isReady = true;
+    CV_tiles.notify_all();
+    return tile;
+}
+
+void BiomeMap::getCells(int cx0, int cz0, int ncx, int ncz, BiomeCell* out) {
+    stats.n_requests.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(L_tiles);
+
+    // copy the part of each tile that overlaps the area
+    int tx0 = floorDiv(cx0, TILE_CELLS), tx1 = floorDiv(cx0 + ncx - 1, TILE_CELLS);
+    int tz0 = floorDiv(cz0, TILE_CELLS), tz1 = floorDiv(cz0 + ncz - 1, TILE_CELLS);
+    for (int tx = tx0; tx <= tx1; ++tx) {
+        for (int tz = tz0; tz <= tz1; ++tz) {
+            Tile* tile = getTile(lock, tx, tz);
+
+            // the overlap, in cell coordinates
+            int x0 = glm::max(cx0, tx * TILE_CELLS), x1 = glm::min(cx0 + ncx, (tx + 1) * TILE_CELLS);
+            int z0 = glm::max(cz0, tz * TILE_CELLS), z1 = glm::min(cz0 + ncz, (tz + 1) * TILE_CELLS);
+            for (int x = x0; x < x1; ++x) {
+                const BiomeCell* src = &tile->cells[(x - tx * TILE_CELLS) * TILE_CELLS + (z0 - tz * TILE_CELLS)];
+                std::copy(src, src + (z1 - z0), out + (x - cx0) * ncz + (z0 - cz0));
+            }
+        }
+    }
+
+    // only now that we are done with them can tiles be freed
+    trim();
+}
+
+void BiomeMap::getColumns(ChunkID id, BiomeColumn* out) {
+    // cells are sampled at their corners, and each column blends the four corners around it, so this
+    //   needs one more cell in each direction than the chunk covers
+    const int NX = CHUNK_SIZE_X / CELL_SIZE + 1, NZ = CHUNK_SIZE_Z / CELL_SIZE + 1;
+    int cx0 = floorDiv(id.X * CHUNK_SIZE_X, CELL_SIZE), cz0 = floorDiv(id.Z * CHUNK_SIZE_Z, CELL_SIZE);
+    BiomeCell cells[NX * NZ];
+    getCells(cx0, cz0, NX, NZ, cells);
+
+    // and the parameters of each cell's biome
+    BiomeParams params[NX * NZ];
+    for (int i = 0; i < NX * NZ; ++i) params[i] = BiomeParams::get(cells[i].biome);
+
+    for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+        int i = x / CELL_SIZE;
+        float tx = (float)(x % CELL_SIZE) / CELL_SIZE;
+        for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+            int j = z / CELL_SIZE;
+            float tz = (float)(z % CELL_SIZE) / CELL_SIZE;
+
+            // bilinear weights of the 4 corners
+            int idx[4] = { i * NZ + j, (i + 1) * NZ + j, i * NZ + j + 1, (i + 1) * NZ + j + 1 };
+            float w[4] = { (1 - tx) * (1 - tz), tx * (1 - tz), (1 - tx) * tz, tx * tz };
+
+            BiomeColumn& col = out[x * CHUNK_SIZE_Z + z];
+            col.height = 0.0f;
+            col.params = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int k = 0; k < 4; ++k) {
+                col.height += w[k] * cells[idx[k]].height;
+                col.params.heightOffset += w[k] * params[idx[k]].heightOffset;
+                col.params.hillScale += w[k] * params[idx[k]].hillScale;
+                col.params.ridgeScale += w[k] * params[idx[k]].ridgeScale;
+                col.params.grass += w[k] * params[idx[k]].grass;
+            }
+            col.biome = cells[i * NZ + j].biome;
+        }
+    }
+}
+
+int BiomeMap::size() {
+    std::lock_guard<std::mutex> lock(L_tiles);
+    return tiles.size();
+}
+
+void BiomeMap::trim() {
+    if ((int)tiles.size() <= maxTiles) return;
+
+    List< Pair<uint64_t, Pair<int, int> > > idle;
+    for (auto& entry : tiles) {
+        if (entry.second->isReady) idle.push_back({ entry.second->lastUse, entry.first });
+    }
+    std::sort(idle.begin(), idle.end());
+
+    int num = tiles.size() - maxTiles;
+    for (int i = 0; i < num && i < (int)idle.size(); ++i) {
+        auto it = tiles.find(idle[i].second);
+        delete it->second;
+        tiles.erase(it);
+    }
+}
+
+}
@@ -9,77 +9,166 @@
 
 namespace Blok::WG {
 
+// caves are carved out between y=1 and this height (exclusive)
+#define CAVE_MAX_Y 100
+
+// the stream of random values (see `Random::PosHash`) used for placing boulders
+#define STREAM_BOULDERS 1
+
+// the version of what DefaultWG generates, which must be bumped whenever a change makes it generate
+//   different chunks for the same seed (so that delta saves made before then are not applied to them)
+#define DEFAULT_VERSION 2
+
 // construct given seed
-DefaultWG::DefaultWG(uint32_t seed) {
+DefaultWG::DefaultWG(uint32_t seed) : biomes(seed) {
     this->seed = seed;
 
     // create a muxer, to mix layers
     pmgen = Random::PerlinMux();
 
-    // add a basic layer
-    pmgen.addLayer(Random::Perlin(seed + 1, vec3(0.002), vec2(0.3, 0.65), vec2(30, 80)));
+    // the base height changes slowly, so it comes from the biome map, which only samples it every few
+    //   columns
     pmgen.addLayer(Random::Perlin(seed + 2, vec3(0.02), vec2(0.2, 0.9), vec2(0, 20)));
     pmgen.addLayer(Random::Perlin(seed + 3, vec3(0.007, .03, 0.0), vec2(0.7, 0.73), vec2(0, -40)));
 
     cavegen = Random::PerlinMux();
-    cavegen.addLayer(Random::Perlin(seed + 4, vec3(0.025, 0.08, 0.025), vec2(.6, .7), vec2(0.0, 1.0)));
+    Random::Perlin caves(seed + 4, vec3(0.025, 0.08, 0.025), vec2(.6, .7), vec2(0.0, 1.0));
+
+    // caves change slowly (especially along X and Z), so only sample them every few blocks
+    caves.lattice = vec3i(4, 2, 4);
+    cavegen.addLayer(caves);
+
+    // boulders can reach into the chunks next to the one they are in
+    stages.push_back({"terrain", 0});
+    stages.push_back({"carve", 0});
+    stages.push_back({"decorate", 1});
 }
 
-// generate a single chunk
-Chunk* DefaultWG::getChunk(ChunkID id) {
+// the generator, its version, and the seed
+uint64_t DefaultWG::getFingerprint() {
+    return ((uint64_t)'D' << 56) | ((uint64_t)DEFAULT_VERSION << 32) | seed;
+}
 
-    // create a new chunk pointer
-    Chunk* res = new Chunk();
+// run a single stage
+void DefaultWG::runStage(int idx, Chunk* chunk, const ChunkArea& area) {
+    if (idx == STAGE_TERRAIN) genTerrain(chunk);
+    else if (idx == STAGE_CARVE) carveCaves(chunk);
+    else if (idx == STAGE_DECORATE) decorate(chunk, area);
+}
 
-    // set the ID of the chunk
-    res->XZ = id;
+// generate the terrain of a chunk
+void DefaultWG::genTerrain(Chunk* res) {
+    ChunkID id = res->XZ;
 
     // first, do default terrain pass
-    int x, y, z;
+    int x, z;
+
+    // get the terrain parameters of every column, and sample the hills and ridges of every column at once
+    BiomeColumn cols[CHUNK_SIZE_X * CHUNK_SIZE_Z];
+    biomes.getColumns(id, cols);
+    double hills[CHUNK_SIZE_X * CHUNK_SIZE_Z], ridges[CHUNK_SIZE_X * CHUNK_SIZE_Z];
+    pmgen.layers[0].noise2dGrid(id.X * CHUNK_SIZE_X, id.Z * CHUNK_SIZE_Z, CHUNK_SIZE_X, CHUNK_SIZE_Z, hills);
+    pmgen.layers[1].noise2dGrid(id.X * CHUNK_SIZE_X, id.Z * CHUNK_SIZE_Z, CHUNK_SIZE_X, CHUNK_SIZE_Z, ridges);
 
     for (x = 0; x < CHUNK_SIZE_X; ++x) {
         for (z = 0; z < CHUNK_SIZE_Z; ++z) {
-            // for now, just a basic Perlin noise generator
-            // in the future, perhaps have a class that is a PerlinMuxGen, to generate combined perlin noise
-            //int stone_h = layerGen->noise(id.X * CHUNK_SIZE + x, id.Z * CHUNK_SIZE + z, 0.5) + 20;
-            int stone_h = pmgen.noise2d(id.X * CHUNK_SIZE_X + x, id.Z * CHUNK_SIZE_Z + z);
+            int i = x * CHUNK_SIZE_Z + z;
+            const BiomeColumn& col = cols[i];
+            int stone_h = col.height + col.params.heightOffset + col.params.hillScale * hills[i] + col.params.ridgeScale * ridges[i];
             if (stone_h < 3) stone_h = 3;
 
             int dirt_h = stone_h + 4;
 
-            // just set the stone data
-            for (y = 0; y < stone_h; ++y) {
-                res->set(x, y, z, BlockData(ID::STONE));
-            }
-
-            for (; y < dirt_h; ++y) {
-                res->set(x, y, z, BlockData(ID::DIRT));
-            }
-            for (; y < dirt_h + 1 && y > 15; ++y) {
-                res->set(x, y, z, BlockData(ID::DIRT_GRASS));
+            // grassy biomes have dirt on top of the stone, and the rest are bare stone
+            if (col.params.grass >= 0.5f) {
+                res->fillColumn(x, z, 0, stone_h, BlockData(ID::STONE));
+                res->fillColumn(x, z, stone_h, dirt_h, BlockData(ID::DIRT));
+                if (dirt_h > 15) res->fillColumn(x, z, dirt_h, dirt_h + 1, BlockData(ID::DIRT_GRASS));
+            } else {
+                res->fillColumn(x, z, 0, dirt_h, BlockData(ID::STONE));
             }
             
             // set the rest to air
             //while (y++ < CHUNK_HEIGHT) res->set(x, y, z, BlockInfo(ID::NONE));
         }
     }
+}
+
+// carve caves out of a chunk
+void DefaultWG::carveCaves(Chunk* res) {
+    ChunkID id = res->XZ;
+    int x, y, z;
+
     // now, do cave pass, deleting blocks out
+    // the whole chunk is sampled at once, so the lattice points are shared between columns
+    const int ny = CAVE_MAX_Y - 1;
+    List<double> smps(CHUNK_SIZE_X * CHUNK_SIZE_Z * ny);
+    cavegen.noise3dGrid(id.X * CHUNK_SIZE_X, 1, id.Z * CHUNK_SIZE_Z, CHUNK_SIZE_X, ny, CHUNK_SIZE_Z, &smps[0]);
+
     for (x = 0; x < CHUNK_SIZE_X; ++x) {
         for (z = 0; z < CHUNK_SIZE_Z; ++z) {
+            const double* col = &smps[(x * CHUNK_SIZE_Z + z) * ny];
 
-            for (y = 1; y < 100; ++y) {
-                double smp = cavegen.noise3d(id.X * CHUNK_SIZE_X + x, y, id.Z * CHUNK_SIZE_Z + z);
+            // clear out runs of blocks at once, where 'y0' is the start of the current run
+            int y0 = -1;
+            for (y = 1; y < CAVE_MAX_Y; ++y) {
+                double smp = col[y - 1];
                 double ff = (y - 30) / 30.0;
                 double thresh = 0.75 + 0.2 * ff * ff;
                 if (smp > thresh) {
-                    // clear it out
-                    res->set(x, y, z, BlockData(ID::AIR));
+                    if (y0 < 0) y0 = y;
+                } else if (y0 >= 0) {
+                    res->fillColumn(x, z, y0, y, BlockData(ID::AIR));
+                    y0 = -1;
+                }
+            }
+            if (y0 >= 0) res->fillColumn(x, z, y0, y, BlockData(ID::AIR));
+        }
+    }
+
+    // release storage for sections that ended up uniform (i.e. solid stone, or all air)
+    // This is what neighbors see while decorating, so it is worth keeping small
+    res->compact();
+}
+
+// decorate a chunk with boulders
+// Each chunk has up to 2 boulders sitting on its grass, which are decided only by its ID and its
+//   (carved) terrain, so the parts of boulders near the edges that fall in a neighbor are placed the same
+//   way when that neighbor is decorated
+void DefaultWG::decorate(Chunk* res, const ChunkArea& area) {
+    for (int X = -area.radius; X <= area.radius; ++X) {
+        for (int Z = -area.radius; Z <= area.radius; ++Z) {
+            ChunkID nid = area.center + ChunkID(X, Z);
+            const Chunk* from = area.getChunk(nid);
+
+            // each value comes from the chunk's position, with Y counting through the values, so
+            //   they are the same whichever chunk asks for them
+            Random::PosHash rng(seed, STREAM_BOULDERS);
+            int num = rng.getRange(nid.X, 0, nid.Z, 3);
+            for (int i = 0; i < num; ++i) {
+                int bx = rng.getRange(nid.X, 3 * i + 1, nid.Z, CHUNK_SIZE_X), bz = rng.getRange(nid.X, 3 * i + 2, nid.Z, CHUNK_SIZE_Z);
+                float rad = 1.5f + 1.5f * (float)rng.getD(nid.X, 3 * i + 3, nid.Z);
+                int by = from->getHeight(bx, bz);
+                if (by < 0 || from->get(bx, by, bz).id != ID::DIRT_GRASS) continue;
+
+                // the boulder's center, and its bounding box, in our local coordinates
+                int cx = bx + X * CHUNK_SIZE_X, cz = bz + Z * CHUNK_SIZE_Z, R = (int)rad;
+                int x0 = glm::max(cx - R, 0), x1 = glm::min(cx + R, CHUNK_SIZE_X - 1);
+                int z0 = glm::max(cz - R, 0), z1 = glm::min(cz + R, CHUNK_SIZE_Z - 1);
+                int y0 = glm::max(by - R, 0), y1 = glm::min(by + R, CHUNK_SIZE_Y - 1);
+                for (int x = x0; x <= x1; ++x) {
+                    for (int z = z0; z <= z1; ++z) {
+                        for (int y = y0; y <= y1; ++y) {
+                            int dx = x - cx, dy = y - by, dz = z - cz;
+                            if (dx * dx + dy * dy + dz * dz <= rad * rad) res->set(x, y, z, BlockData(ID::STONE));
+                        }
+                    }
                 }
             }
         }
     }
 
-    return res;
+    res->compact();
 }
 
 
@@ -16,17 +16,45 @@ FlatWG::FlatWG(uint32_t seed) {
     layers.push_back({ID::DIRT, 20});
     layers.push_back({ID::DIRT_GRASS, 1});
 
+    // built on the first request
+    proto = NULL;
+}
+
+FlatWG::~FlatWG() {
+    if (proto != NULL) delete proto;
 }
 
 // generate a single chunk
 Chunk* FlatWG::getChunk(ChunkID id) {
+    std::lock_guard<std::mutex> lock(protoMutex);
+
+    // rebuild the prototype if the layers have changed since it was built
+    if (proto == NULL || protoLayers != layers) {
+        if (proto != NULL) delete proto;
+        proto = buildChunk();
+        protoLayers = layers;
+    }
+
+    return proto->clone(id);
+}
+
+// the seed does nothing, so the fingerprint is the generator and its layers
+uint64_t FlatWG::getFingerprint() {
+    std::lock_guard<std::mutex> lock(protoMutex);
+
+    uint64_t res = 5381;
+    for (auto& layer : layers) {
+        res = res * 33 + (((uint64_t)layer.first << 32) | (uint32_t)layer.second);
+    }
+    return ((uint64_t)'F' << 56) ^ res;
+}
+
+// build a chunk out of the layers
+Chunk* FlatWG::buildChunk() {
 
     // create a new chunk pointer
     Chunk* res = new Chunk();
 
-    // set the ID of the chunk
-    res->XZ = id;
-
     // current coordinates
     int y = 0;
 
@@ -34,14 +62,7 @@ Chunk* FlatWG::getChunk(ChunkID id) {
     while (y < CHUNK_SIZE_Y && lidx < layers.size()) {
         // get the current layer
         auto& layer = layers[lidx];
-        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
-            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
-                for (int ly = 0; ly < layer.second && y + ly < CHUNK_SIZE_Y; ++ly) {
-                    // set it to the block
-                    res->set(x, y+ly, z, {layer.first});
-                }
-            }
-        }
+        res->fillLayer(y, y + layer.second, {layer.first});
 
         // move the Y up
         y += layer.second;
@@ -49,6 +70,9 @@ Chunk* FlatWG::getChunk(ChunkID id) {
         lidx++;
     }
 
+    // release storage for sections that ended up uniform (i.e. solid stone, or all air)
+    res->compact();
+
     return res;
 }
 
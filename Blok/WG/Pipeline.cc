@@ -0,0 +1,201 @@
+/* WG/Pipeline.cc - implementation of the staged world generation pipeline
+ *
+ */
+
+// include the world generator protocol
+#include <Blok/WG.hh>
+
+#include <algorithm>
+
+namespace Blok::WG {
+
+Pipeline::Pipeline(WG* wg, int maxStaged) {
+    this->wg = wg;
+    this->maxStaged = maxStaged;
+    tick = 0;
+    stagedBytes = 0;
+    stats.n_waits = 0;
+    stats.n_evicted = 0;
+}
+
+Pipeline::~Pipeline() {
+    for (auto& entry : staged) {
+        if (entry.second->chunk != NULL) delete entry.second->chunk;
+        delete entry.second;
+    }
+}
+
+Chunk* Pipeline::getChunk(ChunkID id) {
+    if (wg->stages.size() == 0) {
+        // nothing to run, so the chunk is just empty
+        Chunk* res = new Chunk();
+        res->XZ = id;
+        return res;
+    }
+
+    // the last stage is never staged, since nothing comes after it
+    Chunk* res = build(id, wg->stages.size() - 1);
+
+    // anything that is still shared with the staging area stays that way, until it is modified
+    res->compact();
+    return res;
+}
+
+int Pipeline::size() {
+    std::lock_guard<std::mutex> lock(L_staged);
+    return staged.size();
+}
+
+size_t Pipeline::getMemoryUsage() {
+    std::lock_guard<std::mutex> lock(L_staged);
+    return stagedBytes;
+}
+
+void Pipeline::clear() {
+    std::lock_guard<std::mutex> lock(L_staged);
+    auto it = staged.begin();
+    while (it != staged.end()) {
+        Staged* st = it->second;
+        if (st->users == 0) {
+            stagedBytes -= st->bytes;
+            delete st->chunk;
+            delete st;
+            it = staged.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+Pipeline::Stats Pipeline::getStats() {
+    std::lock_guard<std::mutex> lock(L_staged);
+    return stats;
+}
+
+const Chunk* Pipeline::acquire(ChunkID id, int stage) {
+    Pair<ChunkID, int> key(id, stage);
+
+    std::unique_lock<std::mutex> lock(L_staged);
+    while (true) {
+        auto it = staged.find(key);
+        if (it == staged.end()) break;
+
+        Staged* st = it->second;
+        if (st->chunk == NULL) {
+            // someone else is making it, so wait for them to finish
+            stats.n_waits++;
+            CV_staged.wait(lock);
+            continue;
+        }
+
+        st->users++;
+        st->lastUse = tick++;
+        return st->chunk;
+    }
+
+    // we make it, and in the meantime, anyone else who needs it waits
+    Staged* st = new Staged();
+    st->chunk = NULL;
+    st->bytes = 0;
+    st->users = 1;
+    st->lastUse = tick++;
+    staged[key] = st;
+    lock.unlock();
+
+    Chunk* res = build(id, stage);
+
+    // measure it outside of the lock, since it looks at every section
+    size_t bytes = res->getMemoryUsage();
+
+    lock.lock();
+    st->chunk = res;
+    st->bytes = bytes;
+    stagedBytes += bytes;
+    trim();
+    lock.unlock();
+    CV_staged.notify_all();
+    return res;
+}
+
+void Pipeline::release(ChunkID id, int stage) {
+    std::lock_guard<std::mutex> lock(L_staged);
+    auto it = staged.find(Pair<ChunkID, int>(id, stage));
+    if (it == staged.end()) {
+        blok_warn("released chunk (%i, %i) at stage %i, which was never staged!", id.X, id.Z, stage);
+        return;
+    }
+    it->second->users--;
+}
+
+Chunk* Pipeline::build(ChunkID id, int stage) {
+    int radius = wg->stages[stage].radius;
+    Chunk* res = NULL;
+    ChunkArea area;
+    area.center = id;
+    area.radius = radius;
+
+    if (radius == 0 || stage == 0) {
+        // the stage only needs this chunk, so just run it after the stages before it
+        if (stage == 0) {
+            res = new Chunk();
+            res->XZ = id;
+        } else {
+            res = build(id, stage - 1);
+        }
+        area.radius = 0;
+        area.chunks.push_back(res);
+    } else {
+        // get the whole area as it was after the previous stage, and start from a copy of the center
+        for (int X = -radius; X <= radius; ++X) {
+            for (int Z = -radius; Z <= radius; ++Z) {
+                area.chunks.push_back(acquire(id + ChunkID(X, Z), stage - 1));
+            }
+        }
+        res = area.getChunk(id)->clone(id);
+    }
+
+    double st = getTime();
+    wg->runStage(stage, res, area);
+    st = getTime() - st;
+
+    if (area.radius > 0) {
+        for (int X = -radius; X <= radius; ++X) {
+            for (int Z = -radius; Z <= radius; ++Z) {
+                release(id + ChunkID(X, Z), stage - 1);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(L_staged);
+    if (stats.n_runs.size() < wg->stages.size()) {
+        stats.n_runs.resize(wg->stages.size(), 0);
+        stats.t_runs.resize(wg->stages.size(), 0.0);
+    }
+    stats.n_runs[stage]++;
+    stats.t_runs[stage] += st;
+
+    return res;
+}
+
+void Pipeline::trim() {
+    if ((int)staged.size() <= maxStaged) return;
+
+    // free down to 3/4 of the limit at once, so that this doesn't happen on every new chunk
+    List< Pair<uint64_t, Pair<ChunkID, int> > > idle;
+    for (auto& entry : staged) {
+        if (entry.second->users == 0) idle.push_back({ entry.second->lastUse, entry.first });
+    }
+    std::sort(idle.begin(), idle.end());
+
+    int num = staged.size() - maxStaged * 3 / 4;
+    for (int i = 0; i < num && i < (int)idle.size(); ++i) {
+        auto it = staged.find(idle[i].second);
+        stagedBytes -= it->second->bytes;
+        delete it->second->chunk;
+        delete it->second;
+        staged.erase(it);
+        stats.n_evicted++;
+    }
+}
+
+}
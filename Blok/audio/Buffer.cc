@@ -13,7 +13,7 @@
 namespace Blok::Audio {
 
 // cache of loaded constant buffers from files
-Map<String, Buffer*> Buffer::cache;
+HashMap<String, Buffer*> Buffer::cache;
 
 // read a wav file into a buffer, as a const (i.e. do not modify or free it)
 // it will be stored in 'cache'
@@ -10,262 +10,222 @@
 namespace Blok::Render {
 
 
-// add visible faces to the list
-static void addBlock(List<ChunkMeshVertex>& vertices, List<Face>& faces, Chunk* chunk, int x, int y, int z) {
-
-    // top, bottom, left, right, forward, and reverse faces
-    bool doTop=false, doBot=false, doLef=false, doRig=false, doFor=false, doBac=false;
-
-    // get the ID
-    int id = chunk->get(x, y, z).id;
-
-    // check top and bottom faces
-    if (y == CHUNK_SIZE_Y - 1) {
-        doTop = true;
-    } else if (chunk->get(x, y+1, z).id == ID::AIR) {
-        doTop = true;
+// FaceInfo - how the quads of faces pointing in a given direction are laid out
+// Each quad has 4 vertices: the first at the corner with the smallest coordinates, the second one step
+//   along 'v', the third one step along 'u', and the fourth one step along both
+struct FaceInfo {
+
+    // the direction the face points in
+    vec3i normal;
+
+    // the axes (0=X, 1=Y, 2=Z) that the face spans
+    int axisU, axisV;
+
+    // the texture coordinates at the first vertex, and how much they change for each block along 'u'
+    //   and 'v'
+    vec2 uv0, uvU, uvV;
+
+    // the corner of the block's texture that the face's texture coordinates are wrapped into (each block
+    //   texture has its top, bottom, and sides in different quarters)
+    vec2 tile;
+
+    // the two triangles, as indices of the 4 vertices (in clockwise order)
+    int tris[6];
+
+};
+
+// the layout of the faces on each side (indexed by 'Chunk::Side')
+static const FaceInfo faceInfos[Chunk::SIDE_NUM] = {
+    /* SIDE_L    */ { vec3i(-1, 0, 0), 1, 2, vec2(0.5, 1.0), vec2(0.0, -0.5), vec2(-0.5, 0.0), vec2(0.0, 0.5), { 0, 1, 2, 1, 3, 2 } },
+    /* SIDE_T    */ { vec3i(0, 0, 1),  0, 1, vec2(0.5, 1.0), vec2(-0.5, 0.0), vec2(0.0, -0.5), vec2(0.0, 0.5), { 0, 2, 1, 1, 2, 3 } },
+    /* SIDE_R    */ { vec3i(1, 0, 0),  1, 2, vec2(0.0, 1.0), vec2(0.0, -0.5), vec2(0.5, 0.0),  vec2(0.0, 0.5), { 0, 2, 1, 1, 2, 3 } },
+    /* SIDE_B    */ { vec3i(0, 0, -1), 0, 1, vec2(0.0, 1.0), vec2(0.5, 0.0),  vec2(0.0, -0.5), vec2(0.0, 0.5), { 0, 1, 2, 1, 3, 2 } },
+    /* SIDE_UP   */ { vec3i(0, 1, 0),  0, 2, vec2(0.0, 0.5), vec2(0.5, 0.0),  vec2(0.0, -0.5), vec2(0.0, 0.0), { 0, 1, 2, 1, 3, 2 } },
+    /* SIDE_DOWN */ { vec3i(0, -1, 0), 0, 2, vec2(1.0, 0.5), vec2(-0.5, 0.0), vec2(0.0, -0.5), vec2(0.5, 0.0), { 1, 0, 2, 1, 2, 3 } },
+};
+
+// return whether the block at local 'x, y, z' of 'chunk' (which may be up to one block outside of it in X
+//   and Z, in the neighbors) is solid, for ambient occlusion. Anything outside of the loaded chunks is not
+static bool sampleSolid(const Chunk* chunk, int x, int y, int z) {
+    if (y < 0 || y >= CHUNK_SIZE_Y) return false;
+
+    // source for the chunk
+    if (x < 0) {
+        chunk = chunk->rcache.cL;
+        x += CHUNK_SIZE_X;
+    } else if (x >= CHUNK_SIZE_X) {
+        chunk = chunk->rcache.cR;
+        x -= CHUNK_SIZE_X;
     }
-
-    if (y == 0) {
-        doBot = true;
-    } else if (chunk->get(x, y-1, z).id == ID::AIR) {
-        doBot = true;
+    if (chunk == NULL) return false;
+
+    if (z < 0) {
+        chunk = chunk->rcache.cB;
+        z += CHUNK_SIZE_Z;
+    } else if (z >= CHUNK_SIZE_Z) {
+        chunk = chunk->rcache.cT;
+        z -= CHUNK_SIZE_Z;
     }
+    if (chunk == NULL) return false;
 
-    // check left & right faces
-    if (x == CHUNK_SIZE_X-1) {
-        if (chunk->rcache.cR != NULL && chunk->rcache.cR->get(0, y, z).id == ID::AIR) {
-            doRig = true;
-        }
-    } else if (chunk->get(x+1, y, z).id == ID::AIR) {
-        doRig = true;
-    }
+    return chunk->isSolid(x, y, z);
+}
 
-    if (x == 0) {
-        if (chunk->rcache.cL != NULL && chunk->rcache.cL->get(CHUNK_SIZE_X-1, y, z).id == ID::AIR) {
-            doLef = true;
-        }
-    } else if (chunk->get(x-1, y, z).id == ID::AIR) {
-        doLef = true;
+// return the key of the face on 'side' of the (visible) block at 'pos', which is the block ID, and the
+//   ambient occlusion of each vertex (the number of solid blocks touching its corner, from 0 to 3, in 2
+//   bits each). Faces with the same key look exactly the same
+static uint16_t calcFaceKey(const Chunk* chunk, int side, vec3i pos) {
+    const FaceInfo& info = faceInfos[side];
+
+    // the blocks in front of the face, one step along 'u' and 'v'
+    vec3i front = pos + info.normal, du(0), dv(0);
+    du[info.axisU] = 1;
+    dv[info.axisV] = 1;
+
+    uint16_t key = chunk->get(pos.x, pos.y, pos.z).id << 8;
+    for (int k = 0; k < 4; ++k) {
+        // the corner of the vertex (see 'FaceInfo')
+        vec3i su = (k & 2) ? du : -du, sv = (k & 1) ? dv : -dv;
+        vec3i a = front + su, b = front + sv, c = front + su + sv;
+        int num = (sampleSolid(chunk, a.x, a.y, a.z) ? 1 : 0) + (sampleSolid(chunk, b.x, b.y, b.z) ? 1 : 0) + (sampleSolid(chunk, c.x, c.y, c.z) ? 1 : 0);
+        key |= num << (2 * k);
     }
+    return key;
+}
 
-
-    // check forward and back faces
-    if (z == CHUNK_SIZE_Z-1) {
-        if (chunk->rcache.cT != NULL && chunk->rcache.cT->get(x, y, 0).id == ID::AIR) {
-            doFor = true;
-        }
-    } else if (chunk->get(x, y, z+1).id == ID::AIR) {
-        doFor = true;
+// add a quad of faces on 'side', starting at the block at 'pos', and covering 'w' blocks along 'u'
+//   and 'h' along 'v', which all have 'key' (see `calcFaceKey()`)
+static void addQuad(List<ChunkMeshVertex>& vertices, List<Face>& faces, int side, vec3i pos, int w, int h, uint16_t key) {
+    const FaceInfo& info = faceInfos[side];
+    vec3i du(0), dv(0);
+    du[info.axisU] = w;
+    dv[info.axisV] = h;
+
+    // faces on the positive sides are on the far side of the block
+    vec3 base = vec3(pos + glm::max(info.normal, vec3i(0)));
+
+    int idx = vertices.size();
+    for (int k = 0; k < 4; ++k) {
+        float cu = (k & 2) ? 1.0f : 0.0f, cv = (k & 1) ? 1.0f : 0.0f;
+        int num = (key >> (2 * k)) & 3;
+        vertices.push_back(ChunkMeshVertex(base + cu * vec3(du) + cv * vec3(dv), info.uv0 + (cu * w) * info.uvU + (cv * h) * info.uvV, info.tile, vec3(info.normal), key >> 8, (3 - num) / 3.0));
     }
 
-    if (z == 0) {
-        if (chunk->rcache.cB != NULL && chunk->rcache.cB->get(x, y, CHUNK_SIZE_Z-1).id == ID::AIR) {
-            doBac = true;
-        }
-    } else if (chunk->get(x, y, z-1).id == ID::AIR) {
-        doBac = true;
-    }
+    faces.push_back({idx + info.tris[0], idx + info.tris[1], idx + info.tris[2]});
+    faces.push_back({idx + info.tris[3], idx + info.tris[4], idx + info.tris[5]});
+}
 
-    // now, add them to the mesh, if they are visible
-    // keep a array of all blocks around the origin
-    //    +---+---+---+
-    // Y /           /|
-    //  /    ...    / |
-    // +---+---+---+  |  Z
-    // | 2 |11 |20 |  |
-    // | 1 |10 |19 |  /
-    // | 0 | 9 |18 | /
-    // +---+---+---+/ X
-    //
-    BlockData surround[27];
-
-    // get surrounding sample
-    #define GET_S(_x, _y, _z) (surround[(_x) * 9 + (_z) * 3 + (_y)])
-
-
-    // basically a monte carlo sample
-    float raycastFac = 1.0;
-
-    if (doTop || doBot || doRig || doLef || doFor || doBac) {
-        // fill up the surrounds
-        for (int lx = -1; lx <= 1; ++lx) {
-            for (int lz = -1; lz <= 1; ++lz) {
-                int nx = x+lx, nz = z+lz;
-
-                // source for the chunk
-                Chunk* src = chunk;
-                if (nx < 0) {
-                    src = src->rcache.cL;
-                    nx += CHUNK_SIZE_X;
-                } else if (nx >= CHUNK_SIZE_X) {
-                    src = src->rcache.cR;
-                    nx -= CHUNK_SIZE_X;
-                }
-                if (src == NULL) continue;
-
-                if (nz < 0) {
-                    src = src->rcache.cB;
-                    nz += CHUNK_SIZE_Z;
-                } else if (nz >= CHUNK_SIZE_Z) {
-                    src = src->rcache.cT;
-                    nz -= CHUNK_SIZE_Z;
-                }
-                if (src == NULL) continue;
+// merge the faces in layer 'layer' (along the normal) of 'keys' (indexed like the blocks of a chunk, with
+//   0 meaning no face) into as few quads as possible, and clear them from 'keys'. Only 'nu' by 'nv'
+//   blocks of the layer are looked at
+static void addLayer(List<ChunkMeshVertex>& vertices, List<Face>& faces, int side, int layer, int nu, int nv, uint16_t* keys) {
+    const FaceInfo& info = faceInfos[side];
+    int axisL = 3 - info.axisU - info.axisV;
+
+    // how far apart blocks are in 'keys' along each axis (see `Chunk::getIndex()`)
+    const int strides[3] = { CHUNK_SIZE_Y * CHUNK_SIZE_Z, 1, CHUNK_SIZE_Y };
+    uint16_t* base = keys + layer * strides[axisL];
+    #define KEY(_u, _v) (base[(_u) * strides[info.axisU] + (_v) * strides[info.axisV]])
+
+    for (int v = 0; v < nv; ++v) {
+        for (int u = 0; u < nu; ++u) {
+            uint16_t key = KEY(u, v);
+            if (key == 0) continue;
+
+            // faces can only be merged in a direction that their ambient occlusion doesn't change along,
+            //   since otherwise it would be stretched across the whole quad
+            int ao[4] = { key & 3, (key >> 2) & 3, (key >> 4) & 3, (key >> 6) & 3 };
+            bool flatU = ao[0] == ao[2] && ao[1] == ao[3], flatV = ao[0] == ao[1] && ao[2] == ao[3];
+
+            // grow along 'u' first, and then along 'v' a whole row at a time
+            int w = 1, h = 1;
+            while (flatU && u + w < nu && KEY(u + w, v) == key) w++;
+            while (flatV && v + h < nv) {
+                bool same = true;
+                for (int i = 0; i < w && same; ++i) same = KEY(u + i, v + h) == key;
+                if (!same) break;
+                h++;
+            }
 
-                for (int ly = -1; ly <= 1; ++ly) {
-                    // sample inner cube
-                    if (y+ly >= 0 && y+ly < CHUNK_SIZE_Y) {
+            // these faces are now taken care of
+            for (int j = 0; j < h; ++j) {
+                for (int i = 0; i < w; ++i) KEY(u + i, v + j) = 0;
+            }
 
-                        GET_S(lx+1, ly+1, lz+1) = src->get(nx, y+ly, nz);
-                    }
-                    //surround[lx * 9 + lz * 3 + ly] = chunk->get(x+lx, y+ly, z+lz);
-                }
-            }            
+            vec3i pos(0);
+            pos[axisL] = layer;
+            pos[info.axisU] = u;
+            pos[info.axisV] = v;
+            addQuad(vertices, faces, side, pos, w, h, key);
         }
     }
 
-    if (doTop) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(0, 2, 0).id != ID::AIR ? 1 : 0) + (GET_S(1, 2, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 2, 1).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z),     vec2(0.0, 0.5), vec3(0, 1, 0), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(0, 2, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(1, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z+1),   vec2(0.0, 0.0), vec3(0, 1, 0), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(2, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(1, 2, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z),   vec2(0.5, 0.5), vec3(0, 1, 0), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(1, 2, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z+1), vec2(0.5, 0.0), vec3(0, 1, 0), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx, idx+1, idx+2});
-        faces.push_back({idx+1, idx+3, idx+2});
-    }
-
-    if (doBot) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(0, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 0, 1).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z),       vec2(1.0, 0.5), vec3(0, -1, 0), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(0, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 0, 1).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z+1),     vec2(1.0, 0.0), vec3(0, -1, 0), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(2, 0, 1).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z),     vec2(0.5, 0.5), vec3(0, -1, 0), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(1, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 1).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z+1),   vec2(0.5, 0.0), vec3(0, -1, 0), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx+1, idx, idx+2});
-        faces.push_back({idx+1, idx+2, idx+3});
-    }
-
-    if (doRig) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(2, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 1).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z),     vec2(0.0, 1.0), vec3(1, 0, 0), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(2, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 1).id != ID::AIR ? 1 : 0) + (GET_S(2, 1, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z+1),   vec2(0.5, 1.0), vec3(1, 0, 0), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(2, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(2, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z),   vec2(0.0, 0.5), vec3(1, 0, 0), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(2, 1, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z+1), vec2(0.5, 0.5), vec3(1, 0, 0), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx, idx+2, idx+1});
-        faces.push_back({idx+1, idx+2, idx+3});
-    }
-
-    if (doLef) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(0, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 0, 1).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z),     vec2(0.5, 1.0), vec3(-1, 0, 0), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(0, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 0, 1).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z+1),   vec2(0.0, 1.0), vec3(-1, 0, 0), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(0, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 2, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z),   vec2(0.5, 0.5), vec3(-1, 0, 0), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(0, 1, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 2, 1).id != ID::AIR ? 1 : 0) + (GET_S(0, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z+1), vec2(0.0, 0.5), vec3(-1, 0, 0), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx, idx+1, idx+2});
-        faces.push_back({idx+1, idx+3, idx+2});
-    }
-
-
-    if (doFor) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(0, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z+1),     vec2(0.5, 1.0), vec3(0, 0, 1), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(0, 2, 2).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 2).id != ID::AIR ? 1 : 0) + (GET_S(1, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z+1),   vec2(0.5, 0.5), vec3(0, 0, 1), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(2, 1, 2).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z+1),   vec2(0.0, 1.0), vec3(0, 0, 1), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(1, 2, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 1, 2).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 2).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z+1), vec2(0.0, 0.5), vec3(0, 0, 1), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx, idx+2, idx+1});
-        faces.push_back({idx+1, idx+2, idx+3});
-    }
-
-    if (doBac) {
-        // we are on top, so always render the top face
-        int idx = vertices.size();
-
-        int last0 = (GET_S(0, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y, z),     vec2(0.0, 1.0), vec3(0, 0, -1), id, (3 - last0) / 3.0));
-
-        int last1 = (GET_S(0, 2, 0).id != ID::AIR ? 1 : 0) + (GET_S(0, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(1, 2, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x, y+1, z),   vec2(0.0, 0.5), vec3(0, 0, -1), id, (3 - last1) / 3.0));
-
-        int last2 = (GET_S(2, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(1, 0, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 0, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y, z),   vec2(0.5, 1.0), vec3(0, 0, -1), id, (3 - last2) / 3.0));
-
-        int last3 = (GET_S(1, 2, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 1, 0).id != ID::AIR ? 1 : 0) + (GET_S(2, 2, 0).id != ID::AIR ? 1 : 0);
-        vertices.push_back(ChunkMeshVertex(vec3(x+1, y+1, z), vec2(0.5, 0.5), vec3(0, 0, -1), id, (3 - last3) / 3.0));
-
-        faces.push_back({idx, idx+1, idx+2});
-        faces.push_back({idx+1, idx+3, idx+2});
-    }
-    // done with this face
-
+    #undef KEY
 }
 
-// update the mesh from a given chunk data
-void ChunkMesh::update(Chunk* chunk) {
+int ChunkMesh::build(Chunk* chunk, Mode mode, List<ChunkMeshVertex>& vertices, List<Face>& faces) {
+    vertices.clear();
+    faces.clear();
 
-    // reset the variables here
-    vertices = {};
-    faces = {};
-
-    // iterate through all non-empty blocks, adding them
-    // TODO: maybe use the dirtyMin/Max to only update parts of the mesh?
+    // the faces of each column that are visible, which are found a whole column at a time from the solid
+    //   bits (see `Chunk::getFaces()`), so buried blocks are never looked at
+    static_assert(CHUNK_COLUMN_WORDS == 4, "the face bits are sized for 256 block columns");
+    uint64_t colFaces[CHUNK_SIZE_X * CHUNK_SIZE_Z][Chunk::SIDE_NUM][CHUNK_COLUMN_WORDS];
+    int maxHeight = -1, numFaces = 0;
     for (int x = 0; x < CHUNK_SIZE_X; ++x) {
         for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
-            for (int y = 0; y < CHUNK_SIZE_Y; ++y) {
-                if (chunk->get(x, y, z).id != ID::AIR) {
-                    addBlock(vertices, faces, chunk, x, y, z);
+            int col = chunk->getColumnIndex(x, z);
+            maxHeight = glm::max(maxHeight, chunk->getHeight(x, z));
+            chunk->getFaces(x, z, colFaces[col]);
+            for (int s = 0; s < Chunk::SIDE_NUM; ++s) {
+                for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) numFaces += __builtin_popcountll(colFaces[col][s][w]);
+            }
+        }
+    }
+
+    // all air, so nothing could possibly be visible
+    if (maxHeight < 0) return 0;
+
+    // the keys of one side's faces, indexed like the blocks of the chunk (and all 0 between sides, since
+    //   merging clears them)
+    List<uint16_t> keys;
+    if (mode == MODE_GREEDY) keys.resize(CHUNK_NUM_BLOCKS, 0);
+
+    for (int s = 0; s < Chunk::SIDE_NUM; ++s) {
+        const FaceInfo& info = faceInfos[s];
+
+        // which layers (along the normal) have any faces
+        bool hasLayer[CHUNK_SIZE_Y] = { false };
+        for (int x = 0; x < CHUNK_SIZE_X; ++x) {
+            for (int z = 0; z < CHUNK_SIZE_Z; ++z) {
+                const uint64_t* bits = colFaces[chunk->getColumnIndex(x, z)][s];
+                for (int w = 0; w < CHUNK_COLUMN_WORDS; ++w) {
+                    uint64_t rest = bits[w];
+                    while (rest != 0) {
+                        vec3i pos(x, 64 * w + __builtin_ctzll(rest), z);
+                        rest &= rest - 1;
+
+                        uint16_t key = calcFaceKey(chunk, s, pos);
+                        if (mode == MODE_NAIVE) {
+                            // a quad for every face
+                            addQuad(vertices, faces, s, pos, 1, 1, key);
+                        } else {
+                            keys[chunk->getIndex(pos.x, pos.y, pos.z)] = key;
+                            hasLayer[pos[3 - info.axisU - info.axisV]] = true;
+                        }
+                    }
                 }
             }
         }
+
+        if (mode == MODE_GREEDY) {
+            // nothing is above the highest block, so layers along Y can stop there
+            const int sizes[3] = { CHUNK_SIZE_X, maxHeight + 1, CHUNK_SIZE_Z };
+            int axisL = 3 - info.axisU - info.axisV;
+            for (int l = 0; l < sizes[axisL]; ++l) {
+                if (hasLayer[l]) addLayer(vertices, faces, s, l, sizes[info.axisU], sizes[info.axisV], &keys[0]);
+            }
+        }
     }
 
     // translate them to real world positions
@@ -276,6 +236,16 @@ void ChunkMesh::update(Chunk* chunk) {
         vertices[i].ao *= (0.75 + 0.35 * vertices[i].pos.y / CHUNK_SIZE_Y);
     }
 
+    return 2 * numFaces;
+}
+
+// update the mesh from a given chunk data
+void ChunkMesh::update(Chunk* chunk, Mode mode) {
+
+    // reset the variables here
+    // TODO: maybe use the dirtyMin/Max to only update parts of the mesh?
+    numNaiveTris = build(chunk, mode, vertices, faces);
+
     // now, store in the OpenGL objects
     glBindVertexArray(glVAO);
 
@@ -302,6 +272,8 @@ void ChunkMesh::update(Chunk* chunk) {
 //   triangles
 ChunkMesh::ChunkMesh() {
 
+    numNaiveTris = 0;
+
     // create OpenGL handles for everything
     glGenVertexArrays(1, &glVAO);
     glGenBuffers(1, &glVBO);
@@ -322,14 +294,6 @@ ChunkMesh::ChunkMesh() {
     glEnableVertexAttribArray(1);	
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, uv));
 
-    // vertex tangent
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, T));
-
-    // vertex bitangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, B));
-
     // vertex normals
     glEnableVertexAttribArray(4);	
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, N));
@@ -342,6 +306,10 @@ ChunkMesh::ChunkMesh() {
     glEnableVertexAttribArray(6);	
     glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, ao));
 
+    // the corner of the block texture that the texture coordinates wrap in
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, sizeof(ChunkMeshVertex), (void*)offsetof(ChunkMeshVertex, tile));
+
 
     // unbind state
     glBindVertexArray(0);
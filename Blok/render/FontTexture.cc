@@ -8,7 +8,7 @@
 
 namespace Blok::Render {
     
-Map<String, FontTexture*> FontTexture::cache;    
+HashMap<String, FontTexture*> FontTexture::cache;    
 
 // load a constant copy of the font texture
 FontTexture* FontTexture::loadConst(const String& path) {
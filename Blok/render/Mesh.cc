@@ -12,7 +12,7 @@
 namespace Blok::Render {
 
 // the global cache that are loaded
-Map<String, Mesh*> Mesh::cache;
+HashMap<String, Mesh*> Mesh::cache;
 
 
 // internal method to iterate through Assimp's structure
@@ -9,7 +9,7 @@
 namespace Blok::Render {
 
 // initialize the cache for shared texture loads
-Map<String, Texture*> Texture::cache;
+HashMap<String, Texture*> Texture::cache;
 
 // load a new copy of the texture
 Texture* Texture::loadCopy(const String& path) {
@@ -0,0 +1,558 @@
+/* save/Region.cc - implementation of region files, and the chunk encoding they use
+ *
+ * See `Save.hh` for a description of the format
+ *
+ */
+
+#include <Blok/Save.hh>
+
+// for open/pread/pwrite/fsync/mkdir
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// for mmap/munmap
+#include <sys/mman.h>
+
+namespace Blok::Save {
+
+/* CHUNK ENCODING */
+
+// append the raw bytes of 'val' to 'out'
+template<typename T>
+static void put(List<uint8_t>& out, T val) {
+    size_t pos = out.size();
+    out.resize(pos + sizeof(T));
+    memcpy(&out[pos], &val, sizeof(T));
+}
+
+// read a 'T' from 'data' at 'pos' (advancing it), returning false if there is not enough data
+template<typename T>
+static bool get(const uint8_t* data, size_t len, size_t& pos, T& val) {
+    if (pos + sizeof(T) > len) return false;
+    memcpy(&val, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// append the encoding of 'sec' to 'out' (as SECTION_UNIFORM or SECTION_PALETTE)
+static void encodeSection(const ChunkSection& sec, List<uint8_t>& out) {
+    if (sec.blocks == NULL) {
+        // uniform sections are just their value
+        put<uint8_t>(out, SECTION_UNIFORM);
+        put<uint16_t>(out, sec.fill.pack());
+    } else {
+        // otherwise, the palette and then the indices, exactly as they are in memory
+        const BlockStorage* bs = sec.blocks;
+        put<uint8_t>(out, SECTION_PALETTE);
+        put<uint8_t>(out, bs->lbits);
+        put<uint16_t>(out, bs->paletteSize);
+        for (int j = 0; j < bs->paletteSize; ++j) {
+            put<uint16_t>(out, bs->palette[j].pack());
+        }
+
+        size_t pos = out.size(), wbytes = sizeof(uint64_t) * (bs->size >> (6 - bs->lbits));
+        out.resize(pos + wbytes);
+        memcpy(&out[pos], bs->words, wbytes);
+    }
+}
+
+// decode a section (at 'pos' in 'data') into section 'i' of 'chunk', returning whether it was valid
+// Only SECTION_SPARSE changes go through `Chunk::set()`; the others replace the section outright
+static bool decodeSection(Chunk* chunk, int i, const uint8_t* data, size_t len, size_t& pos) {
+    ChunkSection& sec = chunk->sections[i];
+
+    uint8_t kind;
+    if (!get(data, len, pos, kind)) return false;
+
+    if (kind == SECTION_UNIFORM) {
+        uint16_t fill;
+        if (!get(data, len, pos, fill)) return false;
+        sec.release();
+        sec.fill = BlockData::unpack(fill);
+
+    } else if (kind == SECTION_PALETTE) {
+        uint8_t lbits;
+        uint16_t paletteSize;
+        if (!get(data, len, pos, lbits) || !get(data, len, pos, paletteSize)) return false;
+        if (lbits > 4 || paletteSize > BlockStorage::getPaletteCap(lbits)) return false;
+
+        BlockData palette[256];
+        for (int j = 0; j < paletteSize; ++j) {
+            uint16_t val;
+            if (!get(data, len, pos, val)) return false;
+            palette[j] = BlockData::unpack(val);
+        }
+
+        // the words may not be aligned in the buffer, so copy them out
+        size_t wbytes = sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> (6 - lbits));
+        if (pos + wbytes > len) return false;
+        List<uint64_t> words(wbytes / sizeof(uint64_t));
+        memcpy(words.data(), data + pos, wbytes);
+        pos += wbytes;
+
+        sec.release();
+        sec.blocks = new BlockStorage(SECTION_NUM_BLOCKS, lbits, palette, paletteSize, words.data());
+
+        // make sure no index is out of the palette
+        for (int j = 0; lbits < 4 && j < SECTION_NUM_BLOCKS; ++j) {
+            if (sec.blocks->getRaw(j) >= (uint32_t)paletteSize) return false;
+        }
+
+    } else if (kind == SECTION_SPARSE) {
+        uint16_t num;
+        if (!get(data, len, pos, num)) return false;
+        for (int j = 0; j < num; ++j) {
+            uint16_t idx, val;
+            if (!get(data, len, pos, idx) || !get(data, len, pos, val) || idx >= SECTION_NUM_BLOCKS) return false;
+
+            // invert `Chunk::getSectionIndex()`
+            chunk->set(idx >> 8, SECTION_SIZE_Y * i + (idx & 15), (idx >> 4) & 15, BlockData::unpack(val));
+        }
+
+    } else {
+        return false;
+    }
+
+    // the section is no longer what the generator made
+    chunk->editedSections |= 1u << i;
+    return true;
+}
+
+void encodeChunk(const Chunk* chunk, List<uint8_t>& out) {
+    put<uint8_t>(out, PAYLOAD_FULL);
+    for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+        encodeSection(chunk->sections[i], out);
+    }
+}
+
+void encodeChunkDelta(const Chunk* chunk, const Chunk* base, List<uint8_t>& out) {
+    put<uint8_t>(out, PAYLOAD_DELTA);
+
+    // fill in the mask later
+    size_t maskPos = out.size();
+    put<uint16_t>(out, 0);
+    uint16_t mask = 0;
+
+    List<uint16_t> changes;
+    for (int i = 0; i < CHUNK_NUM_SECTIONS; ++i) {
+        // sections that haven't been touched must be the same as what was generated
+        if ((chunk->editedSections & (1u << i)) == 0) continue;
+
+        const ChunkSection& sec = chunk->sections[i];
+        const ChunkSection& bsec = base->sections[i];
+
+        // find all the blocks that differ
+        changes.clear();
+        for (int j = 0; j < SECTION_NUM_BLOCKS; ++j) {
+            BlockData val = sec.blocks == NULL ? sec.fill : sec.blocks->get(j);
+            BlockData bval = bsec.blocks == NULL ? bsec.fill : bsec.blocks->get(j);
+            if (val != bval) {
+                changes.push_back(j);
+                changes.push_back(val.pack());
+            }
+        }
+
+        // edited, but then changed back
+        if (changes.size() == 0) continue;
+        mask |= 1 << i;
+
+        // use whichever is smaller, the list of changes, or the whole section
+        size_t fullBytes = sec.blocks == NULL ? 3 : 4 + sizeof(uint16_t) * sec.blocks->paletteSize + sizeof(uint64_t) * (SECTION_NUM_BLOCKS >> (6 - sec.blocks->lbits));
+        if (3 + sizeof(uint16_t) * changes.size() < fullBytes) {
+            put<uint8_t>(out, SECTION_SPARSE);
+            put<uint16_t>(out, changes.size() / 2);
+            for (uint16_t val : changes) {
+                put<uint16_t>(out, val);
+            }
+        } else {
+            encodeSection(sec, out);
+        }
+    }
+
+    memcpy(&out[maskPos], &mask, sizeof(mask));
+}
+
+Chunk* decodeChunk(ChunkID id, const uint8_t* data, size_t len, WG::WG* worldGen) {
+    size_t pos = 0;
+    uint8_t kind;
+    if (!get(data, len, pos, kind)) return NULL;
+
+    Chunk* chunk = NULL;
+    bool isValid = true;
+
+    if (kind == PAYLOAD_FULL) {
+        chunk = new Chunk();
+        chunk->XZ = id;
+        for (int i = 0; i < CHUNK_NUM_SECTIONS && isValid; ++i) {
+            isValid = decodeSection(chunk, i, data, len, pos);
+        }
+
+    } else if (kind == PAYLOAD_DELTA && worldGen != NULL) {
+        uint16_t mask;
+        if (!get(data, len, pos, mask)) return NULL;
+
+        // start with what was originally generated, and apply the changes on top of it
+        chunk = worldGen->getChunk(id);
+        chunk->editedSections = 0;
+        for (int i = 0; i < CHUNK_NUM_SECTIONS && isValid; ++i) {
+            if (mask & (1 << i)) isValid = decodeSection(chunk, i, data, len, pos);
+        }
+        chunk->compact();
+
+    } else {
+        if (kind == PAYLOAD_DELTA) blok_error("Can't load a delta saved chunk without a world generator");
+        return NULL;
+    }
+
+    if (!isValid || pos != len) {
+        delete chunk;
+        return NULL;
+    }
+
+    // most sections were replaced outright, rather than through `Chunk::set()`
+    chunk->rebuildColumns();
+
+    return chunk;
+}
+
+void compress(const uint8_t* data, size_t len, List<uint8_t>& out) {
+    // Each packet starts with a header byte 'h':
+    //   * h < 128: the next h+1 bytes are copied literally
+    //   * h >= 128: the next byte is repeated h-125 times (i.e. 3 through 130)
+    size_t i = 0, litStart = 0;
+    while (i < len) {
+        // measure the run starting at 'i'
+        size_t run = 1;
+        while (i + run < len && run < 130 && data[i + run] == data[i]) run++;
+
+        if (run >= 3) {
+            // flush any pending literals
+            while (litStart < i) {
+                size_t num = i - litStart < 128 ? i - litStart : 128;
+                out.push_back(num - 1);
+                out.insert(out.end(), data + litStart, data + litStart + num);
+                litStart += num;
+            }
+
+            out.push_back(run + 125);
+            out.push_back(data[i]);
+            i += run;
+            litStart = i;
+        } else {
+            i += run;
+        }
+    }
+
+    // flush the remaining literals
+    while (litStart < len) {
+        size_t num = len - litStart < 128 ? len - litStart : 128;
+        out.push_back(num - 1);
+        out.insert(out.end(), data + litStart, data + litStart + num);
+        litStart += num;
+    }
+}
+
+bool decompress(const uint8_t* data, size_t len, List<uint8_t>& out) {
+    size_t i = 0;
+    while (i < len) {
+        uint8_t h = data[i++];
+        if (h < 128) {
+            if (i + h + 1 > len) return false;
+            out.insert(out.end(), data + i, data + i + h + 1);
+            i += h + 1;
+        } else {
+            if (i >= len) return false;
+            out.insert(out.end(), (size_t)h - 125, data[i]);
+            i++;
+        }
+    }
+    return true;
+}
+
+
+/* REGION FILES */
+
+// the magic bytes at the start of a region file
+static const char REGION_MAGIC[4] = { 'B', 'L', 'K', 'R' };
+
+RegionFile* RegionFile::open(const String& path, bool create, uint64_t fingerprint) {
+    int fd = ::open(path.c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+    if (fd < 0) {
+        if (create) blok_error("Failed to open region file '%s'", path.c_str());
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        blok_error("Failed to stat region file '%s'", path.c_str());
+        ::close(fd);
+        return NULL;
+    }
+
+    // the header, including the offset table
+    List<uint8_t> header(REGION_HEADER_SECTORS * REGION_SECTOR_SIZE, 0);
+    size_t size = st.st_size;
+
+    if (size == 0) {
+        // new file, so write an empty header
+        memcpy(&header[0], REGION_MAGIC, 4);
+        uint32_t version = REGION_VERSION;
+        memcpy(&header[4], &version, 4);
+        memcpy(&header[8], &fingerprint, 8);
+        if (pwrite(fd, header.data(), header.size(), 0) != (ssize_t)header.size()) {
+            blok_error("Failed to write region file '%s'", path.c_str());
+            ::close(fd);
+            return NULL;
+        }
+        size = header.size();
+    } else {
+        uint32_t version;
+        if (size < header.size() || pread(fd, header.data(), header.size(), 0) != (ssize_t)header.size() || memcmp(&header[0], REGION_MAGIC, 4) != 0) {
+            blok_error("Region file '%s' is invalid", path.c_str());
+            ::close(fd);
+            return NULL;
+        }
+        memcpy(&version, &header[4], 4);
+        if (version != REGION_VERSION) {
+            blok_error("Region file '%s' has unsupported version %i", path.c_str(), (int)version);
+            ::close(fd);
+            return NULL;
+        }
+
+        // delta saves only make sense against the generator they were saved with
+        uint64_t fileFingerprint;
+        memcpy(&fileFingerprint, &header[8], 8);
+        if (fingerprint != 0 && fileFingerprint != fingerprint) {
+            blok_error("Region file '%s' was made by a different world generator (%016llx, not %016llx), refusing to load it", path.c_str(), (unsigned long long)fileFingerprint, (unsigned long long)fingerprint);
+            ::close(fd);
+            return NULL;
+        }
+    }
+
+    RegionFile* rf = new RegionFile();
+    rf->path = path;
+    rf->fd = fd;
+    rf->map = NULL;
+    rf->mapSize = 0;
+    rf->numSectors = (size + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+    memcpy(rf->table, &header[REGION_TABLE_OFFSET], sizeof(rf->table));
+
+    // mark which sectors are in use
+    rf->used.resize(rf->numSectors, false);
+    for (int i = 0; i < REGION_HEADER_SECTORS; ++i) rf->used[i] = true;
+    for (int i = 0; i < REGION_NUM_CHUNKS; ++i) {
+        uint32_t first = rf->table[i][0], num = rf->table[i][1];
+        if (first == 0) continue;
+        if (first < REGION_HEADER_SECTORS || num == 0 || (uint64_t)first + num > rf->numSectors) {
+            // the file was truncated, or the table is corrupt, so drop the entry
+            blok_warn("Region file '%s' has an invalid entry for chunk %i, ignoring it", path.c_str(), i);
+            rf->table[i][0] = rf->table[i][1] = 0;
+            continue;
+        }
+        for (uint32_t j = first; j < first + num; ++j) rf->used[j] = true;
+    }
+
+    return rf;
+}
+
+RegionFile::~RegionFile() {
+    if (map != NULL) munmap((void*)map, mapSize);
+    ::close(fd);
+}
+
+bool RegionFile::ensureMapped(size_t size) {
+    if (size <= mapSize) return true;
+
+    // the file has grown since we last mapped it, so map all of it again
+    if (map != NULL) munmap((void*)map, mapSize);
+    map = NULL;
+    mapSize = 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) return false;
+
+    void* res = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (res == MAP_FAILED) return false;
+
+    map = (const uint8_t*)res;
+    mapSize = st.st_size;
+    return true;
+}
+
+uint32_t RegionFile::allocSectors(uint32_t num) {
+    // first, look for a gap left behind by a chunk that moved
+    uint32_t runStart = 0, runLen = 0;
+    for (uint32_t i = REGION_HEADER_SECTORS; i < numSectors; ++i) {
+        if (used[i]) {
+            runLen = 0;
+        } else {
+            if (runLen == 0) runStart = i;
+            if (++runLen == num) {
+                for (uint32_t j = runStart; j < runStart + num; ++j) used[j] = true;
+                return runStart;
+            }
+        }
+    }
+
+    // otherwise, add to the end of the file
+    uint32_t first = numSectors;
+    numSectors += num;
+    used.resize(numSectors, true);
+    return first;
+}
+
+bool RegionFile::hasChunk(int idx) {
+    std::lock_guard<std::mutex> lock(L_file);
+    return table[idx][0] != 0;
+}
+
+bool RegionFile::readChunk(int idx, List<uint8_t>& out) {
+    std::lock_guard<std::mutex> lock(L_file);
+    uint32_t first = table[idx][0], num = table[idx][1];
+    if (first == 0) return false;
+
+    if (!ensureMapped((size_t)(first + num) * REGION_SECTOR_SIZE)) {
+        blok_error("Failed to map region file '%s'", path.c_str());
+        return false;
+    }
+
+    // the payload is the compressed length, then the data
+    const uint8_t* payload = map + (size_t)first * REGION_SECTOR_SIZE;
+    uint32_t len;
+    memcpy(&len, payload, sizeof(len));
+    if (len + sizeof(len) > (size_t)num * REGION_SECTOR_SIZE || !decompress(payload + sizeof(len), len, out)) {
+        blok_error("Region file '%s' has a corrupt chunk %i", path.c_str(), idx);
+        return false;
+    }
+
+    return true;
+}
+
+bool RegionFile::writeChunk(int idx, const List<uint8_t>& data) {
+    // compress it outside of the lock
+    List<uint8_t> buf;
+    buf.resize(sizeof(uint32_t));
+    compress(data.data(), data.size(), buf);
+    uint32_t len = buf.size() - sizeof(uint32_t);
+    memcpy(&buf[0], &len, sizeof(len));
+
+    // pad it out to whole sectors
+    uint32_t num = (buf.size() + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+    buf.resize((size_t)num * REGION_SECTOR_SIZE, 0);
+
+    std::lock_guard<std::mutex> lock(L_file);
+    uint32_t oldFirst = table[idx][0], oldNum = table[idx][1];
+
+    // always write to new sectors, and only free the old ones once the table points away from them,
+    //   so the table never refers to a half-written chunk
+    uint32_t first = allocSectors(num);
+
+    if (pwrite(fd, buf.data(), buf.size(), (off_t)first * REGION_SECTOR_SIZE) != (ssize_t)buf.size()) {
+        blok_error("Failed to write to region file '%s'", path.c_str());
+        for (uint32_t j = first; j < first + num; ++j) used[j] = false;
+        return false;
+    }
+
+    uint32_t entry[2] = { first, num };
+    if (pwrite(fd, entry, sizeof(entry), REGION_TABLE_OFFSET + sizeof(entry) * idx) != sizeof(entry)) {
+        blok_error("Failed to write to region file '%s'", path.c_str());
+        for (uint32_t j = first; j < first + num; ++j) used[j] = false;
+        return false;
+    }
+    table[idx][0] = first;
+    table[idx][1] = num;
+
+    // now the old copy can be reused
+    for (uint32_t j = oldFirst; oldFirst != 0 && j < oldFirst + oldNum; ++j) used[j] = false;
+
+    return true;
+}
+
+void RegionFile::sync() {
+    std::lock_guard<std::mutex> lock(L_file);
+    fsync(fd);
+}
+
+
+/* REGION STORES */
+
+RegionStore::RegionStore(const String& dir, Mode mode, WG::WG* worldGen) {
+    this->dir = dir;
+    this->mode = mode;
+    this->worldGen = worldGen;
+
+    // make sure the directory exists (it is fine if it already does)
+    mkdir(dir.c_str(), 0755);
+}
+
+RegionStore::~RegionStore() {
+    sync();
+    for (auto& entry : regions) {
+        if (entry.second != NULL) delete entry.second;
+    }
+}
+
+String RegionStore::getRegionPath(ChunkID rid) const {
+    char tmpbuf[64];
+    snprintf(tmpbuf, sizeof(tmpbuf), "/r.%i.%i.blr", rid.X, rid.Z);
+    return dir + tmpbuf;
+}
+
+RegionFile* RegionStore::getRegion(ChunkID rid, bool create) {
+    std::lock_guard<std::mutex> lock(L_regions);
+
+    // NOTE: regions that don't exist are cached as NULL, so they don't have to be checked for every chunk
+    auto it = regions.find(rid);
+    if (it != regions.end() && (it->second != NULL || !create || failed.count(rid) > 0)) return it->second;
+
+    RegionFile* rf = RegionFile::open(getRegionPath(rid), create, worldGen != NULL ? worldGen->getFingerprint() : 0);
+    regions[rid] = rf;
+    if (rf == NULL && create) failed.insert(rid);
+    return rf;
+}
+
+bool RegionStore::hasChunk(ChunkID id) {
+    int idx;
+    RegionFile* rf = getRegion(getRegionID(id, idx), false);
+    return rf != NULL && rf->hasChunk(idx);
+}
+
+Chunk* RegionStore::loadChunk(ChunkID id) {
+    int idx;
+    RegionFile* rf = getRegion(getRegionID(id, idx), false);
+
+    List<uint8_t> data;
+    if (rf == NULL || !rf->readChunk(idx, data)) return NULL;
+
+    Chunk* chunk = decodeChunk(id, data.data(), data.size(), worldGen);
+    if (chunk == NULL) blok_error("Region file '%s' has a corrupt chunk %i", rf->path.c_str(), idx);
+    return chunk;
+}
+
+bool RegionStore::saveChunk(const Chunk* chunk) {
+    int idx;
+    ChunkID rid = getRegionID(chunk->XZ, idx);
+
+    List<uint8_t> data;
+    if (mode == MODE_DELTA && worldGen != NULL) {
+        // only generate the original if there is something to compare against
+        Chunk* base = chunk->editedSections != 0 ? worldGen->getChunk(chunk->XZ) : NULL;
+        encodeChunkDelta(chunk, base, data);
+        if (base != NULL) delete base;
+    } else {
+        encodeChunk(chunk, data);
+    }
+
+    RegionFile* rf = getRegion(rid, true);
+    return rf != NULL && rf->writeChunk(idx, data);
+}
+
+void RegionStore::sync() {
+    std::lock_guard<std::mutex> lock(L_regions);
+    for (auto& entry : regions) {
+        if (entry.second != NULL) entry.second->sync();
+    }
+}
+
+}
@@ -20,6 +20,9 @@ in vec4 fWPos;
 // ambient occlusion
 in float fAO;
 
+// <u, v> the corner of the block's texture that 'fUV' wraps in
+flat in vec2 fTile;
+
 
 /* FBO Outputs */
 
@@ -55,14 +58,20 @@ void main() {
     vec4 col = vec4(1, 0, 0, 1);
     //col = texture(texID3, fUV);
 
+    // merged faces cover more than one block, so their UVs run past the block's quarter of the texture,
+    //   and are wrapped back into it. The gradients come from the unwrapped UVs, so the mipmap level
+    //   doesn't jump at the seams
+    vec2 uv = fTile + mod(fUV - fTile, 0.5);
+    vec2 dUVdx = dFdx(fUV), dUVdy = dFdy(fUV);
+
     // check various constants
     // TODO: texture atlas
     if (fBlockID < 1.1) {
-        col = texture(texID1, fUV);
+        col = textureGrad(texID1, uv, dUVdx, dUVdy);
     } else if (fBlockID < 2.1) {
-        col = texture(texID2, fUV);
+        col = textureGrad(texID2, uv, dUVdx, dUVdy);
     } else if (fBlockID < 3.1) {
-        col = texture(texID3, fUV);
+        col = textureGrad(texID3, uv, dUVdx, dUVdy);
     } else {
         discard;
     }
@@ -89,7 +98,7 @@ void main() {
     // mix ambient occlusion
     gColor = col * (0.3 + 0.8 * fAO);
     gPos = fPos;
-    gUV = vec4(fUV, 0.0f, 0.0f);
+    gUV = vec4(uv, 0.0f, 0.0f);
     gNormal = vec4(N, 0.0f);
     gWPos = fWPos;
     gWPos.w = (fPos.z + 1) / 2 + 1; 
@@ -8,9 +8,7 @@ layout (location = 0) in vec3 aPos;
 // UV coordinates of the vertex
 layout (location = 1) in vec2 aUV;
 
-// Tangent, Bitangent, Normal space of the vertex
-layout (location = 2) in vec3 aT;
-layout (location = 3) in vec3 aB;
+// Normal of the vertex
 layout (location = 4) in vec3 aN;
 
 /* Instanced Inputs */
@@ -22,6 +20,9 @@ layout (location = 5) in float gBlockID;
 // ambient occlusion amount
 layout (location = 6) in float aAO;
 
+// the corner of the block texture that the UV coordinates wrap in
+layout (location = 7) in vec2 aTile;
+
 /* Fragment Shader Outputs */
 
 // the screen position
@@ -36,6 +37,8 @@ out float fBlockID;
 out vec4 fWPos;
 // the world position
 out float fAO;
+// the corner of the block texture
+flat out vec2 fTile;
 
 /* Globals */
 
@@ -61,6 +64,8 @@ void main() {
 
     fAO = aAO;
 
+    fTile = aTile;
+
     // update opengl vars
     gl_Position = fPos;
 